@@ -0,0 +1,48 @@
+/*
+ * Declarations shared by the audiobeam variants.
+ */
+#ifndef OPTIMIZED_H
+#define OPTIMIZED_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define MAX_LINE 1024
+
+#define SOUND_SPEED 342        // m/s
+#define SAMPLING_RATE 16000    // samples/s
+
+#define CARTESIAN_DISTANCE(x1,y1,z1,x2,y2,z2) \
+    (sqrt(((x1)-(x2))*((x1)-(x2)) + ((y1)-(y2))*((y1)-(y2)) + ((z1)-(z2))*((z1)-(z2))))
+
+// Circular buffer of the most recent samples, one float per microphone
+struct DataQueue {
+    float **sample_queue;
+    int head;
+    int tail;
+    unsigned char full;
+};
+
+// Delays (in samples) of each microphone for a number of beams
+struct Delays {
+    float **delay_values;
+    char **delay_info;
+    long int max_delay;
+};
+
+struct PreprocessedDelays {
+    float delay;
+    int high;
+    int low;
+    float offset;
+};
+
+// Read one sample, one float per microphone, from the binary input
+// (data/data2.bin). Returns 0 at the end of the input.
+static inline int read_sample(FILE *fp, float *sample, int num_mic) {
+    return fread(sample, sizeof(float), num_mic, fp) == (size_t)num_mic;
+}
+
+#endif // OPTIMIZED_H
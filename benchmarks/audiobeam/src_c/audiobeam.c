@@ -783,8 +783,7 @@ int process_signal(FILE *fp, FILE *output_fp, struct Delays *delays, int num_mic
 
     i = 0;
     if (buffer  == 1) {
-        while (fgets(line,MAX_LINE,fp)!=NULL) {
-            parse_line(line, data_buffer[i], NUM_MIC);
+        while (i < BUFFER_SIZE && read_sample(fp, data_buffer[i], NUM_MIC)) {
 
             //            printf("parsing current line");
             //            float_arr_to_str(data_buffer[i], NUM_MIC, str);
@@ -806,8 +805,7 @@ int process_signal(FILE *fp, FILE *output_fp, struct Delays *delays, int num_mic
 
     // RMR { prime the sample queue (fill in max_delay-1 entries, the last entry is filled in the mail loop)
     for (i = 0; i < delays->max_delay - 1; i++) {
-        if (fgets(line,MAX_LINE,fp)!=NULL) {
-            parse_line(line, (queue->sample_queue)[queue->head], NUM_MIC);
+        if (read_sample(fp, (queue->sample_queue)[queue->head], NUM_MIC)) {
         } else { 
             return(-1);
         }
@@ -850,8 +848,7 @@ int process_signal(FILE *fp, FILE *output_fp, struct Delays *delays, int num_mic
 
             } else 
 #endif
-            if (fgets(line,MAX_LINE,fp)!=NULL) {
-                parse_line(line, (queue->sample_queue)[queue->head], NUM_MIC);
+            if (read_sample(fp, (queue->sample_queue)[queue->head], NUM_MIC)) {
             } else { 
                 done = 1;
                 //                printf("window exceeded\n");
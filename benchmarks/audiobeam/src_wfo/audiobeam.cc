@@ -0,0 +1,713 @@
+/*
+ * audiobeam: delay-and-sum beamforming on a microphone array.
+ *
+ * Swan port with versioned objects. The main task reads the input one
+ * window at a time into an object of its own, preceded by the max_delay
+ * samples before the window. A task beamforms each window and a second
+ * task reports its result. The report tasks are ordered through an
+ * inoutdep on the report state, hence windows are beamformed in parallel
+ * while the output appears in the same order as in src_c.
+ */
+#include "optimized.h"
+#include <sys/time.h>
+
+#include "wf_interface.h"
+
+#define NUM_MIC 15
+#define ANGLE_ENERGY_WINDOW_SIZE 400
+#define NUM_ANGLES 180
+#define GRID_STEP_SIZE 0.003  // .3cm
+#define GRID_ENERGY_WINDOW_SIZE 3200 // (samples) = 200ms
+#define NUM_DIRS 7
+
+// Samples per task when beamforming a single position
+#define CHUNK ANGLE_ENERGY_WINDOW_SIZE
+// Upper bound on max_delay, the number of samples of history in a window
+#define MAX_DELAY 128
+
+#define INTERPOLATE(low_value, high_value, offset) (((high_value-low_value)*(offset)) + low_value)
+
+// 15-microphone array for data set from Kevin
+
+float mic_locations[NUM_MIC][3] = {
+    {1.5,2.79,0},
+    {1.5,2.82,0},
+    {1.5,2.85,0},
+    {1.5,2.88,0},
+    {1.5,2.91,0},
+    {1.5,2.94,0},
+    {1.5,2.97,0},
+    {1.5,3,0},
+    {1.5,3.03,0},
+    {1.5,3.06,0},
+    {1.5,3.09,0},
+    {1.5,3.12,0},
+    {1.5,3.15,0},
+    {1.5,3.18,0},
+    {1.5,3.21,0}
+};
+
+// For Kevin's data
+float source_location[] = {1.1677,2.1677,1};
+
+float origin_location[] = {1.5,3,0};  // center of the array
+
+void preprocess_delays(struct PreprocessedDelays prep_delays[], float* delays)
+{
+    int i;
+
+    for (i=0; i < NUM_MIC; i++) {
+        prep_delays[i].delay = delays[i];
+        prep_delays[i].high = (int) ceil(delays[i]);
+        prep_delays[i].low = (int) floor(delays[i]);
+        prep_delays[i].offset = delays[i] - prep_delays[i].low;
+    }
+}
+
+/******************************  HELPER FUNCTIONS *************************/
+
+// Find the maximum element in an array of floats, rounded up
+long int find_max_in_arr(float *arr, int size) {
+    int i;
+    float max = 0;
+
+    for (i=0; i<size; i++) {
+        if (arr[i] > max) {
+            max = arr[i];
+        }
+    }
+
+    return ceil(max);
+}
+
+// Find the minimum element in an array of floats, rounded down
+long int find_min_in_arr(float *arr, int size) {
+    int i;
+    float min = 999e999;
+
+    for (i=0; i<size; i++) {
+        if (arr[i] < min ) {
+            min = arr[i];
+        }
+    }
+
+    return floor(min);
+}
+
+// The max_delay most recent samples, oldest first. Before the first
+// sample, the samples are 0, as in the queue of src_c.
+struct History {
+    int m;
+    float rows[MAX_DELAY][NUM_MIC];
+
+    History(int m_) : m(m_) { memset(rows, 0, sizeof(rows)); }
+
+    void push(const float *sample) {
+        memmove(rows[0], rows[1], (m-1)*sizeof(rows[0]));
+        memcpy(rows[m-1], sample, sizeof(rows[0]));
+    }
+};
+
+// Prime the history with max_delay-1 samples, which are not beamformed.
+// Returns 0 if the input ends first.
+int prime_history(FILE *fp, History *hist) {
+    float sample[NUM_MIC];
+    int i;
+
+    for (i = 0; i < hist->m - 1; i++) {
+        if (!read_sample(fp, sample, NUM_MIC))
+            return 0;
+        hist->push(sample);
+    }
+    return 1;
+}
+
+// Read up to size samples into rows[m ...], after a copy of the history
+// in rows[0 .. m), and advance the history. Returns the number of samples
+// read.
+int read_window(FILE *fp, History *hist, float (*rows)[NUM_MIC], int size) {
+    int m = hist->m;
+    int n = 0;
+
+    memcpy(rows, hist->rows, m*sizeof(rows[0]));
+    while (n < size && read_sample(fp, rows[m+n], NUM_MIC))
+        n++;
+    memcpy(hist->rows, rows[n], m*sizeof(rows[0]));
+    return n;
+}
+
+/******************************  DELAY/WEIGHTS/ENERGY MATH *************************/
+
+// Calculate the cartesian distances from the source to each of the
+// microphones
+void calc_distances(float *source_location, float mic_locations[NUM_MIC][3],
+                    float *distances,
+                    int num_mic) {
+    int i;
+
+    for (i=0; i<num_mic; i++) {
+        distances[i]=CARTESIAN_DISTANCE(mic_locations[i][0],mic_locations[i][1],mic_locations[i][2],
+                                        source_location[0],source_location[1],source_location[2]);
+    }
+}
+
+// Calculate the delay (in # of samples) for each one of the microphones
+void calc_delays(float *distances, float *delays, int sound_speed, int sampling_rate, int num_mic) {
+    int i;
+
+    for (i=0; i<num_mic; i++) {
+        // delay(in samples) = (distance to travel / speed of sound) * (# samples / second)
+        delays[i] = (distances[i] / sound_speed) * sampling_rate;
+    }
+}
+
+// Calculate the delay (in # of samples) for each one of the
+// microphones using the far-field assumption (i.e. use only an
+// azimuthal angle, and ignore the distance from the array to the
+// source -- that means assuming the sound wavefront is planar and not
+// spherical)
+void calc_far_field_delays(float mic_locations[NUM_MIC][3], float origin_location[3], float angle,
+                           float *delays,
+                           int sound_speed, int sampling_rate, int num_mic) {
+    int i;
+
+    float cosine = cos(-angle);
+    float sine = sin(-angle);
+
+    for (i=0; i<num_mic; i++) {
+        // delay(in samples) = (- [(xm-x0)*(cos(theta))+(ym-y0)*(sin(theta))] / speed of sound) * (# samples / second)
+        delays[i] = - (((mic_locations[i][0]-origin_location[0])*cosine) +
+                       ((mic_locations[i][1]-origin_location[1])*sine)) * sampling_rate / sound_speed;
+    }
+}
+
+// Make all the delays positive by adding the maximum delay to all of
+// the delays
+void positivize_delays(float* delays, int num_mic) {
+    int i;
+    long int max_delay = find_max_in_arr (delays, num_mic);
+
+    for (i=0; i<num_mic; i++) {
+        delays[i] += max_delay;
+    }
+}
+
+// Adjust the delays by subtracting the smallest delay from each
+// delay. This is done in order to minimize the size of our queue.
+void adjust_delays(float* delays, int num_mic) {
+    int i;
+    long int min_delay = find_min_in_arr (delays, num_mic) - 1;
+
+    for (i=0; i<num_mic; i++) {
+        delays[i] -= min_delay;
+    }
+}
+
+// Create a "cube" of delays around a given point, meaning extend by
+// GRID_STEP_SIZE in each direction along the x, y, and z axes
+void calc_target_cube_delays(float initial_location[3], float target_locations[NUM_DIRS][3],
+                             float delays[NUM_DIRS][NUM_MIC]) {
+    float mic_distances[NUM_MIC];
+    int i;
+
+    for (i = 0; i < NUM_DIRS; i++) {
+        memcpy(target_locations[i], initial_location, 3*sizeof(float));
+    }
+    target_locations[0][0] -= GRID_STEP_SIZE; // x
+    target_locations[1][0] += GRID_STEP_SIZE;
+    target_locations[2][1] -= GRID_STEP_SIZE; // y
+    target_locations[3][1] += GRID_STEP_SIZE;
+    target_locations[4][2] -= GRID_STEP_SIZE; // z
+    target_locations[5][2] += GRID_STEP_SIZE;
+
+    for (i = 0; i < NUM_DIRS; i++) {
+        calc_distances(target_locations[i], mic_locations, mic_distances, NUM_MIC);
+        calc_delays(mic_distances, delays[i], SOUND_SPEED, SAMPLING_RATE, NUM_MIC);
+    }
+}
+
+// Calculate weights according to the Hamming window:
+// an = 0.54+0.46cos(pi*n/N)
+// where there are 2N+1 microphones
+float *calc_weights_lr (int num_mic) {
+    float* weights = (float*) malloc(num_mic*sizeof(float));
+    int index = 0;
+    int y, z;
+
+    int half = num_mic/4;
+
+    for (z = 1; z >= -1; z -= 2) {
+        for (y = 0; y < half; y++) {
+            weights[index] = 0.54+0.46*cos(M_PI*y/half);
+            index++;
+        }
+        for (y = 0; y < half; y++) {
+            weights[index] = 0.54+0.46*cos(M_PI*(-y)/half);
+            index++;
+        }
+    }
+
+    return weights;
+}
+
+// Calculate weights according to the Hamming window:
+// an = 0.54+0.46cos(pi*n/N)
+// where there are 2N+1 microphones
+float *calc_weights_left_only (int num_mic) {
+    float* weights = (float*) malloc(num_mic*sizeof(float));
+    int index = 0;
+    int y;
+
+    int half = num_mic/2;
+
+    for (y = -half; y <= half; y++) {
+        weights[index] = 0.54+0.46*cos(M_PI*y/half);
+        index++;
+    }
+
+    return weights;
+}
+
+float *calc_weights (int hamming) {
+    if (!hamming) {
+        return NULL;
+    } else if ( (NUM_MIC%2) == 1 ) {
+        // Assume Odd numbers are only the left microphones
+        return calc_weights_left_only(NUM_MIC);
+    } else {
+        return calc_weights_lr(NUM_MIC);
+    }
+}
+
+// Calculate the energy in a signal by summing the squares of the values
+float calculate_energy(float* samples, int num_samples) {
+    int i;
+    float sum = 0.0;
+
+    for (i=0; i<num_samples; i++) {
+        sum += (samples[i]*samples[i]);
+    }
+
+    return sum;
+}
+
+/******************************  BEAMFORMING *************************/
+
+// Output a beamformed one-channel sample for the sample in rows[max_delay],
+// where rows[0 .. max_delay) holds the samples preceding it
+float do_beamforming(const struct PreprocessedDelays preprocessed_delays[],
+                     const float (*rows)[NUM_MIC], const float* weights) {
+    int i;
+    float sum=0;
+    float interpolated_value;
+
+    // add up all the num_mic delayed samples
+    for (i=0; i<NUM_MIC; i++) {
+        interpolated_value = INTERPOLATE(rows[preprocessed_delays[i].low][i],
+                                         rows[preprocessed_delays[i].high][i],
+                                         preprocessed_delays[i].offset);
+
+        // If we have microphone weights, multiply the value by the weight
+        if (weights != NULL) {
+            sum+=(interpolated_value*weights[i]);
+        } else {
+            sum+=interpolated_value;
+        }
+    }
+
+    return sum;
+}
+
+// Beamform the samples rows[m .. m+n), normalized by the number of
+// microphones
+void beamform(const struct PreprocessedDelays *prep, const float (*rows)[NUM_MIC],
+              int n, const float *weights, float *out) {
+    int i;
+
+    for (i=0; i<n; i++) {
+        out[i] = do_beamforming(prep, rows+i, weights)/NUM_MIC;
+    }
+}
+
+/******************************  TASKS *************************/
+
+// A window of samples, preceded by max_delay samples of history
+struct Window {
+    int n;
+    float rows[MAX_DELAY+CHUNK][NUM_MIC];
+};
+
+struct Beams {
+    float value[NUM_ANGLES][ANGLE_ENERGY_WINDOW_SIZE];
+};
+
+struct Beam {
+    float value[CHUNK];
+};
+
+// The results of the previous window are kept, as in src_c, because the
+// energy is calculated over a full window, also for the last one
+struct FarField {
+    float results[NUM_ANGLES][ANGLE_ENERGY_WINDOW_SIZE];
+    float time_index;
+};
+
+struct SinglePos {
+    FILE *output_fp;
+    float time_index;
+};
+
+// Read-only parameters of the beamforming tasks
+struct Beamformer {
+    struct PreprocessedDelays prep[NUM_MIC];
+    float *weights;
+};
+
+void beamform_angles_df(obj::indep<Window> w, obj::outdep<Beams> r,
+                        const Beamformer *bf) {
+    int j;
+
+    // All beams use the delays of the first angle, as in src_c
+    for (j = 0; j < NUM_ANGLES; j++) {
+        beamform(bf->prep, w->rows, w->n, bf->weights, r->value[j]);
+    }
+}
+
+void report_angles_df(obj::indep<Window> w, obj::indep<Beams> r,
+                      obj::inoutdep<FarField> s) {
+    float max_energy = 0;
+    float max_angle = 0;
+    float energy;
+    int i;
+
+    for (i = 0; i<NUM_ANGLES; i++) {
+        memcpy(s->results[i], r->value[i], w->n*sizeof(float));
+        energy = calculate_energy(s->results[i], ANGLE_ENERGY_WINDOW_SIZE);
+        if (energy>max_energy) {
+            max_energy = energy;
+            max_angle = (i-NUM_ANGLES/2)*M_PI/NUM_ANGLES;
+        }
+    }
+
+    printf("at time index %f, maximum energy was %f, occuring at angle %f (radians)\n",
+           s->time_index, max_energy, max_angle);
+
+    s->time_index += ((float)ANGLE_ENERGY_WINDOW_SIZE)/((float)SAMPLING_RATE);
+}
+
+void beamform_pos_df(obj::indep<Window> w, obj::outdep<Beam> r,
+                     const Beamformer *bf) {
+    beamform(bf->prep, w->rows, w->n, bf->weights, r->value);
+}
+
+void report_pos_df(obj::indep<Window> w, obj::indep<Beam> r,
+                   obj::inoutdep<SinglePos> s) {
+    float time_index_inc = (1.0/SAMPLING_RATE);
+    int i;
+
+    for (i = 0; i < w->n; i++) {
+        fprintf(s->output_fp,"%lf %lf\n",s->time_index, r->value[i]);
+        s->time_index += time_index_inc;
+    }
+}
+
+void beamform_dir(const struct PreprocessedDelays *prep, const float (*rows)[NUM_MIC],
+                  int n, const float *weights, float *out) {
+    beamform(prep, rows, n, weights, out);
+}
+
+/******************************  EVALUATION LOGIC *************************/
+
+FILE *open_file(char *file, const char *mode) {
+    FILE *fp;
+
+    if ((fp = fopen(file,mode)) == NULL) {
+        printf("can't open %s\n",file);
+        exit(1);
+    }
+    return fp;
+}
+
+void check_max_delay(long int max_delay) {
+    if (max_delay > MAX_DELAY) {
+        fprintf(stderr, "maximum delay %ld exceeds MAX_DELAY (%d)\n",
+                max_delay, MAX_DELAY);
+        exit(2);
+    }
+}
+
+void print_time(struct timeval *start_time) {
+    struct timeval end_time;
+    long int total_usecs;
+
+    gettimeofday(&end_time, NULL);
+    total_usecs = (end_time.tv_sec-start_time->tv_sec) * 1000000 +
+        (end_time.tv_usec-start_time->tv_usec);
+    printf("Total execution time was %f Sec.\n", ((float)total_usecs)/1000000);
+}
+
+// Seach the far_field_angles, one window at a time
+void search_far_field_angles(char* data_file, int hamming) {
+    FILE *fp;
+    float delays[NUM_ANGLES][NUM_MIC];
+    float angle;
+    long int max_delay = 0;
+    long int tmp;
+    int i;
+    int done = 0;
+    struct timeval start_time;
+    Beamformer bf;
+
+    i = 0;
+    for (angle = (-M_PI/2); angle <= (M_PI/2); angle+= (M_PI/NUM_ANGLES)) {
+        calc_far_field_delays(mic_locations, origin_location, angle,
+                              delays[i], SOUND_SPEED, SAMPLING_RATE, NUM_MIC);
+        positivize_delays(delays[i], NUM_MIC);
+        i++;
+    }
+
+    // Determine the maximum of all delays
+    for (i = 0; i<NUM_ANGLES; i++) {
+        tmp = find_max_in_arr (delays[i], NUM_MIC);
+        if (tmp > max_delay) {
+            max_delay = tmp;
+        }
+    }
+    check_max_delay(max_delay);
+
+    preprocess_delays(bf.prep, delays[0]);
+    bf.weights = calc_weights(hamming);
+
+    fp = open_file(data_file,"r");
+
+    History hist(max_delay);
+    obj::object_t<FarField> state;
+    memset(state->results, 0, sizeof(state->results));
+    state->time_index = 0;
+
+    gettimeofday(&start_time, NULL);
+
+    while (done == 0) {
+        obj::object_t<Window> w;
+        obj::object_t<Beams> r;
+
+        // The first max_delay-1 samples of each window are not beamformed
+        if (prime_history(fp, &hist)) {
+            w->n = read_window(fp, &hist, w->rows, ANGLE_ENERGY_WINDOW_SIZE);
+            done = w->n < ANGLE_ENERGY_WINDOW_SIZE;
+        } else {
+            w->n = 0;
+            done = 1;
+        }
+
+        spawn(beamform_angles_df, (obj::indep<Window>)w,
+              (obj::outdep<Beams>)r, (const Beamformer *)&bf);
+        spawn(report_angles_df, (obj::indep<Window>)w,
+              (obj::indep<Beams>)r, (obj::inoutdep<FarField>)state);
+    }
+    ssync();
+
+    print_time(&start_time);
+    fclose(fp);
+}
+
+void calc_single_pos(float source_location[3], float mic_locations[NUM_MIC][3], int hamming, char* data_file, char* output_file) {
+    float mic_distances[NUM_MIC];
+    float delays[NUM_MIC];
+    long int max_delay;
+    FILE *fp;
+    int n;
+    struct timeval start_time;
+    Beamformer bf;
+
+    // Calculate distances from source to each of mics
+    calc_distances(source_location, mic_locations, mic_distances, NUM_MIC);
+    calc_delays(mic_distances, delays, SOUND_SPEED, SAMPLING_RATE, NUM_MIC);
+    adjust_delays(delays, NUM_MIC);
+
+    max_delay = find_max_in_arr (delays, NUM_MIC);
+    check_max_delay(max_delay);
+
+    preprocess_delays(bf.prep, delays);
+    bf.weights = calc_weights(hamming);
+
+    obj::object_t<SinglePos> state;
+    state->output_fp = open_file(output_file,"w");
+    state->time_index = 0;
+    fp = open_file(data_file,"r");
+
+    History hist(max_delay);
+
+    gettimeofday(&start_time, NULL);
+
+    if (prime_history(fp, &hist)) {
+        do {
+            obj::object_t<Window> w;
+            obj::object_t<Beam> r;
+
+            n = w->n = read_window(fp, &hist, w->rows, CHUNK);
+            spawn(beamform_pos_df, (obj::indep<Window>)w,
+                  (obj::outdep<Beam>)r, (const Beamformer *)&bf);
+            spawn(report_pos_df, (obj::indep<Window>)w,
+                  (obj::indep<Beam>)r, (obj::inoutdep<SinglePos>)state);
+        } while (n == CHUNK);
+        ssync();
+    }
+
+    print_time(&start_time);
+    fclose(fp);
+    fclose(state->output_fp);
+}
+
+// Search along a grid of points, each time perturbing each of the x,
+// y, and z coordinates, and focusing on the point with the maximum
+// energy. Each window depends on the location found in the previous one,
+// hence only the directions around a location are beamformed in parallel.
+void search_grid(float initial_location[3], char* data_file, int hamming) {
+    FILE *fp;
+    float delays[NUM_DIRS][NUM_MIC];
+    struct PreprocessedDelays prep[NUM_MIC];
+    float target_locations[NUM_DIRS][3];
+    float current_location[3];
+    float *beamform_results[NUM_DIRS];
+    float (*rows)[NUM_MIC];
+    float *weights = calc_weights(hamming);
+    float energy;
+    float max_energy = 0;
+    int max_dir = NUM_DIRS-1;
+    long int max_delay;
+    long int tmp;
+    int i, n;
+    int done = 0;
+    struct timeval start_time;
+
+    fp = open_file(data_file,"r");
+
+    // Initialize the results array
+    for (i=0; i<NUM_DIRS; i++) {
+        beamform_results[i] = (float*) calloc(GRID_ENERGY_WINDOW_SIZE, sizeof(float));
+    }
+    rows = (float (*)[NUM_MIC]) malloc((MAX_DELAY+GRID_ENERGY_WINDOW_SIZE)*sizeof(rows[0]));
+
+    memcpy(current_location, initial_location, 3*sizeof(float));
+    printf("Starting reference position is :(%f,%f,%f)\n",current_location[0],current_location[1],current_location[2]);
+
+    gettimeofday(&start_time, NULL);
+
+    while (done == 0) {
+        calc_target_cube_delays(current_location, target_locations, delays);
+
+        // Determine the maximum of all delays
+        max_delay = 0;
+        for (i = 0; i<NUM_DIRS; i++) {
+            tmp = find_max_in_arr (delays[i], NUM_MIC);
+            if (tmp > max_delay) {
+                max_delay = tmp;
+            }
+        }
+        check_max_delay(max_delay);
+
+        // All directions use the delays of the first one, as in src_c
+        preprocess_delays(prep, delays[0]);
+
+        // The queue is cleared for every location
+        History hist(max_delay);
+        if (prime_history(fp, &hist)) {
+            n = read_window(fp, &hist, rows, GRID_ENERGY_WINDOW_SIZE);
+            done = n < GRID_ENERGY_WINDOW_SIZE;
+
+            for (i = 0; i < NUM_DIRS; i++) {
+                spawn(beamform_dir, (const struct PreprocessedDelays *)prep,
+                      (const float (*)[NUM_MIC])rows, n,
+                      (const float *)weights, beamform_results[i]);
+            }
+            ssync();
+        } else {
+            done = 1;
+        }
+
+        // Figure out which position has the max energy
+        for (i = 0; i<NUM_DIRS; i++) {
+            energy = calculate_energy(beamform_results[i], GRID_ENERGY_WINDOW_SIZE);
+            if (energy>max_energy) {
+                max_energy = energy;
+                max_dir = i;
+            }
+        }
+
+        // Adjust the current location to the location with the maximum energy
+        memcpy(current_location, target_locations[max_dir], 3*sizeof(float));
+    }
+
+    print_time(&start_time);
+    fclose(fp);
+}
+
+void print_usage () {
+    fprintf (stderr, "Usage: delay_and_sum [options]\n\n");
+    fprintf (stderr,"General options\n");
+    fprintf (stderr,"  -data_file <filename>       Data file to get input from\n");
+    fprintf (stderr,"  -output_file <filename>     File to output result to\n");
+    fprintf (stderr,"  -search_far_field           Search far field angles from -90 to +90 degrees\n");
+    fprintf (stderr,"  -hill_climb                 Search for maximum energy via hill-climbing\n");
+    fprintf (stderr,"  -hamming                    Apply hamming window weighing to microphones\n");
+}
+
+int main (int argc, char* argv[]) {
+    char *data_file=NULL;
+    char *output_file=NULL;
+    int i;
+    char* key;
+
+    char search_far_field = 0;
+    char hill_climb = 0;
+    char hamming = 0;
+
+    if (argc>1) {
+        if (strstr(argv[1], "-h")) {
+            print_usage();
+            exit(1);
+        } else {
+            for (i=1;i<argc;i++) {
+                key = argv[i];
+                if (strcmp(key, "-data_file") == 0) {
+                    data_file = (char *) strdup(argv[++i]);
+                } else if (strcmp(key, "-output_file") == 0) {
+                    output_file = (char *) strdup(argv[++i]);
+                } else if (strcmp(key, "-search_far_field") == 0) {
+                    search_far_field = 1;
+                } else if (strcmp(key, "-hill_climb") == 0) {
+                    hill_climb = 1;
+                } else if (strcmp(key, "-hamming") == 0) {
+                    hamming = 1;
+                } else {
+                    fprintf (stderr, "Error: unknown option: %s\n",key);
+                    print_usage();
+                    exit(1);
+                }
+            }
+        }
+    }
+
+    if (!data_file) {
+        fprintf (stderr, "You must specify a data file\n");
+        print_usage();
+        exit(1);
+    }
+
+    if (search_far_field == 1) {
+        run(search_far_field_angles, data_file, (int)hamming);
+    } else if (hill_climb == 1) {
+        run(search_grid, source_location, data_file, (int)hamming);
+    } else {
+        if (!output_file) {
+            fprintf (stderr, "You must specify an output file\n");
+            print_usage();
+            exit(1);
+        }
+        run(calc_single_pos, source_location, mic_locations, (int)hamming,
+            data_file, output_file);
+    }
+
+    return 0;
+}
@@ -532,6 +532,7 @@ static void compressStreamCilk ( FILE *stream, FILE *zStream )
 extern "C++"
 {
   static void compressStreamWFO ( FILE *stream, FILE *zStream );
+  static Bool uncompressStreamWFO ( FILE *zStream, FILE *stream );
 }
 
 static void compressStreamWFO ( FILE *stream, FILE *zStream )
@@ -557,6 +558,62 @@ static void compressStreamWFO ( FILE *stream, FILE *zStream )
     }
 }
 
+/* Falls back to uncompressStream() when the input cannot be mapped in
+   memory or is not a bzip2 file at all. */
+static Bool uncompressStreamWFO ( FILE *zStream, FILE *stream )
+{
+    int streams = 0;
+    int error = BZ_STREAM_ERROR;
+    if (!smallMode) {
+        SET_BINARY_MODE(stream);
+        SET_BINARY_MODE(zStream);
+        error = run( BZ2_decompressFileWFO, fileno(zStream), stream, (int)verbosity, &streams );
+    }
+    if (error == BZ_STREAM_ERROR || (error == BZ_DATA_ERROR_MAGIC && streams == 0))
+        return uncompressStream ( zStream, stream );
+
+    switch (error) {
+    case BZ_OK:
+        break;
+    case BZ_DATA_ERROR_MAGIC:
+        if (zStream != stdin) fclose(zStream);
+        if (stream != stdout) fclose(stream);
+        if (noisy)
+            fprintf ( stderr,
+                      "\n%s: %s: trailing garbage after EOF ignored\n",
+                      progName, inName );
+        return True;
+    case BZ_CONFIG_ERROR:
+        configError(); break;
+    case BZ_IO_ERROR:
+        ioError(); break;
+    case BZ_DATA_ERROR:
+        crcError(); break;
+    case BZ_MEM_ERROR:
+        outOfMemory(); break;
+    case BZ_UNEXPECTED_EOF:
+        compressedStreamEOF(); break;
+    default:
+        panic ( "decompress:unexpected error" );
+    }
+
+    if (ferror(zStream)) ioError();
+    if (stream != stdout) {
+        Int32 fd = fileno ( stream );
+        if (fd < 0) ioError();
+        applySavedFileAttrToOutputFile ( fd );
+    }
+    if (fclose ( zStream ) == EOF) ioError();
+    if (ferror(stream) || fflush ( stream ) != 0) ioError();
+    if (stream != stdout) {
+        if (fclose ( stream ) == EOF) ioError();
+        outputHandleJustInCase = NULL;
+    }
+    outputHandleJustInCase = NULL;
+    if (verbosity >= 2) fprintf ( stderr, "\n    " );
+    return True;
+}
+
 #endif /* BZLIB_WFO */
 
 
@@ -1611,7 +1668,12 @@ void uncompress ( Char *name )
    /*--- Now the input and output handles are sane.  Do the Biz. ---*/
    outputHandleJustInCase = outStr;
    deleteOutputOnInterrupt = True;
-   magicNumberOK = uncompressStream ( inStr, outStr );
+#ifdef BZLIB_WFO
+   if (parallel_wfo)
+     magicNumberOK = uncompressStreamWFO ( inStr, outStr );
+   else
+#endif
+     magicNumberOK = uncompressStream ( inStr, outStr );
    outputHandleJustInCase = NULL;
 
    /*--- If there was an I/O error, we won't get here. ---*/
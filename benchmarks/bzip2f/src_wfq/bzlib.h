@@ -315,6 +315,11 @@ extern "C++"
       int   blockSize100k, 
       int   verbosity, 
       int   workFactor) throw();
+  int BZ_API(BZ2_decompressFileWFO) (
+      int   in,
+      FILE *out,
+      int   verbosity,
+      int  *streams) throw();
 }
 #endif
 #endif
@@ -1406,6 +1406,7 @@ int BZ2_compressFileCilk(int fd, FILE *out,
 #endif
 
 #include "wf_interface.h"
+#include "wf_pipeline.h"
 
 /* Flush all full bytes.  The caller will deal with the extra 0-7 bits. */
 extern "C" { static void bsFinishWriteWFO(EState* s); }
@@ -1660,7 +1661,6 @@ void writer::reduce(writer *right)
     return;
 }
 
-static void BZ2_compressBlockWFO(EState *s, obj::pushdep<EState*>);
 static void BZ2_compressBlockWFOr(EState *s,
 				  const unsigned char *begin,
 				  const unsigned char *end,
@@ -1744,13 +1744,6 @@ BZ2_compressBlockWFO_leaf(EState *s)
     bsFinishWriteWFO(s);
 }
 
-void
-BZ2_compressBlockWFO(EState *s, obj::pushdep<EState *> out)
-{
-    leaf_call( BZ2_compressBlockWFO_leaf, s );
-    out.push( s );
-}
-
 static int
 BZ2_writeBlockWFO_leaf(EState *s, writer *output_) {
     writer &output = *output_;
@@ -1776,69 +1769,67 @@ BZ2_writeBlockWFO(EState *s, writer *output_ ) {
 */
 
 
-int
-BZ2_compressFileWFO_stage1(FILE *in,
-			   int blockSize100k,
-			   int verbosity,
-			   int workFactor,
-			   obj::pushdep<EState*> queue,
-			   off_t * bytes_in_p) throw()
-{
-    off_t bytes_in = 0;
-
-    /* This can not be a cilk_for loop because block boundaries
-       are not known in advance and there are interblock dependencies
-       in the parse stage.  There is also a memory use penalty for
-       highly out of order execution.
-
-       Because nearly every spawn is stolen, no attempt is made to
-       avoid reallocation when a call returns normally.
-
-       The cost of a steal is small compared to the cost of
-       compressing a block. */
-    int prev_state_char = 256, prev_state_len = 0;
-    while (!feof(in)) {
-
-	if (ferror(in))
-	    return BZ_IO_ERROR;
-
-	// struct EState *s = leaf_call( BZ2_bzCompressInitWFO, blockSize100k, verbosity, workFactor);
-	struct EState *s = BZ2_bzCompressInitWFO( blockSize100k, verbosity, workFactor);
-	s->state_in_ch = prev_state_char;
-	s->state_in_len = prev_state_len;
-
-	/* add_char_to_block returns false on EOF */
-	// while (leaf_call( BZ2_add_char_to_block, s, getc(in)))
-	while (BZ2_add_char_to_block(s, getc(in)))
-	    bytes_in++;
-
-	prev_state_char = s->state_in_ch;
-	prev_state_len = s->state_in_len;
-	/* TODO: conditional sync here if too out of order */
-	if (s->nblock) {
-	    queue.push( s );
-	} else {
+/* The filters of the BZ2_compressFileWFO pipeline: blocks are read
+   serially, compressed in parallel and written in order. */
+struct read_block {
+    FILE *in;
+    int blockSize100k;
+    int verbosity;
+    int workFactor;
+    int prev_state_char, prev_state_len;
+    off_t *bytes_in;
+    int *status;
+
+    bool operator () (EState *&s)
+    {
+	/* This can not be a parallel loop because block boundaries
+	   are not known in advance and there are interblock dependencies
+	   in the parse stage. */
+	while (!feof(in)) {
+
+	    if (ferror(in)) {
+		*status = BZ_IO_ERROR;
+		return false;
+	    }
+
+	    s = BZ2_bzCompressInitWFO( blockSize100k, verbosity, workFactor);
+	    s->state_in_ch = prev_state_char;
+	    s->state_in_len = prev_state_len;
+
+	    /* add_char_to_block returns false on EOF */
+	    while (BZ2_add_char_to_block(s, getc(in)))
+		(*bytes_in)++;
+
+	    prev_state_char = s->state_in_ch;
+	    prev_state_len = s->state_in_len;
+	    if (s->nblock)
+		return true;
+
 	    free(s->arr1);
 	    free(s->arr2);
 	    free(s->ftab);
 	    free(s);
 	}
+	return false;
     }
+};
 
-    *bytes_in_p = bytes_in;
+struct compress_block {
+    EState * operator () (EState *s)
+    {
+	leaf_call( BZ2_compressBlockWFO_leaf, s );
+	return s;
+    }
+};
 
-    return BZ_OK;
-}
+struct write_block {
+    writer *output;
 
-void
-BZ2_compressFileWFO_stage2(obj::popdep<EState *> in, obj::pushdep<EState *>out)
-{
-    while( !in.empty() ) {
-	EState * s = in.pop();
-	spawn( BZ2_compressBlockWFO, s, out );
+    void operator () (EState *s)
+    {
+	leaf_call( BZ2_writeBlockWFO_leaf, s, output );
     }
-    ssync();
-}
+};
 
 static void
 BZ2_compressFileWFO_stage3(obj::popdep<EState *> in, writer *output )
@@ -1868,21 +1859,16 @@ BZ2_compressFileWFO (FILE *in, FILE *out,
     {
         writer output(out);
         off_t bytes_in = 0;
-	obj::hyperqueue<EState *> queue1, queue2;
-	chandle<int> ret;
-
-	spawn( BZ2_compressFileWFO_stage1, ret,
-	       in, blockSize100k, verbosity, workFactor,
-	       (obj::pushdep<EState*>) queue1, &bytes_in);
-
-	spawn( BZ2_compressFileWFO_stage2,
-	       (obj::popdep<EState*>) queue1,
-	       (obj::pushdep<EState*>) queue2 );
-
-	spawn( BZ2_compressFileWFO_stage3,
-	       (obj::popdep<EState*>) queue2, &output );
-
-        ssync();
+	int ret = BZ_OK;
+	read_block reader = { in, blockSize100k, verbosity, workFactor,
+			      256, 0, &bytes_in, &ret };
+	write_block w = { &output };
+
+	obj::parallel_pipeline( nthreads,
+	    obj::make_filter<void, EState *>( obj::serial_in_order, reader ),
+	    obj::make_filter<EState *, EState *>( obj::parallel,
+						  compress_block() ),
+	    obj::make_filter<EState *, void>( obj::serial_in_order, w ) );
 
 	if( ret != BZ_OK )
 	    return ret;
@@ -0,0 +1,453 @@
+/*-------------------------------------------------------------*/
+/*--- Parallel decompression                                ---*/
+/*---                                        decompress_wfo.c ---*/
+/*-------------------------------------------------------------*/
+
+/* ------------------------------------------------------------------
+   This file is part of bzip2/libbzip2, a program and library for
+   lossless, block-sorting data compression.
+
+   bzip2/libbzip2 version 1.0.5 of 10 December 2007
+   Copyright (C) 1996-2007 Julian Seward <jseward@bzip.org>
+
+   Please read the WARNING, DISCLAIMER and PATENTS sections in the
+   README file.
+
+   This program is released under the terms of the license contained
+   in the file LICENSE.
+   ------------------------------------------------------------------ */
+
+/* Blocks are not byte-aligned and do not record their length, but every
+   block starts with the 48-bit magic number 0x314159265359 and every
+   stream ends with 0x177245385090. The input is mapped in memory and
+   scanned serially for these numbers. Every block found is copied into
+   a stream of its own (header, block, trailer) and decoded by a task
+   with the sequential decoder. The decoded blocks are written in order.
+
+   The magic numbers may also occur inside the compressed data. Such a
+   false boundary causes the blocks around it to fail to decode, or the
+   combined CRC of the stream to mismatch. When anything goes wrong, the
+   remainder of the input is decoded serially, starting at the stream
+   holding the problem and skipping the output written already. This
+   path reports the errors exactly as the serial decoder does. */
+
+#include "bzlib_private.h"
+
+#ifdef BZLIB_WFO
+
+#ifndef __cplusplus
+#error "WFO mode requires a C++ compiler"
+#endif
+
+#include <errno.h>
+#include <inttypes.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+#include "wf_interface.h"
+#include "wf_pipeline.h"
+
+static const uint64_t block_magic = 0x314159265359ULL;
+static const uint64_t eos_magic = 0x177245385090ULL;
+
+/* Read n <= 57 bits at bit offset pos. Bytes beyond size read as 0. */
+static inline uint64_t
+get_bits(const unsigned char *data, off_t size, uint64_t pos, int n)
+{
+    uint64_t v = 0;
+    for (off_t i = pos >> 3; i < off_t(pos >> 3) + 8; ++i)
+        v = (v << 8) | (i < size ? data[i] : 0);
+    return (v >> (64 - (pos & 7) - n)) & ((uint64_t(1) << n) - 1);
+}
+
+/* anchor[c] has bit s set when byte c is the third byte of the input
+   overlapping a magic number that starts at bit s of a byte. This byte
+   is covered entirely by the magic number for any s. */
+static unsigned char anchor[256];
+
+static void
+init_anchor()
+{
+    for (int s = 0; s < 8; ++s) {
+        anchor[(block_magic >> (24 + s)) & 0xff] |= 1 << s;
+        anchor[(eos_magic >> (24 + s)) & 0xff] |= 1 << s;
+    }
+}
+
+/* Find the first magic number at or after bit pos. Returns the bit
+   offset of the magic number, or limit when there is none. */
+static uint64_t
+find_magic(const unsigned char *data, off_t size, uint64_t pos,
+           uint64_t limit)
+{
+    for (off_t i = (pos >> 3) + 2; i < size; ++i) {
+        unsigned int m = anchor[data[i]];
+        for (int s = 0; m != 0; ++s, m >>= 1) {
+            uint64_t at = uint64_t(i - 2) * 8 + s;
+            if (!(m & 1) || at < pos)
+                continue;
+            if (at + 48 > limit)
+                return limit;
+            uint64_t v = get_bits(data, size, at, 48);
+            if (v == block_magic || v == eos_magic)
+                return at;
+        }
+    }
+    return limit;
+}
+
+/* An item in the decompression pipeline */
+enum dblock_kind {
+    dk_block,      /* a block to decode */
+    dk_stream_end, /* the end of a stream */
+    dk_fail        /* decode serially from the start of the stream */
+};
+
+struct dblock {
+    dblock_kind kind;
+    off_t stream;        /* byte offset of the stream */
+    int level;           /* block size of the stream */
+    uint64_t begin, end; /* bit offsets of the block */
+    uint32_t crc;        /* block CRC, or combined CRC at stream end */
+    unsigned char *data; /* decoded block */
+    size_t length;
+    bool ok;
+};
+
+/* Decode one block by wrapping it in a stream of its own. The sequential
+   decoder checks the block CRC. Runs as a task: verbosity is dropped to
+   keep messages of concurrent blocks apart. */
+static void
+decode_block(const unsigned char *in, dblock *b)
+{
+    uint64_t nbits = b->end - b->begin;
+    size_t nbytes = (nbits + 7) / 8;
+    unsigned char *z = (unsigned char *)malloc(4 + nbytes + 11);
+    if (!z)
+        return;
+
+    z[0] = BZ_HDR_B;
+    z[1] = BZ_HDR_Z;
+    z[2] = BZ_HDR_h;
+    z[3] = BZ_HDR_0 + b->level;
+
+    /* Copy the block shifted to a byte boundary */
+    unsigned char *zb = z + 4;
+    const unsigned char *p = in + (b->begin >> 3);
+    const int shift = b->begin & 7;
+    if (shift == 0) {
+        memcpy(zb, p, nbytes);
+    } else {
+        const size_t avail = (b->end + 7) / 8 - (b->begin >> 3);
+        for (size_t i = 0; i < nbytes; ++i) {
+            unsigned char next = i + 1 < avail ? p[i+1] : 0;
+            zb[i] = (unsigned char)((p[i] << shift) | (next >> (8 - shift)));
+        }
+    }
+    memset(zb + nbytes, 0, 11);
+    if (nbits & 7)
+        zb[nbytes-1] &= (unsigned char)(0xff00 >> (nbits & 7));
+
+    /* Append the trailer. The combined CRC of a single block is its CRC. */
+    uint64_t trailer[2] = { eos_magic, b->crc };
+    int widths[2] = { 48, 32 };
+    uint64_t pos = nbits;
+    for (int t = 0; t < 2; ++t) {
+        for (int i = widths[t] - 1; i >= 0; --i, ++pos)
+            if ((trailer[t] >> i) & 1)
+                zb[pos >> 3] |= (unsigned char)(0x80 >> (pos & 7));
+    }
+    size_t zlength = 4 + (pos + 7) / 8;
+
+    bz_stream strm;
+    strm.bzalloc = NULL;
+    strm.bzfree = NULL;
+    strm.opaque = NULL;
+    if (BZ2_bzDecompressInit(&strm, 0, 0) != BZ_OK) {
+        free(z);
+        return;
+    }
+    strm.next_in = (char *)z;
+    strm.avail_in = zlength;
+
+    /* Run-length decoding may expand a block beyond the block size */
+    size_t capacity = b->level * 100000;
+    size_t length = 0;
+    unsigned char *out = (unsigned char *)malloc(capacity);
+    while (out) {
+        strm.next_out = (char *)out + length;
+        strm.avail_out = capacity - length;
+        int ret = BZ2_bzDecompress(&strm);
+        length = capacity - strm.avail_out;
+        if (ret == BZ_STREAM_END) {
+            b->ok = strm.avail_in == 0;
+            break;
+        }
+        if (ret != BZ_OK || strm.avail_out != 0)
+            break;
+        capacity *= 2;
+        unsigned char *grown = (unsigned char *)realloc(out, capacity);
+        if (!grown)
+            break;
+        out = grown;
+    }
+    BZ2_bzDecompressEnd(&strm);
+    free(z);
+
+    if (b->ok) {
+        b->data = out;
+        b->length = length;
+    } else {
+        free(out);
+    }
+}
+
+/* The filters of the BZ2_decompressFileWFO pipeline: blocks are found
+   serially, decoded in parallel and written in order. */
+struct scan_blocks {
+    const unsigned char *data;
+    off_t size;
+    off_t stream;   /* byte offset of the current stream */
+    int level;
+    uint64_t pos;   /* bit offset of the next magic number */
+    bool at_header; /* pos is at a stream header */
+    bool done;
+    volatile bool *abort;
+
+    bool operator () (dblock *&b)
+    {
+        if (done || *abort)
+            return false;
+
+        const uint64_t limit = uint64_t(size) * 8;
+        if (at_header) {
+            /* End of input, after at least one stream */
+            if (stream == size && stream > 0)
+                return false;
+            const unsigned char *h = data + stream;
+            if (size - stream < 4 || h[0] != BZ_HDR_B || h[1] != BZ_HDR_Z
+                || h[2] != BZ_HDR_h
+                || h[3] < BZ_HDR_0 + 1 || h[3] > BZ_HDR_0 + 9)
+                return failed(b);
+            level = h[3] - BZ_HDR_0;
+            pos = uint64_t(stream + 4) * 8;
+            at_header = false;
+        }
+
+        /* A magic number and a CRC */
+        if (pos + 80 > limit)
+            return failed(b);
+        uint64_t magic = get_bits(data, size, pos, 48);
+        uint32_t crc = get_bits(data, size, pos + 48, 32);
+        if (magic == block_magic) {
+            uint64_t end = find_magic(data, size, pos + 48, limit);
+            if (end == limit)
+                return failed(b);
+            b = item(dk_block, crc);
+            b->begin = pos;
+            b->end = end;
+            pos = end;
+        } else if (magic == eos_magic) {
+            b = item(dk_stream_end, crc);
+            stream = (pos + 80 + 7) / 8;
+            at_header = true;
+        } else {
+            return failed(b);
+        }
+        return true;
+    }
+
+    dblock *item(dblock_kind kind, uint32_t crc)
+    {
+        dblock *b = new dblock;
+        b->kind = kind;
+        b->stream = stream;
+        b->level = level;
+        b->begin = b->end = 0;
+        b->crc = crc;
+        b->data = 0;
+        b->length = 0;
+        b->ok = false;
+        return b;
+    }
+
+    /* Hand the current stream to the serial decoder */
+    bool failed(dblock *&b)
+    {
+        b = item(dk_fail, 0);
+        done = true;
+        return true;
+    }
+};
+
+struct decode {
+    const unsigned char *data;
+    volatile bool *abort;
+
+    dblock *operator () (dblock *b)
+    {
+        if (b->kind == dk_block && !*abort)
+            leaf_call(decode_block, data, b);
+        return b;
+    }
+};
+
+struct write_blocks {
+    FILE *out;
+    volatile bool *abort;
+    uint32_t crc;         /* combined CRC of the current stream */
+    off_t written;        /* bytes written for the current stream */
+    off_t *fallback;      /* serial decoding from here, -1 if none */
+    off_t *skip;          /* bytes to skip by the serial decoder */
+    int *streams;
+    long long *bytes_out;
+
+    void operator () (dblock *b)
+    {
+        if (*fallback < 0) {
+            if (b->kind == dk_block && b->ok) {
+                fwrite(b->data, 1, b->length, out);
+                crc = ((crc << 1) | (crc >> 31)) ^ b->crc;
+                written += b->length;
+                *bytes_out += b->length;
+            } else if (b->kind == dk_stream_end && b->crc == crc) {
+                (*streams)++;
+                crc = 0;
+                written = 0;
+            } else {
+                *abort = true;
+                *fallback = b->stream;
+                *skip = written;
+            }
+        }
+        free(b->data);
+        delete b;
+    }
+};
+
+/* Decode streams from memory, dropping the first skip bytes of output.
+   Trailing garbage is reported as BZ_DATA_ERROR_MAGIC, as by
+   BZ2_bzRead(). */
+static int
+decode_serial(const unsigned char *data, off_t size, off_t skip, FILE *out,
+              int verbosity, int *streams, long long *bytes_out)
+{
+    char obuf[5000];
+
+    while (true) {
+        bz_stream strm;
+        strm.bzalloc = NULL;
+        strm.bzfree = NULL;
+        strm.opaque = NULL;
+        int ret = BZ2_bzDecompressInit(&strm, verbosity, 0);
+        if (ret != BZ_OK)
+            return ret;
+
+        strm.avail_in = 0;
+        do {
+            if (strm.avail_in == 0 && size > 0) {
+                unsigned int n = size < (1 << 30) ? size : (1 << 30);
+                strm.next_in = (char *)data;
+                strm.avail_in = n;
+                data += n;
+                size -= n;
+            }
+            strm.next_out = obuf;
+            strm.avail_out = sizeof obuf;
+            ret = BZ2_bzDecompress(&strm);
+            if (ret == BZ_OK && strm.avail_in == 0 && size == 0
+                && strm.avail_out > 0)
+                ret = BZ_UNEXPECTED_EOF;
+            if (ret != BZ_OK && ret != BZ_STREAM_END)
+                break;
+            /* The output of a failing call is dropped, as by BZ2_bzRead() */
+            off_t n = sizeof obuf - strm.avail_out;
+            if (skip >= n) {
+                skip -= n;
+            } else {
+                fwrite(obuf + skip, 1, n - skip, out);
+                *bytes_out += n - skip;
+                skip = 0;
+            }
+        } while (ret == BZ_OK && !ferror(out));
+
+        /* Unused input returns to the start of the next stream */
+        data -= strm.avail_in;
+        size += strm.avail_in;
+        BZ2_bzDecompressEnd(&strm);
+
+        if (ferror(out))
+            return BZ_IO_ERROR;
+        if (ret != BZ_STREAM_END)
+            return ret;
+        (*streams)++;
+        if (size == 0)
+            return BZ_OK;
+    }
+}
+
+int
+BZ2_decompressFileWFO(int fd, FILE *out, int verbosity, int *streams) throw()
+{
+    struct stat st;
+
+    if (fstat(fd, &st) != 0)
+        return BZ_IO_ERROR;
+
+    const off_t size = st.st_size;
+    void *addrv = mmap(0, size, PROT_READ, MAP_SHARED, fd, 0);
+    if (addrv == MAP_FAILED)
+    {
+        if (verbosity)
+            VPrintf1("Unable to map input as stream (%s)\n    ", strerror(errno));
+        return BZ_STREAM_ERROR;
+    }
+    const unsigned char *addr = (const unsigned char *)addrv;
+    init_anchor();
+
+    volatile bool abort = false;
+    off_t fallback = -1, skip = 0;
+    long long bytes_out = 0;
+    *streams = 0;
+
+    scan_blocks scanner = { addr, size, 0, 0, 0, true, false, &abort };
+    decode decoder = { addr, &abort };
+    write_blocks w = { out, &abort, 0, 0, &fallback, &skip, streams,
+                       &bytes_out };
+
+    /* The token limit bounds the blocks that are decoded but not yet
+       written: one being decoded per worker and as many waiting for
+       earlier blocks. */
+    obj::parallel_pipeline( 2 * nthreads,
+        obj::make_filter<void, dblock *>( obj::serial_in_order, scanner ),
+        obj::make_filter<dblock *, dblock *>( obj::parallel, decoder ),
+        obj::make_filter<dblock *, void>( obj::serial_in_order, w ) );
+
+    int ret = BZ_OK;
+    if (fallback >= 0) {
+        if (verbosity >= 2)
+            VPrintf2("\n    serial decompression from offset %lld, "
+                     "skipping %lld bytes\n    ",
+                     (long long)fallback, (long long)skip);
+        ret = decode_serial(addr + fallback, size - fallback, skip, out,
+                            verbosity, streams, &bytes_out);
+    }
+
+    munmap(addrv, size);
+
+    if (verbosity >= 2)
+        VPrintf1("\n    %lld bytes out\n    ", bytes_out);
+
+    leaf_call(fflush, out);
+
+    if (ret == BZ_OK && ferror(out))
+        ret = BZ_IO_ERROR;
+    return ret;
+}
+
+#endif /* BZLIB_WFO */
+
+/*-------------------------------------------------------------*/
+/*--- end                                    decompress_wfo.c ---*/
+/*-------------------------------------------------------------*/
@@ -180,12 +180,13 @@ void compute(pp_time_t *timer, unsigned long NB, long DIM, object_t<float[]> A[]
     }
 
     // Cholesky Factorization of A[j,j]
-    spawn(smpSs_spotrf_tile, (binout)A[j+DIM*j], NB);
+    // The panel tasks are on the critical path: schedule them first
+    spawn_prio(2, smpSs_spotrf_tile, (binout)A[j+DIM*j], NB);
       
     for (long i = j+1; i < DIM; i++)
     {
       // A[i,j] <- A[i,j] = X * (A[j,j])^t
-	spawn(smpSs_strsm_tile, (bin)A[j+DIM*j], (binout)A[i+DIM*j], NB);
+	spawn_prio(1, smpSs_strsm_tile, (bin)A[j+DIM*j], (binout)A[i+DIM*j], NB);
     }
    
   }	
@@ -241,16 +242,19 @@ main(int argc, char *argv[])
 }
 
 
-static void convert_to_blocks(long NB,long DIM, long N, float *Alin, object_t<float[]> A[])
+// Allocate and convert blocks [from, to). Called by first_touch() such that
+// each block is allocated and first written by the worker that owns it.
+static void convert_to_blocks(size_t from, size_t to, long NB, long DIM, long N, float *Alin, object_t<float[]> A[])
 {
-  for (long i = 0; i < N; i++)
+  for (size_t b = from; b < to; b++)
   {
-    for (long j = 0; j < N; j++)
-    {
-	((float*)A[(j/NB)+DIM*(i/NB)])[(i%NB)*NB+j%NB] = Alin[i*N+j];
-    }
+    long bi = b / DIM, bj = b % DIM;
+    A[b] = object_t<float[]>(NB*NB); // resize
+    float * blk = (float*)A[b];
+    for (long ii = 0; ii < NB; ii++)
+      for (long jj = 0; jj < NB; jj++)
+	blk[ii*NB+jj] = Alin[(bi*NB+ii)*N+bj*NB+jj];
   }
-
 }
 
 
@@ -312,10 +316,7 @@ static void init(int argc, char **argv, unsigned long *NB_p, unsigned long *N_p,
   // for (long i = 0; i < DIM*DIM; i++)
      // A[i] = (float *) malloc(NB*NB*sizeof(float));
   A = new object_t<float[]>[DIM*DIM];
-  for (long i = 0; i < DIM*DIM; i++)
-      A[i] = object_t<float[]>(NB*NB); // resize
-
-  convert_to_blocks(NB, DIM, N, Alin, A);
+  first_touch((size_t)DIM*DIM, convert_to_blocks, NB, DIM, N, Alin, A);
   
 }
 
@@ -0,0 +1,257 @@
+/*
+* Copyright (c) 2008, BSC (Barcelon Supercomputing Center)
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in the
+*       documentation and/or other materials provided with the distribution.
+*     * Neither the name of the <organization> nor the
+*       names of its contributors may be used to endorse or promote products
+*       derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY BSC ''AS IS'' AND ANY
+* EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL <copyright holder> BE LIABLE FOR ANY
+* DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+* ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/*
+ * Tiled Cholesky factorization on a single contiguous matrix, using region
+ * dependencies instead of one object per tile. The matrix is stored
+ * column-major with leading dimension N. Tile (i,j) is the sub-array of
+ * rows i*NB..(i+1)*NB-1 and columns j*NB..(j+1)*NB-1. In the
+ * region_object_t, every matrix column is one row of length N, hence the
+ * tile is the region (j*NB, i*NB, NB, NB).
+ *
+ * This requires OBJECT_TASKGRAPH=1 (tickets).
+ *
+ * Usage: cholesky_region NB DIM [check]
+ * With check, the result is compared against a sequential spotrf.
+ */
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <time.h>
+#include "cblas.h"
+
+#define blasint int
+
+#include "wf_interface.h"
+#include "region.h"
+#include "pp_time.h"
+
+using obj::region;
+using obj::region_object_t;
+using obj::indep;
+using obj::inoutdep;
+
+typedef region_object_t<float> matrix_t;
+typedef inoutdep<region<float> > tinout;
+typedef indep<region<float> > tin;
+
+//----------------------------------------------------------------------------------------------
+
+extern "C" {
+    extern int spotrf_(unsigned char *,int *, float *, int *, int *);
+}
+
+void smpSs_spotrf_tile(tinout Adep, unsigned long NB)
+{
+unsigned char LO='L';
+int INFO;
+int nn=NB;
+int ld=Adep.get_ld();
+float * A = Adep.get_ptr();
+leaf_call(spotrf_,&LO,
+          &nn,
+          A,&ld,
+          &INFO);
+}
+
+void smpSs_sgemm_tile(tin Adep, tin Bdep, tinout Cdep, unsigned long NB)
+{
+    const float * A = Adep.get_ptr();
+    const float * B = Bdep.get_ptr();
+    float * C = Cdep.get_ptr();
+
+ // using CBLAS
+    leaf_call(cblas_sgemm,
+        CblasColMajor,
+        CblasNoTrans, CblasTrans,
+	      (blasint)NB, (blasint)NB, (blasint)NB,
+	      (float)-1.0, A, (blasint)Adep.get_ld(),
+              B, (blasint)Bdep.get_ld(),
+	      (float)1.0, C, (blasint)Cdep.get_ld());
+}
+
+void smpSs_strsm_tile(tin Tdep, tinout Bdep, unsigned long NB)
+{
+const float * T = Tdep.get_ptr();
+float * B = Bdep.get_ptr();
+
+ // using CBLAS
+leaf_call(cblas_strsm,
+        CblasColMajor,
+        CblasRight, CblasLower, CblasTrans, CblasNonUnit,
+	  (blasint)NB, (blasint)NB,
+	  (float)1.0, T, (blasint)Tdep.get_ld(),
+             B, (blasint)Bdep.get_ld());
+}
+
+void smpSs_ssyrk_tile( tin Adep, tinout Cdep, unsigned long NB)
+{
+const float * A = Adep.get_ptr();
+float * C = Cdep.get_ptr();
+
+ // using CBLAS
+leaf_call(cblas_ssyrk,
+        CblasColMajor,
+        CblasLower,CblasNoTrans,
+	    (blasint)NB, (blasint)NB,
+	  (float)-1.0, A, (blasint)Adep.get_ld(),
+	  (float)1.0, C, (blasint)Cdep.get_ld());
+}
+
+//----------------------------------------------------------------------------------------------
+
+// Tile (i,j) of the matrix
+static inline tin tile_in(matrix_t * A, unsigned long NB, long i, long j)
+{
+    return A->in(j*NB, i*NB, NB, NB);
+}
+
+static inline tinout tile_inout(matrix_t * A, unsigned long NB, long i, long j)
+{
+    return A->inout(j*NB, i*NB, NB, NB);
+}
+
+void compute(pp_time_t *timer, unsigned long NB, long DIM, matrix_t * A)
+{
+    pp_time_start(timer);
+  for (long j = 0; j < DIM; j++)
+  {
+    for (long k= 0; k< j; k++)
+    {
+      for (long i = j+1; i < DIM; i++) 
+      {
+        // A[i,j] = A[i,j] - A[i,k] * (A[j,k])^t
+	  spawn(smpSs_sgemm_tile, tile_in(A, NB, i, k), tile_in(A, NB, j, k),
+		tile_inout(A, NB, i, j), NB);
+      }
+    }
+
+    for (long i = 0; i < j; i++)
+    {
+      // A[j,j] = A[j,j] - A[j,i] * (A[j,i])^t
+	spawn(smpSs_ssyrk_tile, tile_in(A, NB, j, i), tile_inout(A, NB, j, j),
+	      NB);
+    }
+
+    // Cholesky Factorization of A[j,j]
+    // The panel tasks are on the critical path: schedule them first
+    spawn_prio(2, smpSs_spotrf_tile, tile_inout(A, NB, j, j), NB);
+      
+    for (long i = j+1; i < DIM; i++)
+    {
+      // A[i,j] <- A[i,j] = X * (A[j,j])^t
+	spawn_prio(1, smpSs_strsm_tile, tile_in(A, NB, j, j),
+		   tile_inout(A, NB, i, j), NB);
+    }
+  }	
+  ssync();
+    pp_time_end(timer);
+}
+
+//--------------------------------------------------------------------------------
+
+static void fill_random(float *Alin, long NN)
+{
+  for (long i = 0; i < NN; i++)
+  {
+    Alin[i]=((float)rand())/((float)RAND_MAX);
+  }
+}
+
+// Compare the lower triangle against a sequential factorization
+static int check(const float * A, float * Alin, long N)
+{
+  unsigned char LO='L';
+  int nn=N;
+  int INFO;
+  spotrf_(&LO, &nn, Alin, &nn, &INFO);
+
+  double err = 0;
+  for (long c = 0; c < N; c++)
+    for (long r = c; r < N; r++)
+    {
+      double d = fabs(A[c*N+r] - Alin[c*N+r]) / (fabs(Alin[c*N+r]) + 1.0);
+      if (d > err)
+	err = d;
+    }
+  printf("Max relative error = %g\n", err);
+  return err < 1e-3 ? 0 : 1;
+}
+
+int
+main(int argc, char *argv[])
+{
+  pp_time_t timer;
+  unsigned long elapsed;
+
+  memset( &timer, 0, sizeof(timer) );
+
+  if (argc!=3 && argc!=4)
+  {
+    printf("usage: %s NB DIM [check]\n",argv[0]);
+    exit(0);
+  }
+
+  unsigned long NB = atoi(argv[1]);
+  unsigned long DIM = atoi(argv[2]);
+  bool do_check = argc==4 && !strcmp(argv[3], "check");
+  long N = NB*DIM;
+  long NN = N * N;
+
+  // Same input as cholesky: Alin is the column-major matrix
+  float * Alin = (float *) malloc(NN * sizeof(float));
+  fill_random(Alin,NN);
+  for(long i=0; i<N; i++)
+  {
+    Alin[i*N + i] += N;
+  }
+
+  matrix_t * A = new matrix_t(N, N);
+  memcpy(A->get_ptr(), Alin, NN * sizeof(float));
+
+  run(compute, &timer, NB, (long)DIM, A);
+
+  elapsed = pp_time_read(&timer);
+
+// time in usecs
+  printf ("%lu;\t", elapsed);
+// perfonrmance in MFLOPS
+  printf("%d\n", (int)((0.33*N*N*N+0.5*N*N+0.17*N)/elapsed));
+  printf("Running time  = %g %s\n", pp_time_read(&timer), pp_time_unit() );
+
+  int ret = 0;
+  if (do_check)
+    ret = check(A->get_ptr(), Alin, N);
+
+  delete A;
+  free(Alin);
+
+  return ret;
+}
@@ -0,0 +1,19 @@
+#!/bin/bash
+
+# Compare the per-tile object layout (cholesky) against a single
+# contiguous matrix with region dependencies (cholesky_region).
+# Usage: ./region.sh [threads] [repeat]
+
+threads=${1:-"1 2 4 8"}
+repeat=${2:-3}
+
+echo "NB DIM threads cholesky cholesky_region"
+for flags in "32 64" "64 32" "128 16" "256 8" ; do
+    for t in $threads ; do
+	for r in `seq $repeat` ; do
+	    echo -n "$flags $t "
+	    echo -n "$(NUM_THREADS=$t ./cholesky $flags | grep Running | cut -d= -f2) "
+	    NUM_THREADS=$t ./cholesky_region $flags | grep Running | cut -d= -f2
+	done
+    done
+done
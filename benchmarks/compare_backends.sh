@@ -0,0 +1,122 @@
+#!/bin/bash
+
+# Compare the dependency-tracking backends (OBJECT_TASKGRAPH) on the
+# ubench microbenchmarks and on the src_wfo benchmarks.
+#
+# Build first, in the build directory of each benchmark:
+#     make backends
+# This creates <prog>_<backend> for every backend in BACKENDS
+# (scheduler/Makefile.flags). This script selects the backend through the
+# TASKGRAPH environment variable and prints one table with a column per
+# backend:
+#   - spawn rows: ns per spawn of an empty task, without arguments, with
+#     an outdep, and followed by ssync() (uops spawn, outdep, spawn-sync)
+#   - release rows: ns from the end of a task until all K tasks waiting on
+#     it have started (uops release-K). These need two threads, so they run
+#     with NUM_THREADS=2 when THREADS is 1. With more waiters than threads,
+#     the waiters start in turn.
+#   - ubench rows: cycles per task for a stream of tasks, from spawn to
+#     completion (ubench data_dep). nodep is the cost of a spawn, indep and
+#     outdep add the issue of one argument, and inoutdep chains every task
+#     to the previous one, so that each task also pays one release.
+#   - src_wfo rows: running time as reported by the benchmark
+#
+# Usage: ./compare_backends.sh [build-dir]
+# Environment:
+#   BACKENDS  backends to compare (default: tkt vtkt cs cg ecg ltkt)
+#   THREADS   value of NUM_THREADS (default: 1)
+#   REPEAT    repetitions, the median is reported (default: 3)
+#   TASKS     number of tasks for the data_dep programs (default: 1000000)
+
+top=${1:-$(dirname $0)}
+BACKENDS=${BACKENDS:-"tkt vtkt cs cg ecg ltkt"}
+THREADS=${THREADS:-1}
+REPEAT=${REPEAT:-3}
+TASKS=${TASKS:-1000000}
+
+ubench=$top/ubench/src_wf
+release_threads=$THREADS
+[ $release_threads -lt 2 ] && release_threads=2
+
+# name | directory | program | arguments | output line tag | threads
+# The tag is Running, Per-task or the name of a uops operation. threads
+# defaults to THREADS.
+experiments=(
+    "spawn|$ubench|uops|spawn|spawn|"
+    "spawn-outdep|$ubench|uops|outdep|outdep|"
+    "spawn-sync|$ubench|uops|spawn-sync|spawn-sync|"
+    "release-1|$ubench|uops|release 100 1000 8|release-1|$release_threads"
+    "release-8|$ubench|uops|release 100 1000 8|release-8|$release_threads"
+    "nodep|$ubench|data_dep1|nodep $TASKS 1 0:0 0|Per-task|"
+    "indep|$ubench|data_dep1|indep $TASKS 1 0:0 0|Per-task|"
+    "outdep|$ubench|data_dep1|outdep $TASKS 1 0:0 0|Per-task|"
+    "inoutdep|$ubench|data_dep1|inoutdep $TASKS 1 0:0 0|Per-task|"
+    "cinoutdep|$ubench|data_dep1|cinoutdep $TASKS 1 0:0 0|Per-task|"
+    "indep-x10|$ubench|data_depN10|indep $TASKS 10 0:1000 0|Per-task|"
+    "inoutdep-x10|$ubench|data_depN10|inoutdep $TASKS 10 0:1000 0|Per-task|"
+    "jacobi3|$top/jacobi/src_wfo|J_jacobi3|64|Running|"
+    "cholesky|$top/cholesky2/src_wfo|cholesky|64 128|Running|"
+    "lu|$top/lu/src_wfo|lu|-n 1024|Running|"
+    "sparse_lu|$top/sparse_lu/src_wfo|sparse_lu||Running|"
+    "fm|$top/fm/src_wfo|fm||Running|"
+)
+
+# Median of the arguments
+median()
+{
+    echo "$@" | tr ' ' '\n' | sort -g | awk '{ v[NR] = $1 } END { if( NR ) print v[int((NR+1)/2)]; else print "-" }'
+}
+
+# The value on the line with the given tag: the first number after '='
+# (Running time), the third field (Per-task time) or the ns/op of a uops
+# operation, if measured.
+extract()
+{
+    local tag=$1
+
+    case $tag in
+	Running) sed -n -e 's/^Running.*= *\([^ ]*\).*$/\1/p' | head -n 1 ;;
+	Per-task) awk '/^Per-task/ { print $3; exit }' ;;
+	*) awk -v t=$tag '$1 == t && $3 == "ns/op" && $2 ~ /^[0-9.]+$/ \
+	    { print $2; exit }' ;;
+    esac
+}
+
+# Run one experiment under one backend and print the median of the value
+# found on the line with the given tag.
+measure()
+{
+    local dir=$1
+    local prog=$2
+    local args=$3
+    local tag=$4
+    local backend=$5
+    local nproc=$6
+
+    if [ ! -x $dir/${prog}_$backend ] ; then
+	echo "-"
+	return
+    fi
+
+    local vals=""
+    for r in $(seq $REPEAT) ; do
+	local v=$(cd $dir && TASKGRAPH=$backend NUM_THREADS=$nproc \
+	    ./$prog $args 2>/dev/null | extract $tag)
+	[ -n "$v" ] && vals="$vals $v"
+    done
+    median $vals
+}
+
+printf "%-14s" "experiment"
+for b in $BACKENDS ; do printf " %12s" $b ; done
+echo
+
+for e in "${experiments[@]}" ; do
+    IFS='|' read name dir prog args tag nproc <<< "$e"
+    printf "%-14s" $name
+    for b in $BACKENDS ; do
+	printf " %12s" $(measure "$dir" "$prog" "$args" "$tag" $b \
+	    ${nproc:-$THREADS})
+    done
+    echo
+done
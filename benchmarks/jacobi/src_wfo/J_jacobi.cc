@@ -78,25 +78,42 @@ typedef inoutdep<float[B][B]> binout;
 
 h_block_t A[NB][NB];
 
-void alloc_and_genmat ()
+// Seed of the generator after steps draws: 1325 * 3125^steps mod 65536
+static int genmat_seed (long steps)
 {
-   int init_val, i, j, ii, jj;
-   block_t p;
+   unsigned long seed = 1325, mul = 3125;
+   for (; steps; steps >>= 1) {
+      if (steps & 1)
+	 seed = (seed * mul) % 65536;
+      mul = (mul * mul) % 65536;
+   }
+   return seed;
+}
 
-   init_val = 1325;
+// Generate blocks [from, to) in row-major order. The generator is seeked
+// to the start of the range, so the matrix does not depend on the number
+// of workers.
+void genmat (size_t from, size_t to)
+{
+   int init_val, i, j;
+   block_t p;
 
-   for (ii = 0; ii < NB; ii++) 
-     for (jj = 0; jj < NB; jj++)
-     {
-	 // A[ii][jj] = (float *)malloc(B*B*sizeof(float));
-       	 // if (A[ii][jj]==NULL) { printf("Out of memory\n"); exit(1); }
-	 p=(block_t)A[ii][jj];
+   for (size_t b = from; b < to; b++)
+   {
+	 init_val = genmat_seed((long)b*B*B);
+	 p=(block_t)A[b/NB][b%NB];
         for (i = 0; i < B; i++) 
            for (j = 0; j < B; j++) {
               init_val = (3125 * init_val) % 65536;
       	      p[i][j] = (float)((init_val - 32768.0) / 16384.0);
            }
-     }
+   }
+}
+
+// Each block is first written by the worker that owns it
+void alloc_and_genmat ()
+{
+   first_touch((size_t)NB*NB, genmat);
 }
 
 
@@ -61,12 +61,24 @@
 #define TRUE (1)
 
 using obj::unversioned;
+using obj::cow_object;
 using obj::indep;
 using obj::outdep;
 using obj::inoutdep;
 
 typedef float (*vector_t);
+// The halos are reused for every block. With unversioned halos, the writer
+// of a halo must wait for the jacobi task that reads it for the previous
+// block. Once a single task is stolen, practically every task that follows
+// becomes pending on the same frame. Each release then scans that pending
+// list, so the run time grows quadratically with the number of blocks.
+#if JACOBI_COW
+// Copy the halos on write: the halos of the next block need not wait for
+// the jacobi task that reads them for the current block (J_jacobi_cow)
+typedef cow_object<float[B]> h_vector_t;
+#else
 typedef unversioned<float[B]> h_vector_t;
+#endif
 typedef indep<float[B]> vin;
 typedef outdep<float[B]> vout;
 
@@ -245,25 +245,28 @@ void lu(Matrix M, int nb)
     int ii, jj, kk;
 
     for (kk=0; kk<nBlocks; kk++) {
+	// The panel tasks are on the critical path: schedule them first,
+	// followed by the updates of the next panel (look-ahead).
 	// lu0( A[kk][kk]);
-	spawn( block_lu, (Binout)HMATRIX(M, kk, kk) );
+	spawn_prio( 2, block_lu, (Binout)HMATRIX(M, kk, kk) );
 
 	for (jj=kk+1; jj<nBlocks; jj++)
 	    // fwd(A[kk][kk], A[kk][jj]);
-	    spawn( block_lower_solve, (Binout)HMATRIX(M, kk, jj),
-		   (Bin)HMATRIX(M, kk, kk) );
+	    spawn_prio( 1, block_lower_solve, (Binout)HMATRIX(M, kk, jj),
+			(Bin)HMATRIX(M, kk, kk) );
 
 	for (ii=kk+1; ii<nBlocks; ii++) 
 	    // bdiv (A[kk][kk], A[ii][kk]);
-	    spawn( block_upper_solve, (Binout)HMATRIX(M, ii, kk),
-		   (Bin)HMATRIX(M, kk, kk) );
+	    spawn_prio( 1, block_upper_solve, (Binout)HMATRIX(M, ii, kk),
+			(Bin)HMATRIX(M, kk, kk) );
 
 	for (ii=kk+1; ii<nBlocks; ii++) {
 	    for (jj=kk+1; jj<nBlocks; jj++) {
 		// bmod(A[ii][kk], A[kk][jj], A[ii][jj]);
-		spawn( block_schur, (Binout)HMATRIX(M, ii, jj),
-		       (Bin)HMATRIX(M, ii, kk),
-		       (Bin)HMATRIX(M, kk, jj) );
+		spawn_prio( ( ii == kk+1 || jj == kk+1 ) ? 1 : 0,
+			    block_schur, (Binout)HMATRIX(M, ii, jj),
+			    (Bin)HMATRIX(M, ii, kk),
+			    (Bin)HMATRIX(M, kk, jj) );
 	    }
 	}
     }
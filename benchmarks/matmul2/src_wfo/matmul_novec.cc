@@ -181,22 +181,22 @@ int main (int argc, char **argv)
     return 0;
 }
 
-static void convert_to_blocks(int DIM, int N, float *Alin, float **A)
+// Convert blocks [from, to) of the linear matrices. Called by first_touch()
+// such that each block is first written by the worker that owns it.
+static void convert_to_blocks(size_t from, size_t to, int DIM, int N,
+			      float *Alin, float *Blin, float *Clin)
 {
-    int i, j;
-    for (i = 0; i < N; i++)
-	for (j = 0; j < N; j++)
-	    A[(i/BSIZE)*DIM+(j/BSIZE)][(i%BSIZE)*BSIZE+(j%BSIZE)] = Alin[j*N+i];
-}
-
-static void convert_to_h_blocks(int DIM, int N, float *Alin, h_block_t * A)
-{
-    int i, j;
-    for (i = 0; i < N; i++)
-	for (j = 0; j < N; j++) {
-	    block_t b = (block_t)A[(i/BSIZE)*DIM+(j/BSIZE)];
-	    b[i%BSIZE][j%BSIZE] = Alin[j*N+i];
-	}
+    for (size_t b = from; b < to; b++) {
+	int bi = b / DIM, bj = b % DIM;
+	block_t c = (block_t)C[b];
+	for (int ii = 0; ii < BSIZE; ii++)
+	    for (int jj = 0; jj < BSIZE; jj++) {
+		int i = bi*BSIZE+ii, j = bj*BSIZE+jj;
+		A[b][ii*BSIZE+jj] = Alin[j*N+i];
+		B[b][ii*BSIZE+jj] = Blin[j*N+i];
+		c[ii][jj] = Clin[j*N+i];
+	    }
+    }
 }
 
 void initialize( int argc, char **argv, int * N_p, int * DIM_p, loop_order * variant_p )
@@ -257,9 +257,7 @@ void initialize( int argc, char **argv, int * N_p, int * DIM_p, loop_order * var
 	//C[i] = new h_block_t;
     }
 
-    convert_to_blocks(DIM, N, Alin, A);
-    convert_to_blocks(DIM, N, Blin, B);
-    convert_to_h_blocks(DIM, N, Clin, C);
+    first_touch((size_t)DIM*DIM, convert_to_blocks, DIM, N, Alin, Blin, Clin);
 
     free(Alin);
     free(Blin);
@@ -0,0 +1,264 @@
+#!/bin/bash
+
+# Run every variant (src_c, src_wf, src_wfo, src_wfq) of the benchmarks
+# over a range of thread counts and report the statistics of the running
+# time as CSV or JSON.
+#
+# For every benchmark, variant and value of NUM_THREADS, the program is
+# run WARMUP times without measuring, then REPEAT times. The results
+# contain, per configuration:
+#   - the wall-clock time in ms: median, mean, standard deviation,
+#     minimum and maximum over the repetitions
+#   - the median of the running time printed by the benchmark, if any
+#     ("Running time = <value> <unit>"), and its unit
+#   - the speedup of the median wall-clock time over that of src_c
+#   - the mean of the profiling counters of the scheduler, if it is built
+#     with PROFILE_WORKER (lines "num_<counter>=<value>")
+# src_c is run with one thread only. Variants that are not built, and
+# runs that fail, are reported on stderr and left out.
+#
+# Usage: ./run_benchmarks.sh [build-dir [benchmark ...]]
+#     build-dir is the benchmarks directory of the build tree
+#     benchmarks are names or directories from the table below
+#     (default: all)
+# Environment:
+#   THREADS   values of NUM_THREADS (default: 1 2 4 ... up to the number
+#             of CPUs)
+#   WARMUP    runs before measuring (default: 1)
+#   REPEAT    measured runs (default: 5)
+#   VARIANTS  variants to run (default: src_c src_wf src_wfo src_wfq)
+#   FORMAT    csv or json (default: csv)
+#   OUTPUT    file to write the results to (default: stdout)
+#   BUILD     set to 0 to skip running make before the benchmarks
+
+top=${1:-$(dirname $0)}
+[ $# -gt 0 ] && shift
+srcdir=$(cd $(dirname $0) && pwd)
+WARMUP=${WARMUP:-1}
+REPEAT=${REPEAT:-5}
+VARIANTS=${VARIANTS:-"src_c src_wf src_wfo src_wfq"}
+FORMAT=${FORMAT:-csv}
+OUTPUT=${OUTPUT:-/dev/stdout}
+BUILD=${BUILD:-1}
+
+if [ -z "$THREADS" ] ; then
+    ncpu=$(getconf _NPROCESSORS_ONLN)
+    THREADS=""
+    for (( t=1; t < ncpu; t*=2 )) ; do THREADS="$THREADS $t" ; done
+    THREADS="$THREADS $ncpu"
+fi
+
+case $FORMAT in
+    csv|json) ;;
+    *) echo "unknown FORMAT $FORMAT" 1>&2 ; exit 1 ;;
+esac
+
+tmp=${TMPDIR:-/tmp}/run_benchmarks.$$
+trap "rm -f $tmp.*" EXIT
+
+# name | directory | program | arguments
+# The arguments are the same for all variants of a benchmark. cholesky2,
+# lattice and ubench have no speedup: they have no src_c variant
+# (lattice/src_c is an empty stub). lattice/src_wfq uses dependence types
+# that the queues no longer provide; neither is configured.
+benchmarks=(
+    "fft|fft|fft|-benchmark medium"
+    "lu|lu|lu|-benchmark medium"
+    "strassen|strassen|strassen|-benchmark medium"
+    "rectmul_bis|rectmul_bis|rectmul|-benchmark medium"
+    "sparse_lu|sparse_lu|sparse_lu|"
+    "jacobi|jacobi|J_jacobi|8"
+    "cholesky2|cholesky2|cholesky|64 32"
+    "matmul2|matmul2|matmul_novec_lapack|16"
+    "lattice|lattice|lattice|1048576"
+    "bzip2f|bzip2f|bzip2|-9 -c $tmp.bzip2"
+    "bzip2f-decompress|bzip2f|bzip2|-d -c $tmp.bzip2.bz2"
+    "fm|fm|fm|-i 1000000"
+    "audiobeam|audiobeam|audiobeam|-data_file $srcdir/audiobeam/data/data2.bin -search_far_field"
+    "ubench-fanout|ubench|ufanout|100000 10 100"
+    "ubench-startup|ubench|ustartup|"
+)
+
+# Inputs that are generated rather than shipped, made once before the
+# first benchmark in the directory runs.
+# bzip2f: 16 copies of the bzip2 test files (7 MB, 8 blocks at -9) and
+# that file compressed. The latter is compressed with the bzip2 on the
+# PATH, or else with src_c, so that all variants decode the same stream.
+input_bzip2f()
+{
+    [ -f $tmp.bzip2.bz2 ] && return 0
+    for i in $(seq 16) ; do
+	cat $srcdir/bzip2f/src_c/sample[123].ref
+    done > $tmp.bzip2
+    local bzip2=$(command -v bzip2)
+    if [ -z "$bzip2" ] ; then
+	make -C $top/bzip2f/src_c bzip2 > /dev/null 2>&1
+	bzip2=$top/bzip2f/src_c/bzip2
+    fi
+    $bzip2 -9 -c $tmp.bzip2 > $tmp.bzip2.bz2
+}
+
+# Run a program WARMUP+REPEAT times. Appends one line per measured run to
+# $tmp.runs: wall-clock time in ms, reported running time and its unit
+# ("-" if not printed), and the counters as name=value pairs.
+measure()
+{
+    local dir=$1
+    local prog=$2
+    local args=$3
+    local nproc=$4
+
+    : > $tmp.runs
+    for r in $(seq $(( WARMUP + REPEAT ))) ; do
+	local start=$(date +%s%N)
+	(cd $dir && NUM_THREADS=$nproc ./$prog $args > $tmp.out 2> $tmp.err)
+	local status=$?
+	local end=$(date +%s%N)
+	if [ $status -ne 0 ] ; then
+	    echo "$dir/$prog $args: exit status $status (NUM_THREADS=$nproc)" 1>&2
+	    return 1
+	fi
+	[ $r -le $WARMUP ] && continue
+
+	local reported=$(grep -h "^Running time" $tmp.out $tmp.err | head -n 1 \
+	    | sed -e 's/^.*= *//')
+	# The counters of the last profile dump, which is the summary
+	local counters=$(awk '/^Profile ID=/ { c = "" }
+	    /^ *num_[a-z_0-9]*=[0-9]*$/ { sub( /^ */, "" ); c = c " " $0 }
+	    END { print c }' $tmp.err)
+	echo "$(( (end - start) / 1000 )) ${reported:-- -}$counters" >> $tmp.runs
+    done
+}
+
+# Statistics over $tmp.runs, as one line:
+#     median mean stddev min max reported unit counters
+# where times are in ms and counters is name=value;... or "-".
+statistics()
+{
+    awk '{ us[NR] = $1; rep[NR] = $2; unit = $3
+	   for( i=4; i <= NF; ++i ) {
+	       split( $i, kv, "=" )
+	       if( !(kv[1] in cnt) ) order[++ncnt] = kv[1]
+	       cnt[kv[1]] += kv[2]
+	   } }
+	function median( a, n,    i, j, t ) {
+	    for( i=2; i <= n; ++i )
+		for( j=i; j > 1 && a[j-1] > a[j]; --j ) {
+		    t = a[j]; a[j] = a[j-1]; a[j-1] = t
+		}
+	    return n % 2 ? a[(n+1)/2] : (a[n/2] + a[n/2+1]) / 2
+	}
+	END {
+	    n = NR
+	    for( i=1; i <= n; ++i ) {
+		sum += us[i]
+		if( i == 1 || us[i] < min ) min = us[i]
+		if( i == 1 || us[i] > max ) max = us[i]
+	    }
+	    mean = sum / n
+	    for( i=1; i <= n; ++i ) ss += (us[i] - mean) ^ 2
+	    sd = n > 1 ? sqrt( ss / (n - 1) ) : 0
+	    r = "-"
+	    if( rep[1] != "-" ) r = median( rep, n )
+	    c = ""
+	    for( i=1; i <= ncnt; ++i )
+		c = c (i > 1 ? ";" : "") sprintf( "%s=%.0f", order[i], cnt[order[i]] / n )
+	    printf "%.3f %.3f %.3f %.3f %.3f %s %s %s\n", median( us, n ) / 1000,
+		mean / 1000, sd / 1000, min / 1000, max / 1000, r, unit,
+		c == "" ? "-" : c
+	}' $tmp.runs
+}
+
+# One result in the output format
+emit()
+{
+    local bench=$1 variant=$2 nproc=$3
+    local median=$4 mean=$5 sd=$6 min=$7 max=$8 reported=$9 unit=${10}
+    local counters=${11}
+    local speedup=$(awk -v b=$serial -v m=$median \
+	'BEGIN { if( b != "" && m > 0 ) printf "%.3f", b / m; else print "-" }')
+
+    if [ $FORMAT = csv ] ; then
+	[ $reported = - ] && reported= && unit=
+	[ $speedup = - ] && speedup=
+	[ $counters = - ] && counters=
+	echo "$bench,$variant,$nproc,$REPEAT,$median,$mean,$sd,$min,$max,$reported,$unit,$speedup,$counters"
+    else
+	[ $nresults -gt 0 ] && echo ","
+	echo -n "    { \"benchmark\": \"$bench\", \"variant\": \"$variant\","
+	echo -n " \"threads\": $nproc, \"runs\": $REPEAT,"
+	echo -n " \"wall_ms\": { \"median\": $median, \"mean\": $mean,"
+	echo -n " \"stddev\": $sd, \"min\": $min, \"max\": $max },"
+	if [ $reported = - ] ; then
+	    echo -n " \"reported\": null,"
+	else
+	    echo -n " \"reported\": { \"value\": $reported, \"unit\": \"$unit\" },"
+	fi
+	[ $speedup = - ] && speedup=null
+	echo -n " \"speedup\": $speedup, \"counters\": {"
+	if [ $counters != - ] ; then
+	    echo -n " $counters " | sed -e 's/\([a-z_0-9]*\)=\([0-9]*\)/"\1": \2/g;s/;/, /g'
+	fi
+	echo -n "} }"
+    fi
+    nresults=$(( nresults + 1 ))
+}
+
+run_benchmark()
+{
+    local bench=$1 bdir=$2 prog=$3 args=$4
+
+    if declare -F input_$bdir > /dev/null && ! input_$bdir ; then
+	echo "$bench: cannot make the input" 1>&2
+	return
+    fi
+
+    serial=
+    for variant in $VARIANTS ; do
+	local dir=$top/$bdir/$variant
+	[ -d $dir ] || continue
+	if [ $BUILD != 0 ] ; then
+	    make -C $dir $prog > /dev/null 2>&1
+	fi
+	if [ ! -x $dir/$prog ] ; then
+	    echo "$dir/$prog: not built" 1>&2
+	    continue
+	fi
+
+	local threads=$THREADS
+	[ $variant = src_c ] && threads=1
+	for t in $threads ; do
+	    measure $dir $prog "$args" $t || continue
+	    local stats=$(statistics)
+	    [ $variant = src_c ] && serial=$(echo $stats | cut -d' ' -f1)
+	    emit $bench $variant $t $stats
+	done
+    done
+}
+
+selected="$@"
+nresults=0
+{
+    if [ $FORMAT = csv ] ; then
+	echo "benchmark,variant,threads,runs,wall_median_ms,wall_mean_ms,wall_stddev_ms,wall_min_ms,wall_max_ms,reported,reported_unit,speedup,counters"
+    else
+	echo "{"
+	echo "  \"host\": \"$(uname -n)\","
+	echo "  \"cpus\": $(getconf _NPROCESSORS_ONLN),"
+	echo "  \"date\": \"$(date -u +%Y-%m-%dT%H:%M:%SZ)\","
+	echo "  \"warmup\": $WARMUP,"
+	echo "  \"results\": ["
+    fi
+    for b in "${benchmarks[@]}" ; do
+	IFS='|' read bench bdir prog args <<< "$b"
+	if [ -n "$selected" ] && ! echo " $selected " | grep -q " \($bench\|$bdir\) " ; then
+	    continue
+	fi
+	run_benchmark $bench $bdir $prog "$args"
+    done
+    if [ $FORMAT = json ] ; then
+	echo
+	echo "  ]"
+	echo "}"
+    fi
+} > $OUTPUT
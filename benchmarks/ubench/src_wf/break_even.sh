@@ -1,5 +1,50 @@
 #!/bin/bash
 
+# Break-even number of object arguments for the branch-free readiness
+# check of the tickets taskgraph (TKT_BRANCHFREE_READY):
+#     make ready
+#     ./break_even.sh args <arg_ty> [num_tasks]
+# compares data_depN<args>_sready (short-circuit evaluation) against
+# data_depN<args>_bfready (branch-free evaluation) for pending tasks
+# (batch 0:1000) and for tasks that are ready at spawn time (batch 0:0),
+# and reports the number of arguments from which on the latter is faster.
+if [ "$1" = args ] ; then
+    arg_ty=${2:-inoutdep}
+    num_tasks=${3:-1000000}
+    repeat=${REPEAT:-5}
+
+    # Fastest per-task time over the repetitions
+    per_task()
+    {
+	local exec_file=$1
+	local batch=$2
+	for r in $(seq $repeat) ; do
+	    NUM_THREADS=1 $exec_file $arg_ty $num_tasks $batch 0 2>&1 \
+		| egrep Per | cut -d' ' -f3
+	done | sort -g | head -n 1
+    }
+
+    for batch in 0:1000 0:0 ; do
+	echo "batch=$batch arg_ty=$arg_ty"
+	echo "args sready bfready"
+	break_even=-
+	for args in 1 2 5 10 20 50 ; do
+	    [ -x ./data_depN${args}_sready ] || continue
+	    s=$(per_task ./data_depN${args}_sready $batch)
+	    b=$(per_task ./data_depN${args}_bfready $batch)
+	    echo "$args $s $b"
+	    # Smallest number of arguments from which on bfready is faster
+	    if ! awk -v s=$s -v b=$b 'BEGIN { exit !(b < s) }' ; then
+		break_even=-
+	    elif [ $break_even = - ] ; then
+		break_even=$args
+	    fi
+	done
+	echo "break-even: $break_even"
+    done
+    exit 0
+fi
+
 max_threads=$1
 arg_ty=$2
 num_objects=$3
@@ -0,0 +1,15 @@
+#!/bin/bash
+
+# Ready-list contention: drain time of a wide fan-out under one parent
+# for an increasing number of thieves.
+# Usage: ./fanout.sh [executable] [num_tasks] [workload]
+
+exec=${1:-./ufanout}
+tasks=${2:-10000}
+work=${3:-100}
+
+echo "threads per-task(cycles)"
+for threads in 2 4 8 16 32 64 ; do
+    echo -ne "$threads "
+    NUM_THREADS=$threads $exec $tasks 10 $work 2>&1 | grep Per | cut -d' ' -f3
+done
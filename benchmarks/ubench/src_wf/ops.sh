@@ -0,0 +1,34 @@
+#!/bin/bash
+
+# Scheduler overheads: median ns per operation of every operation
+# measured by uops, for an increasing number of threads. One row per
+# operation, one column per number of threads.
+# Usage: ./ops.sh [executable] [reps] [batch] [max_waiters]
+
+exec=${1:-./uops}
+reps=${2:-100}
+batch=${3:-1000}
+waiters=${4:-64}
+# Powers of two up to the number of CPUs, and that number: spinning
+# workers need a CPU of their own.
+ncpu=$(getconf _NPROCESSORS_ONLN)
+threads=""
+for (( t=1; t < ncpu; t*=2 )) ; do threads="$threads $t" ; done
+threads="$threads $ncpu"
+
+tmp=${TMPDIR:-/tmp}/ops.$$
+trap "rm -f $tmp.*" EXIT
+
+for t in $threads ; do
+    NUM_THREADS=$t $exec all $reps $batch $waiters 2>/dev/null \
+	| grep ns/op | awk '{ print $1, $2 }' > $tmp.$t
+done
+
+echo "op$threads"
+for op in $(cut -d' ' -f1 $tmp.1) ; do
+    echo -n "$op"
+    for t in $threads ; do
+	echo -n " $(grep "^$op " $tmp.$t | cut -d' ' -f2)"
+    done
+    echo
+done
@@ -0,0 +1,41 @@
+#!/bin/bash
+
+# Measure startup cost (time to first task and time until all workers
+# executed a task) for an increasing number of threads.
+# Usage: ./startup.sh [executable] [repetitions]
+
+exec=${1:-./ustartup}
+reps=${2:-10}
+
+run()
+{
+    local threads=$1
+
+    echo -ne "$threads "
+    first=0
+    all=0
+    nall=0
+    for r in $(seq 1 $reps) ; do
+	NUM_THREADS=$threads $exec > /tmp/o.$$ 2>&1
+	a=$(grep "first task" < /tmp/o.$$ | cut -d' ' -f5)
+	b=$(grep "all workers" < /tmp/o.$$ | cut -d' ' -f5)
+	first=$(echo "$first + $a" | bc -l)
+	# Runs where not all workers were seen report n/a and are skipped
+	if [ -n "$b" ] && [ "$b" != n/a ] ; then
+	    all=$(echo "$all + $b" | bc -l)
+	    nall=$(( nall + 1 ))
+	fi
+    done
+    if [ $nall -gt 0 ] ; then
+	all=$(echo "$all / $nall" | bc -l)
+    else
+	all=n/a
+    fi
+    echo "$(echo "$first / $reps" | bc -l) $all"
+    rm -f /tmp/o.$$
+}
+
+echo "threads first-task(us) all-workers(us)"
+for threads in 1 2 4 8 16 32 64 ; do
+    run $threads
+done
@@ -0,0 +1,111 @@
+/*
+ * Copyright (C) 2011 Hans Vandierendonck (hvandierendonck@acm.org)
+ * Copyright (C) 2011 George Tzenakis (tzenakis@ics.forth.gr)
+ * Copyright (C) 2011 Dimitrios S. Nikolopoulos (dsn@ics.forth.gr)
+ *
+ * This file is part of Swan.
+ *
+ * Swan is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Swan is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Swan.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Context switch microbenchmark: cost of returning to the scheduler loop.
+ * Measures in cycles:
+ *  - a save/restore round trip with setjmp()/longjmp();
+ *  - the same with the runtime's swan_ctx_save()/swan_ctx_restore()
+ *    (FAST_CONTEXT_SWITCH);
+ *  - run() of an empty task, which enters the scheduler loop once and
+ *    returns to it through worker_state::longjmp(), as a task does that
+ *    returns after its parent was stolen.
+ *
+ * Usage: NUM_THREADS=1 ./uctxsw [iterations]
+ */
+#include <csetjmp>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "wf_interface.h"
+
+struct stats {
+    uint64_t min, total;
+    size_t n;
+
+    stats() : min( ~uint64_t(0) ), total( 0 ), n( 0 ) { }
+
+    void add( uint64_t t ) {
+	if( t < min )
+	    min = t;
+	total += t;
+	++n;
+    }
+    void print( const char * what ) const {
+	printf( "%-24s min %6lu avg %8.1lf cycles\n", what,
+		(unsigned long)min, double(total)/double(n) );
+    }
+};
+
+static jmp_buf jb;
+
+static void __attribute__((noinline)) bench_setjmp( size_t n ) {
+    stats s;
+    for( size_t i=0; i < n; ++i ) {
+	volatile uint64_t t0 = get_ticks();
+	if( !setjmp( jb ) )
+	    longjmp( jb, 1 );
+	s.add( get_ticks() - t0 );
+    }
+    s.print( "setjmp/longjmp" );
+}
+
+#if FAST_CONTEXT_SWITCH
+static ctx_buf_t ctx;
+
+static void __attribute__((noinline)) bench_ctx( size_t n ) {
+    stats s;
+    for( size_t i=0; i < n; ++i ) {
+	volatile uint64_t t0 = get_ticks();
+	if( !swan_ctx_save( &ctx ) )
+	    swan_ctx_restore( &ctx, 1 );
+	s.add( get_ticks() - t0 );
+    }
+    s.print( "swan_ctx_save/restore" );
+}
+#endif
+
+void empty() { }
+
+static void __attribute__((noinline)) bench_run( size_t n ) {
+    stats s;
+    run( empty ); // start the workers
+    for( size_t i=0; i < n; ++i ) {
+	uint64_t t0 = get_ticks();
+	run( empty );
+	s.add( get_ticks() - t0 );
+    }
+    s.print( "run( empty )" );
+}
+
+int main( int argc, char* argv[] ) {
+    size_t n = argc > 1 ? atol( argv[1] ) : 1000000;
+
+    printf( "FAST_CONTEXT_SWITCH=%d iterations=%lu\n",
+	    FAST_CONTEXT_SWITCH, (unsigned long)n );
+    bench_setjmp( n );
+#if FAST_CONTEXT_SWITCH
+    bench_ctx( n );
+#endif
+    bench_run( n );
+
+    return 0;
+}
@@ -0,0 +1,113 @@
+/*
+ * Copyright (C) 2011 Hans Vandierendonck (hvandierendonck@acm.org)
+ * Copyright (C) 2011 George Tzenakis (tzenakis@ics.forth.gr)
+ * Copyright (C) 2011 Dimitrios S. Nikolopoulos (dsn@ics.forth.gr)
+ *
+ * This file is part of Swan.
+ *
+ * Swan is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Swan is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Swan.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Ready-list contention microbenchmark: a single parent spawns many
+ * tasks that all wait on one object. A gate task holds the object until
+ * all tasks have been spawned. Releasing the gate wakes up all tasks at
+ * once and the workers then pull them from the parent's ready list.
+ *
+ * The ready list is only used by the taskgraph schemes, so build with
+ * e.g. OBJECT_TASKGRAPH=5, 9, 10 or 11. The gate requires NUM_THREADS > 1
+ * to actually delay the spawned tasks.
+ *
+ * Usage: NUM_THREADS=<threads> ./ufanout <num_tasks> <reps> <workload>
+ */
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "wf_interface.h"
+#include "rdtsc.h"
+
+using obj::object_t;
+using obj::indep;
+using obj::inoutdep;
+
+extern size_t nthreads;
+
+int g_maxfibo;
+int global_sink = 0;
+volatile bool gate_open;
+unsigned long long t_release;
+
+// Iterative fibonacci. Return fibonacci(n)
+int fibonacci( int n ) {
+    int u = 0;
+    int v = 1;
+    int i, t;
+
+    for( i = 2; i <= n; i++ ) {
+	t = u + v;
+	u = v;
+	v = t;
+    }
+    return v;
+}
+
+void gate( inoutdep<int> obj ) {
+    // Wait until the continuation has been stolen and all consumers have
+    // been spawned. Don't wait when we are on our own.
+    if( nthreads > 1 )
+	while( !gate_open );
+    t_release = rdtsc();
+}
+
+void consumer( indep<int> obj ) {
+    global_sink += leaf_call( fibonacci, (int)g_maxfibo );
+}
+
+void fanout( object_t<int> * obj, unsigned int num_tasks ) {
+    spawn( gate, (inoutdep<int>)*obj );
+    for( unsigned int i=0; i < num_tasks; ++i )
+	spawn( consumer, (indep<int>)*obj );
+    gate_open = true;
+    ssync();
+}
+
+int main( int argc, char* argv[] ) {
+    if( argc <= 3 ) {
+	fprintf( stderr, "Usage: %s <num_tasks> <reps> <workload>\n",
+		 argv[0] );
+	exit( 1 );
+    }
+
+    unsigned int num_tasks = atoi( argv[1] );
+    unsigned int reps = atoi( argv[2] );
+    g_maxfibo = atoi( argv[3] );
+
+    printf( "fan-out tasks=%u reps=%u workload=%u threads=%lu\n",
+	    num_tasks, reps, g_maxfibo, (unsigned long)nthreads );
+
+    double total = 0;
+    for( unsigned int r=0; r < reps; ++r ) {
+	object_t<int> obj;
+	gate_open = false;
+	run( fanout, &obj, num_tasks );
+	total += double( rdtsc() - t_release );
+    }
+
+    printf( "Drain time %.3lf cycles\n", total / reps );
+    printf( "Per-task time %.3lf cycles\n", total / reps / num_tasks );
+
+    return 0;
+}
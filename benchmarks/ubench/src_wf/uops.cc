@@ -0,0 +1,546 @@
+/*
+ * Copyright (C) 2011 Hans Vandierendonck (hvandierendonck@acm.org)
+ * Copyright (C) 2011 George Tzenakis (tzenakis@ics.forth.gr)
+ * Copyright (C) 2011 Dimitrios S. Nikolopoulos (dsn@ics.forth.gr)
+ *
+ * This file is part of Swan.
+ *
+ * Swan is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Swan is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Swan.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Scheduler overhead microbenchmark: the cost of the core operations of
+ * the runtime in isolation, in ns and cycles per operation:
+ *  - spawn-sync    spawn() of an empty task followed by ssync()
+ *  - spawn         spawn() of an empty task, one ssync() per batch
+ *  - call          call() of an empty task
+ *  - leaf_call     leaf_call() of an empty function
+ *  - steal         time from spawning a task until its parent's
+ *                  continuation starts executing on a thief
+ *  - release-K     time from the end of a task until all K tasks waiting
+ *                  on its inoutdep have started (release_task_and_get_ready).
+ *                  When K > NUM_THREADS, the waiters start in turn on the
+ *                  available threads, so this includes the execution of
+ *                  earlier waiters; these rows are marked as such.
+ *  - outdep        spawn() of a task with an outdep, no readers pending
+ *  - outdep-rename the same while a reader is pending, which renames
+ *                  the object
+ *  - reduction     spawn() of a task with a reduction argument, including
+ *                  the reduction of the views at the ssync()
+ *  - queue-push    hyperqueue push()
+ *  - queue-pop     hyperqueue pop()
+ *  - wslice-N      get_write_slice() of N elements, pushes and commit()
+ *  - rslice-N      get_read_slice_upto() of N elements, pops and commit()
+ *
+ * Every operation is timed with rdtsc() over reps batches of batch
+ * operations, after reps/10 batches of warm-up. The cost of reading the
+ * time stamp counter is subtracted. Reported are the median, the mean
+ * with a 95% confidence interval and the minimum over the batches. The
+ * conversion to ns uses the frequency of the time stamp counter, which
+ * is calibrated against clock_gettime() at start-up.
+ *
+ * steal, release-K and outdep-rename time one operation per repetition.
+ * They need a task to be pending while the continuation of its parent is
+ * stolen, which never happens when running on a single thread (the
+ * spawned task executes immediately), so they are skipped unless
+ * NUM_THREADS > 1. Spinning workers should have a CPU of their own.
+ *
+ * Usage: NUM_THREADS=<threads> ./uops [<op>|all] [reps] [batch] [max_waiters]
+ *     where <op> is one of spawn-sync, spawn, call, leaf_call, steal,
+ *     release, outdep (both outdep measurements), reduction, queue or slice.
+ * See ops.sh for a sweep over the number of threads.
+ */
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <algorithm>
+#include <vector>
+
+#include "wf_interface.h"
+#include "rdtsc.h"
+
+using obj::object_t;
+using obj::indep;
+using obj::outdep;
+using obj::inoutdep;
+using obj::reduction;
+using obj::cheap_reduction_tag;
+using obj::hyperqueue;
+using obj::pushdep;
+using obj::popdep;
+
+extern size_t nthreads;
+
+typedef unsigned long long ticks_t;
+
+#define SLICE 16
+
+unsigned int reps = 100;
+unsigned int batch = 1000;
+unsigned int max_waiters = 64;
+
+double ns_per_tick;
+double rdtsc_overhead;
+int global_sink = 0;
+
+// Samples of the cost of one operation in cycles
+struct stats {
+    std::vector<double> samples;
+
+    void clear() { samples.clear(); }
+    void add( double t ) { samples.push_back( t ); }
+
+    // Add a sample of n operations that took t cycles in total
+    void add( ticks_t t0, ticks_t t1, unsigned int n ) {
+	double t = double( t1 - t0 ) - rdtsc_overhead;
+	add( std::max( t, 0.0 ) / double( n ) );
+    }
+
+    void print( const char * what, const char * note = 0 ) {
+	size_t n = samples.size();
+	std::sort( samples.begin(), samples.end() );
+	double median = n % 2 ? samples[n/2]
+	    : ( samples[n/2-1] + samples[n/2] ) / 2;
+	double sum = 0, ss = 0;
+	for( size_t i=0; i < n; ++i )
+	    sum += samples[i];
+	double mean = sum / double( n );
+	for( size_t i=0; i < n; ++i )
+	    ss += ( samples[i] - mean ) * ( samples[i] - mean );
+	double sd = n > 1 ? sqrt( ss / double( n - 1 ) ) : 0;
+	double ci = 1.96 * sd / sqrt( double( n ) );
+	printf( "%-16s %10.1lf ns/op %10.1lf cycles/op"
+		"  mean %.1lf +- %.1lf min %.1lf cycles (n=%lu)",
+		what, median * ns_per_tick, median, mean, ci, samples[0],
+		(unsigned long)n );
+	if( note )
+	    printf( " (%s)", note );
+	printf( "\n" );
+    }
+};
+
+stats s;
+
+void na( const char * what, const char * why ) {
+    printf( "%-16s %10s ns/op (%s)\n", what, "n/a", why );
+}
+
+// Frequency of the time stamp counter in ticks per ns
+void calibrate() {
+    struct timespec ts0, ts1;
+    clock_gettime( CLOCK_MONOTONIC, &ts0 );
+    ticks_t t0 = rdtsc();
+    do {
+	clock_gettime( CLOCK_MONOTONIC, &ts1 );
+    } while( ( ts1.tv_sec - ts0.tv_sec ) * 1000000000LL
+	     + ( ts1.tv_nsec - ts0.tv_nsec ) < 100000000LL );
+    ticks_t t1 = rdtsc();
+    double ns = double( ( ts1.tv_sec - ts0.tv_sec ) * 1000000000LL
+			+ ( ts1.tv_nsec - ts0.tv_nsec ) );
+    ns_per_tick = ns / double( t1 - t0 );
+
+    // Back-to-back reads of the counter, the median is subtracted from
+    // every sample
+    std::vector<ticks_t> d( 1001 );
+    for( size_t i=0; i < d.size(); ++i ) {
+	ticks_t a = rdtsc();
+	d[i] = rdtsc() - a;
+    }
+    std::sort( d.begin(), d.end() );
+    rdtsc_overhead = double( d[d.size()/2] );
+}
+
+unsigned int warmup() { return std::max( reps / 10, 1U ); }
+
+// Tasks. Tasks without arguments are not supported, hence the dummy
+// argument.
+void empty( int ) { }
+
+int empty_leaf( int ) { return 0; }
+
+void writer( outdep<int> obj ) { }
+
+template<typename T>
+struct add_monad {
+    typedef T value_type;
+    typedef cheap_reduction_tag reduction_tag;
+    static void identity( T * p ) { new (p) T(0); }
+    static void reduce( T * left, T * right ) { *left += *right; }
+};
+
+void reduce_task( reduction<add_monad<int> > r ) {
+    *(int *)r += 1;
+}
+
+// Spawn, call and leaf_call
+void bench_spawn_sync() {
+    for( unsigned int r=0; r < warmup() + reps; ++r ) {
+	ticks_t t0 = rdtsc();
+	for( unsigned int i=0; i < batch; ++i ) {
+	    spawn( empty, 0 );
+	    ssync();
+	}
+	ticks_t t1 = rdtsc();
+	if( r >= warmup() )
+	    s.add( t0, t1, batch );
+    }
+}
+
+void bench_spawn() {
+    for( unsigned int r=0; r < warmup() + reps; ++r ) {
+	ticks_t t0 = rdtsc();
+	for( unsigned int i=0; i < batch; ++i )
+	    spawn( empty, 0 );
+	ssync();
+	ticks_t t1 = rdtsc();
+	if( r >= warmup() )
+	    s.add( t0, t1, batch );
+    }
+}
+
+void bench_call() {
+    for( unsigned int r=0; r < warmup() + reps; ++r ) {
+	ticks_t t0 = rdtsc();
+	for( unsigned int i=0; i < batch; ++i )
+	    call( empty, 0 );
+	ticks_t t1 = rdtsc();
+	if( r >= warmup() )
+	    s.add( t0, t1, batch );
+    }
+}
+
+void bench_leaf_call() {
+    for( unsigned int r=0; r < warmup() + reps; ++r ) {
+	ticks_t t0 = rdtsc();
+	for( unsigned int i=0; i < batch; ++i )
+	    global_sink += leaf_call( empty_leaf, 0 );
+	ticks_t t1 = rdtsc();
+	if( r >= warmup() )
+	    s.add( t0, t1, batch );
+    }
+}
+
+// Steal latency: the child spins until its parent's continuation has
+// been stolen.
+volatile bool stolen;
+volatile ticks_t t_spawn;
+
+void spin_child( int ) {
+    t_spawn = rdtsc();
+    while( !stolen );
+}
+
+void bench_steal() {
+    for( unsigned int r=0; r < warmup() + reps; ++r ) {
+	stolen = false;
+	spawn( spin_child, 0 );
+	ticks_t t1 = rdtsc();
+	stolen = true;
+	ssync();
+	if( r >= warmup() )
+	    s.add( t_spawn, t1, 1 );
+    }
+}
+
+// Release: the gate holds the object until the continuation has been
+// stolen and has spawned all waiters. The last waiter to start stops the
+// clock.
+volatile bool gate_open;
+volatile unsigned int started;
+unsigned int num_waiters;
+volatile ticks_t t_release, t_started;
+
+void gate( inoutdep<int> obj ) {
+    while( !gate_open );
+    t_release = rdtsc();
+}
+
+void waiter( indep<int> obj ) {
+    if( __sync_add_and_fetch( &started, 1 ) == num_waiters )
+	t_started = rdtsc();
+}
+
+void bench_release( unsigned int k ) {
+    object_t<int> obj;
+    num_waiters = k;
+    for( unsigned int r=0; r < warmup() + reps; ++r ) {
+	gate_open = false;
+	started = 0;
+	spawn( gate, (inoutdep<int>)obj );
+	for( unsigned int i=0; i < k; ++i )
+	    spawn( waiter, (indep<int>)obj );
+	gate_open = true;
+	ssync();
+	if( r >= warmup() )
+	    s.add( t_release, t_started, 1 );
+    }
+}
+
+// Output dependences, with and without renaming. The reader holds on to
+// the current version while the stolen continuation spawns the writer.
+void reader( indep<int> obj ) {
+    while( !gate_open );
+}
+
+void bench_outdep() {
+    object_t<int> obj;
+    for( unsigned int r=0; r < warmup() + reps; ++r ) {
+	ticks_t t0 = rdtsc();
+	for( unsigned int i=0; i < batch; ++i )
+	    spawn( writer, (outdep<int>)obj );
+	ssync();
+	ticks_t t1 = rdtsc();
+	if( r >= warmup() )
+	    s.add( t0, t1, batch );
+    }
+}
+
+void bench_rename() {
+    object_t<int> obj;
+    for( unsigned int r=0; r < warmup() + reps; ++r ) {
+	gate_open = false;
+	spawn( reader, (indep<int>)obj );
+	ticks_t t0 = rdtsc();
+	spawn( writer, (outdep<int>)obj );
+	ticks_t t1 = rdtsc();
+	gate_open = true;
+	ssync();
+	if( r >= warmup() )
+	    s.add( t0, t1, 1 );
+    }
+}
+
+// Reductions
+void bench_reduction() {
+    object_t<int> obj;
+    for( unsigned int r=0; r < warmup() + reps; ++r ) {
+	ticks_t t0 = rdtsc();
+	for( unsigned int i=0; i < batch; ++i )
+	    spawn( reduce_task, (reduction<add_monad<int> >)obj );
+	ssync();
+	ticks_t t1 = rdtsc();
+	if( r >= warmup() )
+	    s.add( t0, t1, batch );
+    }
+    if( *obj != int( ( warmup() + reps ) * batch ) ) {
+	fprintf( stderr, "reduction: wrong value %d\n", *obj );
+	exit( 1 );
+    }
+}
+
+// Hyperqueues, which only the tickets backends implement. The producer
+// and consumer time their own operations.
+#if OBJECT_TASKGRAPH == 1 || OBJECT_TASKGRAPH == 8
+#define HAVE_HYPERQUEUE 1
+#else
+#define HAVE_HYPERQUEUE 0
+#endif
+
+#if HAVE_HYPERQUEUE
+stats s_push, s_pop;
+
+void push_task( pushdep<int> queue ) {
+    for( unsigned int r=0; r < warmup() + reps; ++r ) {
+	ticks_t t0 = rdtsc();
+	for( unsigned int i=0; i < batch; ++i )
+	    queue.push( int(i) );
+	ticks_t t1 = rdtsc();
+	if( r >= warmup() )
+	    s_push.add( t0, t1, batch );
+    }
+}
+
+void pop_task( popdep<int> queue ) {
+    for( unsigned int r=0; r < warmup() + reps; ++r ) {
+	ticks_t t0 = rdtsc();
+	for( unsigned int i=0; i < batch; ++i )
+	    global_sink += queue.pop();
+	ticks_t t1 = rdtsc();
+	if( r >= warmup() )
+	    s_pop.add( t0, t1, batch );
+    }
+}
+
+void wslice_task( pushdep<int> queue ) {
+    unsigned int nslices = std::max( batch / SLICE, 1U );
+    for( unsigned int r=0; r < warmup() + reps; ++r ) {
+	ticks_t t0 = rdtsc();
+	for( unsigned int i=0; i < nslices; ++i ) {
+	    obj::write_slice<obj::queue_metadata, int> wslice
+		= queue.get_write_slice( SLICE );
+	    for( int j=0; j < SLICE; ++j )
+		wslice.push( j );
+	    wslice.commit();
+	}
+	ticks_t t1 = rdtsc();
+	if( r >= warmup() )
+	    s_push.add( t0, t1, nslices );
+    }
+}
+
+void rslice_task( popdep<int> queue ) {
+    unsigned int nslices = std::max( batch / SLICE, 1U );
+    for( unsigned int r=0; r < warmup() + reps; ++r ) {
+	ticks_t t0 = rdtsc();
+	for( unsigned int i=0; i < nslices; ++i ) {
+	    obj::read_slice<obj::queue_metadata, int> rslice
+		= queue.get_read_slice_upto( SLICE, 0 );
+	    for( int j=rslice.get_length(); j > 0; --j )
+		global_sink += rslice.pop();
+	    rslice.commit();
+	}
+	ticks_t t1 = rdtsc();
+	if( r >= warmup() )
+	    s_pop.add( t0, t1, nslices );
+    }
+}
+
+void bench_queue() {
+    hyperqueue<int> queue;
+    spawn( push_task, (pushdep<int>)queue );
+    spawn( pop_task, (popdep<int>)queue );
+    ssync();
+}
+
+void bench_slice() {
+    hyperqueue<int> queue;
+    spawn( wslice_task, (pushdep<int>)queue );
+    spawn( rslice_task, (popdep<int>)queue );
+    ssync();
+}
+
+#endif // HAVE_HYPERQUEUE
+
+// Driver
+bool selected( const char * op, const char * name ) {
+    return !strcmp( op, "all" ) || !strcmp( op, name );
+}
+
+void measure( const char * what, void (*fn)() ) {
+    s.clear();
+    run( fn );
+    s.print( what );
+}
+
+int main( int argc, char* argv[] ) {
+    const char * op = argc > 1 ? argv[1] : "all";
+    if( argc > 2 )
+	reps = atoi( argv[2] );
+    if( argc > 3 )
+	batch = atoi( argv[3] );
+    if( argc > 4 )
+	max_waiters = atoi( argv[4] );
+    if( reps < 2 || batch < 1 || max_waiters < 1 ) {
+	fprintf( stderr, "Usage: %s [<op>|all] [reps] [batch] [max_waiters]\n",
+		 argv[0] );
+	exit( 1 );
+    }
+
+    calibrate();
+    printf( "scheduler ops threads=%lu reps=%u batch=%u tsc=%.3lf GHz"
+	    " rdtsc=%.0lf cycles\n",
+	    (unsigned long)nthreads, reps, batch, 1.0 / ns_per_tick,
+	    rdtsc_overhead );
+
+    bool any = false;
+    if( selected( op, "spawn-sync" ) ) {
+	measure( "spawn-sync", bench_spawn_sync );
+	any = true;
+    }
+    if( selected( op, "spawn" ) ) {
+	measure( "spawn", bench_spawn );
+	any = true;
+    }
+    if( selected( op, "call" ) ) {
+	measure( "call", bench_call );
+	any = true;
+    }
+    if( selected( op, "leaf_call" ) ) {
+	measure( "leaf_call", bench_leaf_call );
+	any = true;
+    }
+    if( selected( op, "steal" ) ) {
+	if( nthreads > 1 )
+	    measure( "steal", bench_steal );
+	else
+	    na( "steal", "needs NUM_THREADS > 1" );
+	any = true;
+    }
+    if( selected( op, "release" ) ) {
+	for( unsigned int k=1; k <= max_waiters; k *= 2 ) {
+	    char what[32];
+	    sprintf( what, "release-%u", k );
+	    if( nthreads > 1 ) {
+		s.clear();
+		run( bench_release, k );
+		s.print( what, k > nthreads ? "waiters run in turn" : 0 );
+	    } else
+		na( what, "needs NUM_THREADS > 1" );
+	}
+	any = true;
+    }
+    if( selected( op, "outdep" ) ) {
+	measure( "outdep", bench_outdep );
+	if( nthreads > 1 )
+	    measure( "outdep-rename", bench_rename );
+	else
+	    na( "outdep-rename", "needs NUM_THREADS > 1" );
+	any = true;
+    }
+    if( selected( op, "reduction" ) ) {
+	measure( "reduction", bench_reduction );
+	any = true;
+    }
+    if( selected( op, "queue" ) ) {
+#if HAVE_HYPERQUEUE
+	s_push.clear();
+	s_pop.clear();
+	run( bench_queue );
+	s_push.print( "queue-push" );
+	s_pop.print( "queue-pop" );
+#else
+	na( "queue-push", "no hyperqueues in this backend" );
+	na( "queue-pop", "no hyperqueues in this backend" );
+#endif
+	any = true;
+    }
+    if( selected( op, "slice" ) ) {
+	char what[32];
+#if HAVE_HYPERQUEUE
+	s_push.clear();
+	s_pop.clear();
+	run( bench_slice );
+	sprintf( what, "wslice-%d", SLICE );
+	s_push.print( what );
+	sprintf( what, "rslice-%d", SLICE );
+	s_pop.print( what );
+#else
+	sprintf( what, "wslice-%d", SLICE );
+	na( what, "no hyperqueues in this backend" );
+	sprintf( what, "rslice-%d", SLICE );
+	na( what, "no hyperqueues in this backend" );
+#endif
+	any = true;
+    }
+
+    if( !any ) {
+	fprintf( stderr, "Unknown operation '%s'\n", op );
+	exit( 1 );
+    }
+
+    return 0;
+}
@@ -0,0 +1,124 @@
+/*
+ * Copyright (C) 2011 Hans Vandierendonck (hvandierendonck@acm.org)
+ * Copyright (C) 2011 George Tzenakis (tzenakis@ics.forth.gr)
+ * Copyright (C) 2011 Dimitrios S. Nikolopoulos (dsn@ics.forth.gr)
+ *
+ * This file is part of Swan.
+ *
+ * Swan is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Swan is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Swan.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Startup microbenchmark: measures the time from process start-up until
+ * the first task executes, and until every worker has executed a task.
+ * The process start time is taken in a high-priority constructor, which
+ * runs before the static initializer of the runtime system.
+ *
+ * Usage: NUM_THREADS=<threads> ./ustartup
+ * See startup.sh for a sweep over the number of threads.
+ */
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <errno.h>
+#include <string.h>
+
+#include "wf_interface.h"
+
+// ----------------------------------------------------------------------
+// Time measurement
+// ----------------------------------------------------------------------
+typedef struct timespec time_val_t;
+
+static void get_time( time_val_t * tm ) {
+    if( clock_gettime( CLOCK_MONOTONIC, tm ) < 0 ) {
+	fprintf( stderr, "clock_gettime: %s\n", strerror( errno ) );
+	exit( 1 );
+    }
+}
+
+static double elapsed_us( const time_val_t * from, const time_val_t * to ) {
+    return double(to->tv_sec - from->tv_sec) * 1e6
+	+ double(to->tv_nsec - from->tv_nsec) * 1e-3;
+}
+
+static time_val_t t_process;
+static time_val_t t_main;
+static time_val_t t_first_task;
+static time_val_t t_all_workers;
+
+static void record_process_start() __attribute__((constructor(101)));
+static void record_process_start() {
+    get_time( &t_process );
+}
+
+// ----------------------------------------------------------------------
+// Tasks
+// ----------------------------------------------------------------------
+extern size_t nthreads;
+static volatile size_t workers_seen;
+static volatile bool * worker_seen;
+
+void first_task() {
+    get_time( &t_first_task );
+}
+
+// Spin until all workers have picked up one of the spawned tasks, or
+// until some worker has executed a lot of them (in case some worker
+// never gets to run).
+void touch( int i ) {
+    extern __thread size_t threadid;
+    if( !worker_seen[threadid] ) {
+	worker_seen[threadid] = true;
+	if( __sync_add_and_fetch( &workers_seen, 1 ) == nthreads )
+	    get_time( &t_all_workers );
+    }
+    while( workers_seen < nthreads && i-- > 0 )
+	sched_yield();
+}
+
+void all_workers() {
+    for( size_t i=0; i < 16*nthreads; ++i )
+	spawn( touch, 1000 );
+    ssync();
+}
+
+// ----------------------------------------------------------------------
+// Benchmark dispatch
+// ----------------------------------------------------------------------
+int main( int argc, char* argv[] ) {
+    get_time( &t_main );
+
+    run( first_task );
+
+    worker_seen = new bool[nthreads];
+    for( size_t i=0; i < nthreads; ++i )
+	worker_seen[i] = false;
+    run( all_workers );
+
+    printf( "threads=%lu\n", (unsigned long)nthreads );
+    printf( "Time to main %.3lf us\n", elapsed_us( &t_process, &t_main ) );
+    printf( "Time to first task %.3lf us\n",
+	    elapsed_us( &t_process, &t_first_task ) );
+    if( workers_seen == nthreads )
+	printf( "Time to all workers %.3lf us\n",
+		elapsed_us( &t_process, &t_all_workers ) );
+    else
+	printf( "Time to all workers n/a (%lu of %lu workers seen)\n",
+		(unsigned long)workers_seen, (unsigned long)nthreads );
+
+    delete[] worker_seen;
+    return 0;
+}
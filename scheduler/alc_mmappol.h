@@ -26,13 +26,126 @@
 #include "swan_config.h"
 
 #include <sys/mman.h>
+#include <unistd.h>
 
 #include <cassert>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <limits>
 #include <vector>
 
 namespace alc {
 
+// ----------------------------------------------------------------------
+// Huge pages. Large mappings are aligned to 2 MB and backed by
+// transparent huge pages (madvise) or by hugetlbfs (MAP_HUGETLB, falls
+// back to transparent huge pages when none are reserved). Selected at run
+// time by HUGE_PAGES=none|thp|hugetlb, default thp. See HUGE_PAGE_ALLOC.
+// ----------------------------------------------------------------------
+static const size_t huge_page_size = size_t(2) << 20;
+
+enum huge_page_mode_t {
+    hpm_none,
+    hpm_thp,
+    hpm_hugetlb
+};
+
+static inline huge_page_mode_t parse_huge_page_mode() {
+    const char * str = getenv( "HUGE_PAGES" );
+    if( !str || !*str || !strcmp( str, "thp" ) )
+	return hpm_thp;
+    if( !strcmp( str, "none" ) )
+	return hpm_none;
+    if( !strcmp( str, "hugetlb" ) )
+	return hpm_hugetlb;
+    fprintf( stderr, "HUGE_PAGES: unknown mode '%s', expecting none, thp "
+	     "or hugetlb\n", str );
+    exit( 2 );
+}
+
+inline huge_page_mode_t huge_page_mode() {
+    static const huge_page_mode_t mode
+	= HUGE_PAGE_ALLOC ? parse_huge_page_mode() : hpm_none;
+    return mode;
+}
+
+// Map a region of n bytes with huge pages? Only if at most half of the
+// last huge page is wasted. The decision is the same on unmapping.
+static inline bool use_huge_pages( size_t n ) {
+    return n >= huge_page_size/2 && huge_page_mode() != hpm_none;
+}
+
+static inline size_t huge_map_size( size_t n ) {
+    return ( n + huge_page_size - 1 ) & ~( huge_page_size - 1 );
+}
+
+// Map n bytes, a multiple of huge_page_size, aligned to huge_page_size.
+// Returns 0 on failure.
+static inline void * map_huge_pages( size_t n ) {
+#ifdef MAP_HUGETLB
+    if( huge_page_mode() == hpm_hugetlb ) {
+	void * ptr = mmap( 0, n, PROT_WRITE|PROT_READ,
+			   MAP_ANON|MAP_PRIVATE|MAP_HUGETLB, -1, 0 );
+	if( ptr != MAP_FAILED )
+	    return ptr;
+    }
+#endif
+    // Over-allocate and trim to the alignment
+    char * ptr = (char *)mmap( 0, n + huge_page_size, PROT_WRITE|PROT_READ,
+			       MAP_ANON|MAP_PRIVATE, -1, 0 );
+    if( ptr == (char *)MAP_FAILED )
+	return 0;
+    size_t head = ( huge_page_size - uintptr_t(ptr) ) & ( huge_page_size-1 );
+    if( head > 0 )
+	munmap( ptr, head );
+    munmap( ptr + head + n, huge_page_size - head );
+    ptr += head;
+#ifdef MADV_HUGEPAGE
+    madvise( ptr, n, MADV_HUGEPAGE );
+#endif
+    return ptr;
+}
+
+// ----------------------------------------------------------------------
+// Mirrored mappings. The same n bytes of memory are mapped twice, at ptr
+// and at ptr+n, such that a ring buffer of n bytes may be accessed
+// contiguously across its end. n must be a multiple of the page size.
+// Linux only. See QUEUE_MIRROR.
+// ----------------------------------------------------------------------
+static inline size_t page_size() {
+    static const size_t size = sysconf( _SC_PAGESIZE );
+    return size;
+}
+
+// Returns 0 when not supported or on failure.
+static inline void * map_mirrored( size_t n ) {
+#if defined(__linux__) && defined(MREMAP_FIXED)
+    // Reserve address space for both views
+    char * ptr = (char *)mmap( 0, 2*n, PROT_NONE,
+			       MAP_ANON|MAP_PRIVATE, -1, 0 );
+    if( ptr == (char *)MAP_FAILED )
+	return 0;
+    // The memory must be shared for mremap() with old size 0 to create a
+    // second view of the same pages rather than moving them
+    if( mmap( ptr, n, PROT_WRITE|PROT_READ,
+	      MAP_ANON|MAP_SHARED|MAP_FIXED, -1, 0 ) == MAP_FAILED
+	|| mremap( ptr, 0, n, MREMAP_MAYMOVE|MREMAP_FIXED, ptr+n )
+	== MAP_FAILED ) {
+	munmap( ptr, 2*n );
+	return 0;
+    }
+    return ptr;
+#else
+    return 0;
+#endif
+}
+
+static inline void unmap_mirrored( void * ptr, size_t n ) {
+    munmap( ptr, 2*n );
+}
+
 template<typename T, size_t Align>
 class mmap_alloc_policy {
 public : 
@@ -62,6 +175,13 @@ public :
     // memory allocation
     inline pointer allocate(size_type cnt, 
 			    typename std::allocator<void>::const_pointer = 0) { 
+	if( huge( cnt ) ) {
+	    // Aligned to a huge page, hence to Align
+	    void * ptr = map_huge_pages( huge_map_size( restore_offset( cnt ) ) );
+	    assert( ptr && "Cannot mmap() memory" );
+	    return reinterpret_cast<pointer>( ptr );
+	}
+
 	size_type alc_size = alloc_size( cnt );
 	void * ptr = mmap( 0, alc_size, PROT_WRITE|PROT_READ,
 			   MAP_ANON|MAP_PRIVATE, -1, 0 );
@@ -73,6 +193,11 @@ public :
 	return reinterpret_cast<pointer>( start );
     }
     inline void deallocate(pointer p, size_type cnt) {
+	if( huge( cnt ) ) {
+	    munmap( p, huge_map_size( restore_offset( cnt ) ) );
+	    return;
+	}
+
 	size_type alc_size = alloc_size( cnt );
 	intptr_t start = reinterpret_cast<intptr_t>( p );
 	void * ptr = *(void **)(start + restore_offset(cnt));
@@ -92,6 +217,9 @@ private:
     static size_type restore_offset( size_type cnt ) {
         return (cnt-1)*align_size + sizeof(T);
     }
+    static bool huge( size_type cnt ) {
+	return Align <= huge_page_size && use_huge_pages( restore_offset( cnt ) );
+    }
 };    //    end of class mmap_alloc_policy
 
 
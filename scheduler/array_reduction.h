@@ -0,0 +1,113 @@
+/*
+ * Copyright (C) 2011 Hans Vandierendonck (hvandierendonck@acm.org)
+ * Copyright (C) 2011 George Tzenakis (tzenakis@ics.forth.gr)
+ * Copyright (C) 2011 Dimitrios S. Nikolopoulos (dsn@ics.forth.gr)
+ *
+ * This file is part of Swan.
+ *
+ * Swan is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Swan is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Swan.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Monads for chunked reductions on arrays (see chunked_reduction_tag in
+ * object.h), e.g. histograms and vector sums:
+ *
+ *    typedef obj::array_add_monad<unsigned, 1<<18> hist_monad;
+ *    void count( reduction<hist_monad> h, ... ) { h[bin]++; }
+ *
+ * The combine kernels operate on 16-byte vectors. Private chunks are
+ * aligned to CACHE_ALIGNMENT and the chunk size must be a multiple of the
+ * vector length, so the kernels need no alignment prologue.
+ */
+#ifndef ARRAY_REDUCTION_H
+#define ARRAY_REDUCTION_H
+
+#include <cstddef>
+#include <cstring>
+#include <type_traits>
+
+#include "swan_config.h"
+#include "wf_interface.h"
+#include "object.h"
+
+namespace obj {
+
+// Combine two arrays of n elements element-wise: left = Op( left, right ).
+// Op provides the scalar and the vector operation.
+template<typename T, typename Op>
+static inline void
+array_combine( T * __restrict left, const T * __restrict right, size_t n ) {
+    typedef T vec_t __attribute__((vector_size(16)));
+    // The object itself need not be 16-byte aligned
+    typedef T vec_u __attribute__((vector_size(16), aligned(sizeof(T)),
+				   may_alias));
+    static const size_t VL = sizeof(vec_t) / sizeof(T);
+
+    vec_u * __restrict l = reinterpret_cast<vec_u *>( left );
+    const vec_t * __restrict r = reinterpret_cast<const vec_t *>( right );
+    size_t nv = n / VL;
+    size_t i = 0;
+    for( ; i+4 <= nv; i += 4 ) { // unrolled to hide latency
+	l[i] = Op::apply( l[i], r[i] );
+	l[i+1] = Op::apply( l[i+1], r[i+1] );
+	l[i+2] = Op::apply( l[i+2], r[i+2] );
+	l[i+3] = Op::apply( l[i+3], r[i+3] );
+    }
+    for( ; i < nv; ++i )
+	l[i] = Op::apply( l[i], r[i] );
+    for( size_t j=nv*VL; j < n; ++j )
+	left[j] = Op::apply( left[j], right[j] );
+}
+
+struct array_add_op {
+    template<typename V>
+    static V apply( V a, V b ) { return a + b; }
+};
+
+struct array_or_op {
+    template<typename V>
+    static V apply( V a, V b ) { return a | b; }
+};
+
+// Monad template for element-wise reductions with identity 0.
+template<typename T, size_t N, typename Op, size_t ChunkSize>
+struct array_zero_monad {
+    typedef T value_type[N];
+    typedef chunked_reduction_tag reduction_tag;
+    static const size_t chunk_size = ChunkSize;
+
+    static_assert( std::is_arithmetic<T>::value,
+		   "array monads apply to arithmetic element types" );
+    static_assert( ( chunk_size * sizeof(T) ) % 16 == 0,
+		   "chunk size must be a multiple of the vector length" );
+
+    static void identity( T * p, size_t n ) { memset( p, 0, n * sizeof(T) ); }
+    static void reduce( T * left, const T * right, size_t n ) {
+	array_combine<T, Op>( left, right, n );
+    }
+};
+
+// Element-wise sum, e.g. histograms and vector sums
+template<typename T, size_t N, size_t ChunkSize = 4096/sizeof(T)>
+struct array_add_monad
+    : public array_zero_monad<T, N, array_add_op, ChunkSize> { };
+
+// Element-wise bitwise or, e.g. bitmaps
+template<typename T, size_t N, size_t ChunkSize = 4096/sizeof(T)>
+struct array_or_monad
+    : public array_zero_monad<T, N, array_or_op, ChunkSize> { };
+
+} // end of namespace obj
+
+#endif // ARRAY_REDUCTION_H
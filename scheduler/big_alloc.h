@@ -31,6 +31,9 @@
 #include <cassert>
 #include <vector>
 
+#include "alc_mmappol.h"
+#include "lock.h"
+
 template<typename T, size_t Chunk, size_t Align>
 class big_mmap_allocator {
     struct node_t {
@@ -50,7 +53,7 @@ public:
     ~big_mmap_allocator() {
 	for( std::vector<void *>::const_iterator
 		 I=chunks.begin(), E=chunks.end(); I != E; ++I )
-	    munmap( *I, sizeof(T) );
+	    munmap( *I, map_size() );
     }
 
     T * allocate() {
@@ -68,9 +71,19 @@ public:
     }
 
 private:
+    static bool huge() {
+	return Align <= alc::huge_page_size
+	    && alc::use_huge_pages( sizeof(T)*Chunk );
+    }
+    static size_t map_size() {
+	return huge() ? alc::huge_map_size( sizeof(T)*Chunk ) : sizeof(T)*Chunk;
+    }
+
     void refill( void ) {
-	void * ptr = mmap( 0, sizeof(T)*Chunk, PROT_WRITE|PROT_READ,
-			   MAP_ANON|MAP_PRIVATE, -1, 0 );
+	void * ptr = huge() ? alc::map_huge_pages( map_size() )
+	    : mmap( 0, map_size(), PROT_WRITE|PROT_READ,
+		    MAP_ANON|MAP_PRIVATE, -1, 0 );
+	assert( ptr && ptr != MAP_FAILED && "Cannot mmap() memory" );
 	assert( (intptr_t(ptr) & (Align-1)) == 0 || Chunk > 1 );
 
 	chunks.push_back( ptr );
@@ -89,4 +102,138 @@ private:
 };
 
 
+namespace alc {
+
+// Arena for large object payloads, carved out of huge-page regions. Sizes
+// are rounded up to one of four classes per power of two, so at most 25%
+// is wasted. A region holds blocks of one class. Blocks from 1 MB up are
+// mapped individually. Freed blocks are kept for reuse by any thread. Once
+// the free blocks of a class exceed PAYLOAD_ARENA_RETAIN bytes, the pages of
+// further freed blocks are returned to the OS, all but the one holding the
+// free list link.
+class payload_arena {
+public:
+    static const size_t min_size = 4096;   // smaller: use the default heap
+    static const uint32_t no_class = ~uint32_t(0);
+
+private:
+    static const size_t max_size = huge_page_size/2;
+    static const uint32_t num_classes = 1 + ( 20 - 12 ) * 4;
+    static const uint32_t mapped_class = num_classes;
+    static const size_t mapped_header = 64; // holds the mapped size
+
+    struct block_t {
+	block_t * next;
+	bool released;      // pages beyond the first returned to the OS
+    };
+    struct size_class {
+	cas_mutex mutex;
+	block_t * free;
+	size_t resident;    // bytes in free blocks that are not released
+	char * next, * end; // unused part of the current region
+    } __cache_aligned;
+
+    static size_class * classes() {
+	static size_class cls[num_classes];
+	return cls;
+    }
+
+    // Class index of a block of n bytes, min_size < n <= max_size
+    static uint32_t class_of( size_t n ) {
+	if( n <= min_size )
+	    return 0;
+	unsigned p = 63 - __builtin_clzl( n-1 ); // 2^p < n <= 2^(p+1)
+	size_t step = size_t(1) << (p-2);
+	size_t k = ( n - (size_t(1) << p) + step - 1 ) / step;
+	return 1 + ( p - 12 ) * 4 + ( k - 1 );
+    }
+    static size_t class_size( uint32_t c ) {
+	if( c == 0 )
+	    return min_size;
+	unsigned p = 12 + ( c - 1 ) / 4;
+	return ( size_t(1) << p ) + ( ( c - 1 ) % 4 + 1 ) * ( size_t(1) << (p-2) );
+    }
+
+public:
+    // Allocate n bytes, aligned to CACHE_ALIGNMENT. Returns 0 if the arena
+    // does not serve this size, e.g., with huge pages disabled.
+    static void * allocate( size_t n, uint32_t & cls ) {
+	if( n < min_size || huge_page_mode() == hpm_none )
+	    return 0;
+
+	if( n > max_size ) {
+	    size_t sz = huge_map_size( n + mapped_header );
+	    char * ptr = (char *)map_huge_pages( sz );
+	    if( !ptr )
+		return 0;
+	    *(size_t *)ptr = sz;
+	    cls = mapped_class;
+	    return ptr + mapped_header;
+	}
+
+	cls = class_of( n );
+	size_class & c = classes()[cls];
+	size_t sz = class_size( cls );
+	void * ptr = 0;
+	c.mutex.lock();
+	if( c.free ) {
+	    ptr = c.free;
+	    if( !c.free->released )
+		c.resident -= sz;
+	    c.free = c.free->next;
+	} else {
+	    if( c.next + sz > c.end ) {
+		char * region = (char *)map_huge_pages( huge_page_size );
+		if( region ) {
+		    c.next = region;
+		    c.end = region + huge_page_size;
+		}
+	    }
+	    if( c.next + sz <= c.end ) {
+		ptr = c.next;
+		c.next += sz;
+	    }
+	}
+	c.mutex.unlock();
+	return ptr;
+    }
+
+    static void deallocate( void * ptr, uint32_t cls ) {
+	if( cls == mapped_class ) {
+	    char * base = (char *)ptr - mapped_header;
+	    munmap( base, *(size_t *)base );
+	    return;
+	}
+
+	size_class & c = classes()[cls];
+	size_t sz = class_size( cls );
+	block_t * b = reinterpret_cast<block_t *>( ptr );
+	c.mutex.lock();
+	b->released = c.resident >= PAYLOAD_ARENA_RETAIN;
+	if( !b->released )
+	    c.resident += sz;
+	b->next = c.free;
+	c.free = b;
+	c.mutex.unlock();
+
+	if( b->released )
+	    release( (char *)ptr, sz );
+    }
+
+private:
+    // Return the whole pages of a free block to the OS, keeping the page
+    // with the block_t. The pages read as zero when the block is reused.
+    // This splits transparent huge pages and is ignored for hugetlbfs.
+    static void release( char * ptr, size_t sz ) {
+	const uintptr_t page = 4096;
+	uintptr_t from = ( uintptr_t(ptr) + sizeof(block_t) + page - 1 )
+	    & ~( page - 1 );
+	uintptr_t to = ( uintptr_t(ptr) + sz ) & ~( page - 1 );
+	if( from < to )
+	    madvise( (void *)from, to - from, MADV_DONTNEED );
+    }
+};
+
+} // namespace alc
+
 #endif // BIG_ALLOC_H
@@ -384,7 +384,11 @@ public:
 public:
     // External inferface
     bool rename_is_active() const { return gen->has_tasks(); }
-    bool rename_has_readers() const { return gen->has_tasks(); }
+    // Readers in the youngest generation make inout renaming worthwhile.
+    // Writers are reported conservatively.
+    bool rename_has_readers() const {
+	return gen->group == g_read && gen->has_tasks();
+    }
     bool rename_has_writers() const { return gen->has_tasks(); }
 
     generation * get_prev_generation() { return prev; }
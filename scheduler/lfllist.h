@@ -784,7 +784,9 @@ private:
 
 // This is a mock-up resizing hash table. Should use something proven such
 // as hopscotch hashing perhaps.
-template<typename T>
+// Elements are hashed on the key Key::get_depth(), by default their depth.
+// Scans visit the lowest keys first.
+template<typename T, typename Key = dl_list_traits<T> >
 class resizing_hashed_list {
     typedef locked_dl_list<T> list_t;
     size_t size;
@@ -813,13 +815,13 @@ public:
     }
 
     void push( T * elm ) {
-	size_t d = dl_list_traits<T>::get_depth( elm );
+	size_t d = Key::get_depth( elm );
 	size_t h = hash(d);
 	list_t & list = table[h];
 	mcs_mutex::node node;
 	list.lock( &node );
 	if( T * f = list.front() ) {
-	    if( dl_list_traits<T>::get_depth( f ) != d ) {
+	    if( Key::get_depth( f ) != d ) {
 		list.unlock( &node );
 		grow();
 		push( elm );
@@ -1018,7 +1020,7 @@ private:
 	    mcs_mutex::node l_node;
 	    old_l.lock( &l_node ); // just in case someone has a ref to the table...
 	    if( T * f = old_l.front() ) {
-		size_t h = hash( f->get_depth() );
+		size_t h = hash( Key::get_depth( f ) );
 		// Swap list only, not lock
 		table[h].swap( old_l );
 		update_bounds( h );
@@ -19,10 +19,54 @@
  * along with Swan.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <cstdio>
+#include <cstdlib>
+
 #include "object.h"
 
 namespace obj {
 
+#if OBJECT_THROTTLE
+throttle_state throttle;
+
+static size_t getenv_size( const char * name ) {
+    const char * str = getenv( name );
+    if( !str || !*str )
+	return 0;
+    char * end;
+    unsigned long long v = strtoull( str, &end, 10 );
+    switch( *end ) { // Optional suffix
+    case 'k': case 'K': v <<= 10; ++end; break;
+    case 'm': case 'M': v <<= 20; ++end; break;
+    case 'g': case 'G': v <<= 30; ++end; break;
+    }
+    if( *end ) {
+	fprintf( stderr, "%s: invalid value '%s'\n", name, str );
+	exit( 2 );
+    }
+    return size_t( v );
+}
+
+void throttle_state::configure() {
+    rename_budget = getenv_size( "RENAME_BUDGET" );
+    pending_budget = getenv_size( "PENDING_BUDGET" );
+}
+
+void throttle_state::dump_statistics() const {
+    if( !rename_budget && !pending_budget )
+	return;
+    fprintf( stderr, "Throttling: rename budget=%lu bytes, renames denied=%lu,"
+	     " pending budget=%lu frames, spawns throttled=%lu\n",
+	     (unsigned long)rename_budget, (unsigned long)num_rename_denied,
+	     (unsigned long)pending_budget,
+	     (unsigned long)num_spawn_throttled );
+}
+#endif // OBJECT_THROTTLE
+
+#if OBJECT_TASKGRAPH == 1 && OBJECT_COMMUTATIVITY
+__thread tkt_cmt_batch tls_tkt_cmt_batch;
+#endif
+
 #if PROFILE_OBJECT && OBJECT_TASKGRAPH > 0
 statistics statistic;
 
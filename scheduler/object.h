@@ -47,6 +47,7 @@
 #include "wf_frames.h"
 #include "padding.h"
 #include "lock.h"
+#include "big_alloc.h"
 
 #include "debug.h"
 
@@ -84,6 +85,10 @@ template<typename T, obj_modifiers_t OMod>
 class object_t; // versioned;
 template<typename T, obj_modifiers_t OMod>
 class unversioned;
+template<typename T, obj_modifiers_t OMod>
+class cow_object; // in place, versioned on contention
+template<typename T>
+class region_object_t; // region-tracked, see region.h
 
 class obj_dep_traits;
 //-----------------------------------------------------------------------
@@ -194,6 +199,9 @@ struct statistics {
     size_t v_rename_inout;
     size_t v_rename_inout_task;
     size_t v_rename_unversioned;
+    size_t v_cow_home;
+    size_t v_cow_heap;
+    size_t v_cow_copy;
     size_t v_arg_in;
     size_t v_arg_out;
     size_t v_arg_inout;
@@ -217,6 +225,9 @@ struct statistics {
 		  << DUMP(rename_inout)
 		  << DUMP(rename_inout_task)
 		  << DUMP(rename_unversioned)
+		  << DUMP(cow_home)
+		  << DUMP(cow_heap)
+		  << DUMP(cow_copy)
 		  << DUMP(arg_in)
 		  << DUMP(arg_out)
 		  << DUMP(arg_inout)
@@ -244,6 +255,74 @@ extern statistics statistic;
 #define OBJ_PROF(x)
 #endif
 
+// ------------------------------------------------------------------------
+// Throttling: budgets on the bytes held by renamed versions and on the
+// number of pending frames. A budget of 0 is unlimited, in which case
+// nothing is counted.
+// ------------------------------------------------------------------------
+#if OBJECT_THROTTLE
+class throttle_state {
+    volatile intptr_t renamed_bytes;    // live bytes in renamed versions
+    volatile intptr_t pending_frames;   // pending frames not yet started
+    size_t rename_budget;
+    size_t pending_budget;
+    volatile size_t num_rename_denied;
+    volatile size_t num_spawn_throttled;
+
+public:
+    // No constructor: the global instance is zero-initialized before any
+    // static constructor (wf_initialize) runs.
+
+    // Read RENAME_BUDGET and PENDING_BUDGET from the environment
+    void configure();
+    // Report how often throttling kicked in
+    void dump_statistics() const;
+
+    // Only change the budgets while no tasks are outstanding: whether
+    // tags and frames are counted depends on them.
+    void set_rename_budget( size_t bytes ) { rename_budget = bytes; }
+    void set_pending_budget( size_t frames ) { pending_budget = frames; }
+
+    size_t get_renamed_bytes() const { return renamed_bytes; }
+    size_t get_pending_frames() const { return pending_frames; }
+    size_t get_num_rename_denied() const { return num_rename_denied; }
+    size_t get_num_spawn_throttled() const { return num_spawn_throttled; }
+
+    // Renaming
+    bool counts_renames() const { return rename_budget != 0; }
+    bool may_rename( size_t sz ) const {
+	return !rename_budget
+	    || size_t( renamed_bytes ) + sz <= rename_budget;
+    }
+    void add_renamed( size_t sz ) {
+	__sync_fetch_and_add( &renamed_bytes, intptr_t( sz ) );
+    }
+    void del_renamed( size_t sz ) {
+	__sync_fetch_and_add( &renamed_bytes, -intptr_t( sz ) );
+    }
+    void rename_denied() { __sync_fetch_and_add( &num_rename_denied, 1 ); }
+
+    // Pending frames
+    void add_pending() {
+	if( pending_budget )
+	    __sync_fetch_and_add( &pending_frames, 1 );
+    }
+    void del_pending() {
+	if( pending_budget )
+	    __sync_fetch_and_add( &pending_frames, -1 );
+    }
+    bool pending_over_budget() const {
+	return pending_budget && size_t( pending_frames ) >= pending_budget;
+    }
+    // A spawn was held back to execute pending frames
+    void spawn_throttled() {
+	__sync_fetch_and_add( &num_spawn_throttled, 1 );
+    }
+};
+
+extern throttle_state throttle;
+#endif // OBJECT_THROTTLE
+
 // ------------------------------------------------------------------------
 // Concepts
 // ------------------------------------------------------------------------
@@ -343,6 +422,9 @@ struct is_queue_dep
 			     || is_object_with_tag<T, popdep_type_tag>::value
 			     || is_object_with_tag<T, pushdep_type_tag>::value
 			     > { };
+// Dependencies on a region of a region_object_t, specialized in region.h
+template<typename T>
+struct is_region_dep : std::false_type { };
 
 // ------------------------------------------------------------------------
 // Classes to support versioning of objects
@@ -426,6 +508,13 @@ public:
 	if( dfn )
 	    (*dfn)( ptr );
     }
+
+    // Only for class types: does this describe a T?
+    template<typename T>
+    bool is() const {
+	static_assert( std::is_class<T>::value, "typeinfo::is<T> on class" );
+	return dfn == destructor_get<T>::get_destructor();
+    }
 };
 
 class typeinfo_array {
@@ -495,14 +584,16 @@ class obj_payload {
     typedef uint32_t ctr_t;
 private:
     ctr_t refcnt;
+    ctr_t arena; // size class in alc::payload_arena, or no_class
     typeinfo tinfo;
-    pad_multiple<64, sizeof(ctr_t)+sizeof(typeinfo)> pad; // put payload at 64-byte boundary
+    pad_multiple<64, 2*sizeof(ctr_t)+sizeof(typeinfo)> pad; // put payload at 64-byte boundary
 
     template<typename MetaData>
     friend class obj_version;
 
-    obj_payload( typeinfo tinfo_, int refcnt_init=1 )
-	: refcnt( refcnt_init ), tinfo( tinfo_ ) {
+    obj_payload( typeinfo tinfo_, int refcnt_init=1,
+		 ctr_t arena_=alc::payload_arena::no_class )
+	: refcnt( refcnt_init ), arena( arena_ ), tinfo( tinfo_ ) {
 	// std::cerr << "Create obj_payload " << this << "\n";
     }
     ~obj_payload() {
@@ -516,6 +607,11 @@ public:
     // Dynamic memory allocation create function
     static obj_payload *
     create( size_t n, typeinfo tinfo ) {
+#if HUGE_PAGE_ALLOC
+	ctr_t cls;
+	if( void * a = alc::payload_arena::allocate( sizeof(obj_payload)+n, cls ) )
+	    return new (a) obj_payload( tinfo, 1, cls );
+#endif
 	char * p = new char[sizeof(obj_payload)+n];
 	return new (p) obj_payload( tinfo );
     }
@@ -523,7 +619,7 @@ public:
     // In-place create function for unversioned objects
     static constexpr size_t
     size( size_t n ) {
-	return n == 0 ? (sizeof(ctr_t)+sizeof(typeinfo))
+	return n == 0 ? (2*sizeof(ctr_t)+sizeof(typeinfo))
 	    : sizeof(obj_payload)+n;
     }
     static obj_payload *
@@ -541,13 +637,21 @@ public:
 	assert( refcnt > 0 );
 	// Check equality to 1 because we check value before decrement.
 	if( __sync_fetch_and_add( &refcnt, -1 ) == 1 ) { // atomic!
-	    delete this;
+	    if( arena != alc::payload_arena::no_class ) {
+		ctr_t cls = arena;
+		this->~obj_payload();
+		alc::payload_arena::deallocate( this, cls );
+	    } else
+		delete this;
 	}
     }
 
     void destruct() {
 	tinfo.destruct( get_ptr() );
     }
+
+    template<typename T>
+    bool holds() const { return tinfo.template is<T>(); }
 };
 
 // obj_reduction_md: metadata to maintain multiple instances of an object
@@ -560,6 +664,64 @@ public:
 //    no need to optimize that case in the code of this class.
 struct expensive_reduction_tag { };
 struct cheap_reduction_tag { };
+// Chunked reductions apply to monads with an array value_type E[N]. The
+// monad defines chunk_size (in elements) and the range operations
+//    static void identity( E * p, size_t n );
+//    static void reduce( E * left, const E * right, size_t n );
+// A thread privatizes only the chunks it touches, on first touch, and the
+// private chunks are combined in parallel, chunk by chunk. Tasks access
+// the data through reduction<M>::chunk() or reduction<M>::operator [].
+// array_reduction.h provides monads with vectorized combine kernels.
+struct chunked_reduction_tag { };
+
+// reduction_chunks: the payload of a private version of a chunked reduction.
+template<typename Monad>
+class reduction_chunks {
+public:
+    typedef typename std::remove_all_extents<typename Monad::value_type>::type
+	element_type;
+    static const size_t num_elements
+	= sizeof(typename Monad::value_type) / sizeof(element_type);
+    static const size_t chunk_size = Monad::chunk_size;
+    static const size_t num_chunks
+	= ( num_elements + chunk_size - 1 ) / chunk_size;
+
+private:
+    element_type * chunks[num_chunks];
+
+public:
+    reduction_chunks() { std::fill( &chunks[0], &chunks[num_chunks], 
+				    (element_type *)0 ); }
+    ~reduction_chunks() {
+	for( size_t k=0; k < num_chunks; ++k )
+	    release( k );
+    }
+
+    static size_t length( size_t k ) {
+	return k+1 < num_chunks ? chunk_size : num_elements - k * chunk_size;
+    }
+
+    // Chunk k, privatized and set to the identity on first touch.
+    element_type * get( size_t k ) {
+	if( unlikely( !chunks[k] ) ) {
+	    void * p;
+	    if( posix_memalign( &p, CACHE_ALIGNMENT,
+				length( k ) * sizeof(element_type) ) ) {
+		fprintf( stderr, "ERROR: cannot allocate reduction chunk\n" );
+		exit( 2 );
+	    }
+	    chunks[k] = reinterpret_cast<element_type *>( p );
+	    Monad::identity( chunks[k], length( k ) );
+	}
+	return chunks[k];
+    }
+    // Chunk k if it has been touched, else 0.
+    element_type * peek( size_t k ) const { return chunks[k]; }
+    void release( size_t k ) {
+	free( chunks[k] );
+	chunks[k] = 0;
+    }
+};
 
 template<typename MetaData>
 class obj_reduction_md {
@@ -625,11 +787,37 @@ class obj_reduction_md {
 	    }
 	}
 
+	template<typename Monad>
+	void initialize( size_t sz, obj_version<MetaData> * pref, bool use_pref,
+			 chunked_reduction_tag ) {
+	    static_assert( std::is_array<typename Monad::value_type>::value,
+			   "Chunked reductions require an array value_type" );
+#if STORED_ANNOTATIONS
+	    static_assert( sizeof(Monad) == 0,
+			   "Chunked reductions require !STORED_ANNOTATIONS" );
+#endif
+	    if( use_pref ) {
+		version = pref;
+		is_pref = true;
+	    } else {
+		// Only the table of chunks; chunks are allocated when touched
+		typedef reduction_chunks<Monad> chunks_t;
+		version = obj_version<MetaData>::template create<chunks_t>(
+		    sizeof(chunks_t), 0 );
+		is_pref = false;
+	    }
+	    assigned = assign_mutex();
+	}
+
 	template<typename Monad>
 	obj_version<MetaData> * try_reserve( cheap_reduction_tag ) {
 	    return assigned.try_lock() ? version : 0;
 	}
 	template<typename Monad>
+	obj_version<MetaData> * try_reserve( chunked_reduction_tag ) {
+	    return assigned.try_lock() ? version : 0;
+	}
+	template<typename Monad>
 	obj_version<MetaData> * try_reserve( expensive_reduction_tag ) {
 	    if( assigned.try_lock() ) {
 		if( need_identity ) {
@@ -647,6 +835,16 @@ class obj_reduction_md {
 	need_reduction( obj_version<MetaData> * orig, cheap_reduction_tag ) {
 	    return version && version != orig ? version : 0;
 	}
+
+	template<typename Monad>
+	reduction_chunks<Monad> *
+	need_reduction( obj_version<MetaData> * orig, chunked_reduction_tag ) {
+	    typedef reduction_chunks<Monad> chunks_t;
+	    if( version && version != orig
+		&& version->get_payload()->template holds<chunks_t>() )
+		return reinterpret_cast<chunks_t *>( version->get_ptr() );
+	    return 0;
+	}
 	
 	obj_version<MetaData> *
 	need_reduction( obj_version<MetaData> * orig, expensive_reduction_tag ){
@@ -747,11 +945,17 @@ public:
     int build_reduction_array( obj_version<MetaData> * orig,
 			       obj_version<MetaData> * touched[] );
 
+    template<typename Monad>
+    void reduce_chunks( obj_version<MetaData> * tgt_pl, size_t from,
+			size_t to );
+
 private:
     void set_callback( void (*cb)( obj_version<MetaData> * ),
 		       cheap_reduction_tag ) { finalize_fn = cb; }
     void set_callback( void (*cb)( obj_version<MetaData> * ),
 		       expensive_reduction_tag ) { expand_fn = cb; }
+    void set_callback( void (*cb)( obj_version<MetaData> * ),
+		       chunked_reduction_tag ) { expand_fn = cb; }
 
     template<typename Monad>
     static void execute_cb( obj_version<MetaData> * orig ) {
@@ -765,6 +969,9 @@ private:
     template<typename Monad>
     void execute_impl( obj_version<MetaData> * tgt_pl,
 		       expensive_reduction_tag tag );
+    template<typename Monad>
+    void execute_impl( obj_version<MetaData> * tgt_pl,
+		       chunked_reduction_tag tag );
 };
 
 template<typename MetaData>
@@ -815,6 +1022,47 @@ execute_impl( obj_version<MetaData> * tgt_pl, expensive_reduction_tag ) {
     create_parallel_reduction_task<Monad>( AccumTy::create( tgt_pl ), this );
 }
 
+template<typename MetaData>
+template<typename Monad>
+void
+obj_reduction_md<MetaData>::
+execute_impl( obj_version<MetaData> * tgt_pl, chunked_reduction_tag ) {
+    typedef inoutdep<typename Monad::value_type> AccumTy;
+    state = s_reduced; // avoid recursion
+    create_parallel_chunked_reduction_task<Monad>( AccumTy::create( tgt_pl ),
+						   this );
+}
+
+// Combine chunks [from,to) of all private versions into the target and
+// drop them.
+template<typename MetaData>
+template<typename Monad>
+void
+obj_reduction_md<MetaData>::
+reduce_chunks( obj_version<MetaData> * tgt_pl, size_t from, size_t to ) {
+    typedef reduction_chunks<Monad> chunks_t;
+    typedef typename chunks_t::element_type E;
+    chunked_reduction_tag tag;
+
+    if( !per_thread )
+	return;
+
+    E * tgt = reinterpret_cast<E *>( tgt_pl->get_ptr() );
+    for( size_t i=0; i < ::nthreads; ++i ) {
+	chunks_t * c = per_thread[i].template need_reduction<Monad>( tgt_pl,
+								     tag );
+	if( !c )
+	    continue;
+	for( size_t k=from; k < to; ++k ) {
+	    if( E * p = c->peek( k ) ) {
+		Monad::reduce( &tgt[k*chunks_t::chunk_size], p,
+			       chunks_t::length( k ) );
+		c->release( k );
+	    }
+	}
+    }
+}
+
 template<typename MetaData>
 int
 obj_reduction_md<MetaData>::
@@ -896,6 +1144,7 @@ private:
     obj_payload * payload;        // data payload
     obj_instance<metadata_t> * obj; // pointer to the object for renaming purposes
     reduction_md<metadata_t> reduc; // hook for reduction-specific information
+    bool renamed;                 // created by rename, counts to the budget
 
     template<typename T, obj_modifiers_t OMod>
     friend class object_t; // versioned;
@@ -903,25 +1152,33 @@ private:
     template<typename T, obj_modifiers_t OMod>
     friend class unversioned;
 
+    template<typename T, obj_modifiers_t OMod>
+    friend class cow_object;
+
     template<typename MetaData_, typename T, size_t DataSize>
     friend class obj_unv_instance; // for constructor
 
+    template<typename T>
+    friend class region_object_t; // for constructor
+
     // First-create constructor
     obj_version( size_t sz, obj_instance<metadata_t> * obj_, typeinfo tinfo )
-	: refcnt( 1 ), size( sz ), obj( obj_ ) {
+	: refcnt( 1 ), size( sz ), obj( obj_ ), renamed( false ) {
 	payload = obj_payload::create( sz, tinfo );
 	// std::cerr << "Create obj_version " << this << " payload " << (void *)payload << "\n";
     }
     // First-create constructor for unversioned objects
     obj_version( size_t sz, char * payload_ptr, typeinfo tinfo )
-	: refcnt( 1 ), size( sz ), obj( (obj_instance<metadata_t> *)0 ) {
+	: refcnt( 1 ), size( sz ),
+	  obj( (obj_instance<metadata_t> *)0 ), renamed( false ) {
 	payload = obj_payload::create( payload_ptr, tinfo );
 	// std::cerr << "Create obj_version " << this << " payload " << (void *)payload << "\n";
     }
     // Constructor for nesting
     obj_version( size_t sz, obj_instance<metadata_t> * obj_,
 		 obj_payload * payload_ )
-	: refcnt( 1 ), size( sz ), payload( payload_ ), obj( obj_ ) {
+	: refcnt( 1 ), size( sz ), payload( payload_ ),
+	  obj( obj_ ), renamed( false ) {
 	payload->add_ref();
 	// std::cerr << "Nest obj_version " << this << " payload " << (void *)payload << "\n";
     }
@@ -1042,10 +1299,39 @@ public:
 	// will not drop to zero here: we are holding references to both
 	// the new and old versions in the rename code.
 	del_ref();                // The renamed instance no longer points here
-	return create<T>( osize, obj );   // Create a clone of ourselves
+	obj_version<metadata_t> * v
+	    = create<T>( osize, obj );   // Create a clone of ourselves
+#if OBJECT_THROTTLE
+	if( throttle.counts_renames() ) {
+	    v->renamed = true;
+	    throttle.add_renamed( osize );
+	}
+#endif
+	return v;
+    }
+
+    // Check the rename budget. Counts a denied rename.
+    bool may_rename() const {
+#if OBJECT_THROTTLE
+	if( !throttle.may_rename( size ) ) {
+	    throttle.rename_denied();
+	    return false;
+	}
+#endif
+	return true;
     }
     // bool is_renamed() const { return obj && obj->get_version() != this; }
 
+private:
+    // Reinitialize the dependency tracking of a version that is no longer
+    // referenced by any task, for reuse by cow_object.
+    void recycle() {
+	assert( refcnt == 1 && "recycle of an obj_version in use" );
+	meta.~metadata_t();
+	new (&meta) metadata_t();
+    }
+public:
+
     bool is_versionable() const { return obj != 0; }
 
     // For inout renaming
@@ -1058,8 +1344,8 @@ public:
     template<typename Monad, typename Frame>
     void register_callback( Frame * odt ) {
 	if( reduc.template initialize<Monad>( size, this ) ) {
-	    bool do_expand = std::is_same<typename Monad::reduction_tag,
-		expensive_reduction_tag>::value;
+	    bool do_expand = !std::is_same<typename Monad::reduction_tag,
+		cheap_reduction_tag>::value;
 	    odt->add_finalize_version( this, do_expand );
 	}
     }
@@ -1095,6 +1381,10 @@ public:
 
 template<typename MetaData>
 void obj_version<MetaData>::del_ref_delete() {
+#if OBJECT_THROTTLE
+    if( renamed )
+	throttle.del_renamed( size );
+#endif
     delete this;
 }
 
@@ -1266,45 +1556,123 @@ inline std::ostream & operator << ( std::ostream & os, const obj_instance<MetaDa
 // ------------------------------------------------------------------------
 // Renaming
 // ------------------------------------------------------------------------
+// The argument is_ready is true when the task will execute immediately.
+// The rename budget is ignored in that case as arg_ini_ready() has decided
+// on renaming already.
 template<typename MetaData, typename T,
 	 template<typename U> class DepTy>
 static inline void rename( DepTy<T> & obj_ext, DepTy<T> & obj_int,
-			   typename DepTy<T>::dep_tags & ) {
+			   typename DepTy<T>::dep_tags &, bool is_ready ) {
     // No renaming in default case
 }
 
+// @Note
+//   When the rename budget is exhausted, the output dependency waits on
+//   the current version instead. This requires that the taskgraph tracks
+//   outdep like inoutdep when no renaming takes place, which is currently
+//   only the case for the tickets taskgraph (OBJECT_TASKGRAPH == 1).
 template<typename MetaData, typename T>
 static inline void rename( outdep<T> & obj_ext, outdep<T> & obj_int,
-			   typename outdep<T>::dep_tags & ) {
+			   typename outdep<T>::dep_tags &, bool is_ready ) {
     obj_version<MetaData> * v = obj_ext.get_version();
     assert( v->is_versionable() ); // Guaranteed by applicators
-    if( v->get_metadata()->rename_is_active() )
+    if( v->get_metadata()->rename_is_active() ) {
+#if OBJECT_THROTTLE && OBJECT_TASKGRAPH == 1
+	if( !is_ready && !v->may_rename() )
+	    return;
+#endif
 	v = obj_ext.rename<T>( &obj_int );
+    }
 }
 
 // @Note
-//   Renaming for inout dependencies will work as intended only
-//   for the tickets taskgraph (OBJECT_TASKGRAPH == 1) because the
-//   rename_has_readers() and rename_has_writers() require the semantics
-//   that any (prior) reader and writer, respectively, exists. The other
-//   taskgraphs can efficiently check the current generation/group only.
+//   Renaming for inout dependencies requires that rename_has_readers()
+//   reports whether any reader of the current version is outstanding, and
+//   that rename_has_writers() does not miss an outstanding writer. It may
+//   report writers conservatively, which results in a copy task. The
+//   tickets (1), ctaskgraph (5, 9) and ecgtaskgraph (6, 7, 10, 11)
+//   taskgraphs satisfy this. The other taskgraphs can efficiently check
+//   the current generation/group only.
 //   Requiring such a check would demand a reverse chain of pointers through
 //   the generations and/or a generation tail pointer, which would inadvertently
 //   introduce additional synchronization complexity.
 // @Note
-//   Inout renaming has not been proven yet on real codes and it is turned
-//   off by default.
+//   Renaming removes the write-after-read hazard: the task need not wait
+//   for the outstanding readers of the current version. The new version is
+//   initialized with a copy of the current one, either immediately (small
+//   objects without outstanding writers) or by a copy task that waits for
+//   the outstanding writers. The renamed task waits for the copy task.
+#if OBJECT_INOUT_RENAME > 0
+#if OBJECT_TASKGRAPH == 1 || OBJECT_TASKGRAPH == 5 || OBJECT_TASKGRAPH == 9 \
+    || OBJECT_TASKGRAPH == 6 || OBJECT_TASKGRAPH == 7 \
+    || OBJECT_TASKGRAPH == 10 || OBJECT_TASKGRAPH == 11
+#define OBJECT_INOUT_RENAME_SUPPORTED 1
+#else
+#define OBJECT_INOUT_RENAME_SUPPORTED 0
+#endif
+#endif
+
+// Cost model (see swan_config.h): rename when the copy takes less time
+// than waiting for the outstanding readers.
+static inline size_t inout_rename_copy_ns( size_t size ) {
+    return size / OBJECT_INOUT_RENAME_COPY_BW;
+}
+
+static inline bool inout_rename_pays_off( size_t size, size_t readers ) {
+    if( OBJECT_INOUT_RENAME_MAX != 0
+	&& size > size_t( OBJECT_INOUT_RENAME_MAX ) )
+	return false;
+    size_t wait = readers * ( OBJECT_INOUT_RENAME_TASK_NS
+			      + size / OBJECT_INOUT_RENAME_READ_BW );
+    return inout_rename_copy_ns( size ) < wait;
+}
+
+// Copy on the spawning thread when that is cheaper than a copy task
+static inline bool inout_rename_copy_inline( size_t size ) {
+    return inout_rename_copy_ns( size ) < OBJECT_INOUT_RENAME_TASK_NS;
+}
+
+// The number of outstanding readers, if the metadata counts them
+template<typename MetaData>
+static inline auto rename_num_readers( MetaData * md, int )
+    -> decltype( size_t( md->rename_num_readers() ) ) {
+    return md->rename_num_readers();
+}
+
+template<typename MetaData>
+static inline size_t rename_num_readers( MetaData * md, long ) {
+    return 1;
+}
+
+// Regions (region.h) are not renamed
 template<typename MetaData, typename T>
-static inline void
+static inline
+typename std::enable_if<is_region_dep<inoutdep<T> >::value>::type
 rename( inoutdep<T> & obj_ext, inoutdep<T> & obj_int,
-	typename inoutdep<T>::dep_tags & ) {
-#if OBJECT_INOUT_RENAME > 0
+	typename inoutdep<T>::dep_tags &, bool is_ready ) {
+}
+
+template<typename MetaData, typename T>
+static inline
+typename std::enable_if<!is_region_dep<inoutdep<T> >::value>::type
+rename( inoutdep<T> & obj_ext, inoutdep<T> & obj_int,
+	typename inoutdep<T>::dep_tags &, bool is_ready ) {
+#if OBJECT_INOUT_RENAME > 0 && OBJECT_INOUT_RENAME_SUPPORTED
     obj_version<MetaData> * v = obj_ext.get_version();
-    if( likely( v->is_versionable() ) && v->rename_has_readers() ) {
+    if( is_ready || unlikely( !v->is_versionable() ) )
+	return;
+    MetaData * md = v->get_metadata();
+    if( md->rename_has_readers()
+	&& inout_rename_pays_off( v->get_size(), rename_num_readers( md, 0 ) )
+	&& v->may_rename() ) {
 	obj_version<MetaData> * v_old = v;
-	if( v_old->rename_has_writers() ) {
+	// Readers may drop the last reference to v_old once the object
+	// points to the new version. Hold on to it until it is copied.
+	v_old->add_ref();
+	if( md->rename_has_writers()
+	    || !inout_rename_copy_inline( v->get_size() ) ) {
 #if OBJECT_INOUT_RENAME > 1
-	    v = obj_ext.rename<T>( &obj_int );
+	    v = obj_ext.template rename<T>( &obj_int );
 	    // Create delayed copy task. Does a grab on the old
 	    // object as well as on the new.
 	    outdep<T> v_dep = outdep<T>::create( v );
@@ -1313,10 +1681,11 @@ rename( inoutdep<T> & obj_ext, inoutdep<T> & obj_int,
 	    OBJ_PROF(rename_inout_task);
 #endif
 	} else {
-	    v = obj_ext.rename<T>( &obj_int );
+	    v = obj_ext.template rename<T>( &obj_int );
 	    v_old->copy_to( v );
 	    OBJ_PROF(rename_inout);
 	}
+	v_old->del_ref();
     }
 #endif
 }
@@ -1416,10 +1785,22 @@ struct cleanup_tags_functor {
     // For most tags types, this will basically be a no-op
     template<typename T, template<typename U> class DepTy>
     typename std::enable_if<!is_cinoutdep<DepTy<T>>::value
-			&& !is_queue_dep<DepTy<T>>::value, bool>::type
+			&& !is_queue_dep<DepTy<T>>::value
+			&& !is_region_dep<DepTy<T>>::value, bool>::type
+    operator() ( DepTy<T> obj_ext, typename DepTy<T>::dep_tags & tags ) {
+	typedef typename DepTy<T>::dep_tags tags_t;
+	tags.~tags_t();
+	return true;
+    }
+
+    // Regions: each argument has a private version, which is dropped here,
+    // whether or not the task was issued.
+    template<typename T, template<typename U> class DepTy>
+    typename std::enable_if<is_region_dep<DepTy<T>>::value, bool>::type
     operator() ( DepTy<T> obj_ext, typename DepTy<T>::dep_tags & tags ) {
 	typedef typename DepTy<T>::dep_tags tags_t;
 	tags.~tags_t();
+	obj_ext.get_version()->del_ref();
 	return true;
     }
 
@@ -1521,7 +1902,7 @@ public:
 	DepTy<T> obj_ext = DepTy<T>::create( obj_int.get_version() );
 	// Renaming is impossible here: we have already started to work
 	// on this object, so it is too late now to rename...
-	// rename<MetaData, T>( obj_ext, obj_int, tags );
+	// rename<MetaData, T>( obj_ext, obj_int, tags, false );
 	dep_traits<MetaData, Task, DepTy>::template arg_issue( fr, obj_ext, &tags );
 	if( !std::is_void< T >::value ) // token
 	    obj_ext.get_version()->add_ref();
@@ -1691,7 +2072,7 @@ struct dgrab_functor {
 	typedef typename DepTy<T>::metadata_t MetaData;
 	// No renaming yet, unless we pass the same argument multiple times
 	// assert( obj_ext.get_version() == obj_int.get_version() );
-	rename<MetaData, T>( obj_ext, obj_int, tags );
+	rename<MetaData, T>( obj_ext, obj_int, tags, is_ready );
 	dep_traits<MetaData, Task, DepTy>::template arg_issue( fr, obj_ext, &tags );
 	if( !std::is_void< T >::value ) // token
 	    obj_ext.get_version()->add_ref();
@@ -1988,13 +2369,27 @@ static inline bool arg_dprof_ready_fn( task_data_t & td ) {
     return arg_apply_stored_fn( rfn, td );
 }
 #else
+#if OBJECT_TASKGRAPH == 1
+// Readiness checks of the tickets taskgraph, evaluated one argument at a
+// time or all arguments at once (tickets.h)
+template<bool BranchFree, typename... Tn>
+struct tkt_arg_ready;
+template<typename... Tn>
+struct tkt_branchfree_args;
+#endif
+
 // A "ini_ready function" to test readiness of objects at spawn-time.
 template<typename MetaData, typename Task, typename... Tn>
 static inline bool arg_dini_ready_fn( Tn ... an ) {
     dexpand_functor<MetaData, Task> xfn;
     arg_dapply_fn( xfn, 0, an... );
+#if OBJECT_TASKGRAPH == 1
+    return tkt_arg_ready<tkt_branchfree_args<Tn...>::value, Tn...>
+	::template ini_ready<MetaData, Task>( an... );
+#else
     dini_ready_functor<MetaData, Task> rfn;
     return arg_dapply_fn( rfn, 0, an... );
+#endif
 }
 
 // A "profiling ini_ready function".
@@ -2054,6 +2449,20 @@ struct count_object<T, Tn...> : public count_object<Tn...> {
 	( is_object<T>::value ? 1 : 0 ) + count_object<Tn...>::value;
 };
 
+template<typename... Tn>
+struct count_queue;
+
+template<>
+struct count_queue<> {
+    static const size_t value = 0;
+};
+
+template<typename T, typename... Tn>
+struct count_queue<T, Tn...> : public count_queue<Tn...> {
+    static const size_t value =
+	( is_queue_dep<T>::value ? 1 : 0 ) + count_queue<Tn...>::value;
+};
+
 template<typename Frame, typename... Tn>
 inline bool grab_now( Frame * fr ) {
     return fr->get_parent()->is_full();
@@ -2116,7 +2525,7 @@ inline void arg_issue( Frame * fr, StackFrame * parent, Tn & ... an ) {
 	    // errs() << "grab now " << fr << "\n";
 	    typename stack_frame_traits<StackFrame>::metadata_ty * opr
 		= stack_frame_traits<StackFrame>::get_metadata( parent );
-	    ofr->enable_deps( true
+	    ofr->enable_deps( true, count_queue<Tn...>::value > 0
 #if !STORED_ANNOTATIONS
 			      , (void(*)(Task *, obj_dep_traits *))0
 			      , &arg_release_fn<MetaData,Task,FullTask,Tn...>
@@ -2131,7 +2540,7 @@ inline void arg_issue( Frame * fr, StackFrame * parent, Tn & ... an ) {
 		ofr, opr, std::is_same<Frame,pending_frame>::value, an... );
 	} else {
 	    // errs() << "grab later " << fr << "\n";
-	    ofr->enable_deps( false
+	    ofr->enable_deps( false, count_queue<Tn...>::value > 0
 #if !STORED_ANNOTATIONS
 			      , &arg_issue_fn<MetaData,Task,Tn...>
 			      , &arg_release_fn<MetaData,Task,FullTask,Tn...>
@@ -2408,6 +2817,115 @@ public:
     void is_object_decl(void);
 };
 
+// cow_object: object declaration-style interface to unversioned objects
+// that are versioned copy-on-write. The payload is stored in place, as for
+// unversioned, and no memory is allocated as long as every writer finds
+// the readers of the current version completed. A writer that arrives
+// while readers are outstanding gets a new version instead of waiting for
+// them. The in-place version is reused for this purpose once the tasks
+// that accessed it have released it, otherwise a version is allocated.
+// An inoutdep is only versioned when no writer is outstanding, as the
+// copy is made immediately. This requires the same taskgraph support as
+// renaming inout dependencies (OBJECT_INOUT_RENAME_SUPPORTED).
+// All versions are unversioned in the sense of is_versionable(): the
+// renaming decision is taken here, when the dependency is created.
+// PROFILE_OBJECT counts the new versions (cow_home, cow_heap) and the
+// copies made for inoutdep (cow_copy).
+template<typename T, obj_modifiers_t OMod = obj_none>
+class cow_object
+    : public obj_access_traits<T, obj_instance<obj_metadata>,
+			       cow_object<T, OMod> > {
+protected:
+    typedef obj_access_traits<T, obj_instance<obj_metadata>,
+			      cow_object<T, OMod> > OAT;
+    typedef cow_object<T, OMod> self_ty;
+    typedef obj_unv_instance<obj_metadata, T, size_struct<T>::value> home_ty;
+
+private:
+    // The in-place version. The object holds one reference to it for its
+    // lifetime, and one reference to the current version if that is
+    // allocated.
+    home_ty home;
+
+public:
+    cow_object() { this->version = &home; }
+    ~cow_object() {
+	if( this->version != &home )
+	    this->version->del_ref();
+	home.nonfreeing_del_ref();
+    }
+
+    const self_ty & operator = ( const self_ty & o ) = delete;
+
+    const self_ty & operator = ( const T & t ) {
+	*OAT::get_ptr() = t; return *this;
+    }
+
+    operator indep<T> () const    { return create_dep_ty< indep<T> >();    }
+    operator outdep<T> () const {
+	const_cast<self_ty *>( this )->copy_on_write( false );
+	return create_dep_ty< outdep<T> >();
+    }
+    operator inoutdep<T> () const {
+	const_cast<self_ty *>( this )->copy_on_write( true );
+	return create_dep_ty< inoutdep<T> >();
+    }
+#if OBJECT_COMMUTATIVITY
+    operator cinoutdep<T> () const { return create_dep_ty< cinoutdep<T> >(); }
+#endif
+    operator truedep<T> () const { return create_dep_ty< truedep<T> >(); }
+
+private:
+    template<typename DepTy>
+    DepTy create_dep_ty() const {
+	return OAT::template create_dep_ty< DepTy >();
+    }
+
+    void copy_on_write( bool copy ) {
+#if LAZY_FULL_FRAME
+	// Stolen frames of the spawner must be counted as readers first
+	if( unlikely( wf_have_deferred() ) )
+	    wf_issue_deferred_current();
+#endif
+	obj_version<obj_metadata> * v_old = this->version;
+	obj_metadata * md = v_old->get_metadata();
+	if( likely( !md->rename_has_readers() ) )
+	    return;
+	if( copy ) {
+#if OBJECT_INOUT_RENAME > 0 && OBJECT_INOUT_RENAME_SUPPORTED
+	    if( md->rename_has_writers() )
+		return;
+#else
+	    return;
+#endif
+	}
+
+	// The reference count of home drops to 1 only after the last task
+	// that accessed it released its dependencies.
+	obj_version<obj_metadata> * v;
+	if( v_old != &home && home.refcnt == 1 ) {
+	    home.recycle();
+	    v = &home;
+	    OBJ_PROF( cow_home );
+	} else {
+	    v = obj_version<obj_metadata>::template create<T>(
+		v_old->get_size(), 0 );
+	    OBJ_PROF( cow_heap );
+	}
+	if( copy ) {
+	    v_old->copy_to( v );
+	    OBJ_PROF( cow_copy );
+	}
+	this->version = v;
+	if( v_old != &home )
+	    v_old->del_ref();
+    }
+
+public:
+    // For concepts: need not be implemented, must be non-static and public
+    void is_object_decl(void);
+};
+
 // ------------------------------------------------------------------------
 // The actions taken by the runtime system depend on these classes by their
 // static types. Three classes are defined with different implementations of
@@ -2516,6 +3034,25 @@ public:
 	
     static reduction<M> create( obj_version<obj_metadata> * v );
 
+    // Chunked reductions: chunk k of the array, and element i. Outside of
+    // a parallel reduction, these address the object itself.
+    template<typename MM = M>
+    typename reduction_chunks<MM>::element_type * chunk( size_t k ) const {
+	typedef reduction_chunks<MM> chunks_t;
+	typedef typename chunks_t::element_type E;
+	obj_version<obj_metadata> * v
+	    = const_cast<reduction<M> *>( this )->get_version();
+	if( v->get_payload()->template holds<chunks_t>() )
+	    return reinterpret_cast<chunks_t *>( v->get_ptr() )->get( k );
+	return &reinterpret_cast<E *>( v->get_ptr() )[k*chunks_t::chunk_size];
+    }
+    template<typename MM = M>
+    typename reduction_chunks<MM>::element_type &
+    operator [] ( size_t i ) const {
+	typedef reduction_chunks<MM> chunks_t;
+	return chunk<MM>( i / chunks_t::chunk_size )[i % chunks_t::chunk_size];
+    }
+
 public:
     // For concepts: need not be implemented, must be non-static and public
     void is_object_decl(void);
@@ -2727,7 +3264,8 @@ class obj_dep_traits {
     reduce_fn_t reduce_fn;
 #endif
     state_t state;
-    bool pad[7]; // this padding is here because inherited_size<> does not work
+    bool queue_deps; // has hyperqueue arguments
+    bool pad[6]; // this padding is here because inherited_size<> does not work
 
     typedef obj::obj_version<obj::obj_metadata> obj_version;
     std::vector<obj_version *> finalize[2];
@@ -2735,7 +3273,7 @@ class obj_dep_traits {
 protected:
     // Only initialize task_data_p. If task_data_p is non-zero, then other
     // fields must also be initialized.
-    obj_dep_traits() : state( s_nodep ) { }
+    obj_dep_traits() : state( s_nodep ), queue_deps( false ) { }
 
     // Initialize from pending frame
     void create_from_pending( obj_dep_traits * odt ) {
@@ -2744,7 +3282,9 @@ protected:
 	cleanup_fn = odt->cleanup_fn;
 	reduce_fn = odt->reduce_fn;
 #endif
-	state = s_issued;
+	// Tasks without object arguments are pending only in a mailbox
+	state = odt->state == s_nodep ? s_nodep : s_issued;
+	queue_deps = odt->queue_deps;
 	finalize[0].swap( odt->finalize[0] );
 	finalize[1].swap( odt->finalize[1] );
     }
@@ -2777,7 +3317,7 @@ public:
 	}
     }
 
-    void enable_deps( bool already_enabled
+    void enable_deps( bool already_enabled, bool has_queue_deps
 #if !STORED_ANNOTATIONS
 		      , issue_fn_t grfn
 		      , release_fn_t refn
@@ -2792,6 +3332,7 @@ public:
 	reduce_fn = rdfn;
 #endif
 	state = already_enabled ? s_issued : s_notissued;
+	queue_deps = has_queue_deps;
     }
 
     void convert_to_full( task_metadata * fr, obj_dep_traits * parent ) {
@@ -2807,6 +3348,7 @@ public:
     }
 
     bool enabled() const { return state == s_issued; }
+    bool has_queue_deps() const { return queue_deps; }
 
     void add_finalize_version( obj_version * v, bool tasking ) {
 	// errs() << "add_finalize " << v << "\n";
@@ -2886,6 +3428,13 @@ public:
 	obj_dep_traits::convert_to_full( fr, parent );
 	task_metadata::convert_to_full( parent_full );
     }
+    void convert_to_full_lazy( full_metadata * parent_full ) {
+	task_metadata::convert_to_full( parent_full );
+    }
+    void issue_deferred( stack_frame_base_obj * fr,
+			 stack_frame_base_obj * parent ) {
+	obj_dep_traits::convert_to_full( fr, parent );
+    }
 };
 
 // Attach state and functionality to full_frame
@@ -2926,6 +3475,9 @@ struct task_graph_traits {
 	typename stack_frame_traits<FullFrame>::metadata_ty * opf
 	    = stack_frame_traits<FullFrame>::get_metadata( fr->get_parent() );
 	// assert( !ofr->enabled() || fr->get_parent()->is_full() );
+#if OBJECT_TASKGRAPH == 1 && OBJECT_COMMUTATIVITY
+	obj::tls_tkt_cmt_batch.armed = true; // cleared by get_ready_task_after()
+#endif
 	ofr->release_deps( ofr, opf, false );
 	return (QueuedFrame *)opf->get_ready_task_after( ofr );
     }
@@ -2941,6 +3493,30 @@ struct task_graph_traits {
 	// Note: obj_dep_traits::convert_to_full( task_metadata * )
 	ofr->convert_to_full( ofr, opr, opf );
     }
+    // Convert without grabbing the arguments (LAZY_FULL_FRAME)
+    static void
+    convert_to_full_lazy( StackFrame * fr, FullFrame * ff ) {
+	typename stack_frame_traits<StackFrame>::metadata_ty * ofr
+	    = stack_frame_traits<StackFrame>::get_metadata( fr );
+	typename stack_frame_traits<FullFrame>::metadata_ty * opf
+	    = stack_frame_traits<FullFrame>::get_metadata( fr->get_parent()->get_full() );
+	ofr->convert_to_full_lazy( opf );
+    }
+    // Frames with hyperqueue arguments are not converted lazily
+    static bool
+    has_queue_deps( StackFrame * fr ) {
+	return stack_frame_traits<StackFrame>::get_metadata( fr )
+	    ->has_queue_deps();
+    }
+    // Grab the arguments deferred by convert_to_full_lazy()
+    static void
+    issue_deferred( StackFrame * fr ) {
+	typename stack_frame_traits<StackFrame>::metadata_ty * ofr
+	    = stack_frame_traits<StackFrame>::get_metadata( fr );
+	typename stack_frame_traits<StackFrame>::metadata_ty * opr
+	    = stack_frame_traits<StackFrame>::get_metadata( fr->get_parent() );
+	ofr->issue_deferred( ofr, opr );
+    }
     static void
     create_from_pending( StackFrame * fr, PendingFrame * pnd ) {
 	typename stack_frame_traits<StackFrame>::metadata_ty * ofr
@@ -2968,6 +3544,12 @@ struct task_graph_traits {
 	    = stack_frame_traits<QueuedFrame>::get_metadata( qf );
 	ofr->push_pending( oqf );
     }
+    static void
+    set_priority( QueuedFrame * qf, unsigned prio ) {
+#if OBJECT_TASKGRAPH == 1 && TKT_PRIORITIES
+	stack_frame_traits<QueuedFrame>::get_metadata( qf )->set_priority( prio );
+#endif
+    }
     static QueuedFrame *
     get_ready_task( FullFrame * ff ) {
 	typename stack_frame_traits<FullFrame>::metadata_ty * off
@@ -3136,6 +3718,12 @@ struct task_graph_traits {
     static void
     convert_to_full( StackFrame * fr, FullFrame * ff ) { }
     static void
+    convert_to_full_lazy( StackFrame * fr, FullFrame * ff ) { }
+    static bool
+    has_queue_deps( StackFrame * fr ) { return false; }
+    static void
+    issue_deferred( StackFrame * fr ) { }
+    static void
     create_from_pending( StackFrame * fr, PendingFrame * pnd ) { }
     static void
     run_finalizers( StackFrame * fr, bool tasking ) { }
@@ -3147,6 +3735,8 @@ struct task_graph_traits {
 		 "of task graph\n" );
 	abort();
     }
+    static void
+    set_priority( QueuedFrame * qf, unsigned prio ) { }
     static QueuedFrame *
     get_ready_task( FullFrame * ff ) { return 0; }
 
@@ -120,6 +120,9 @@ intptr_t get_st1() {
 	    "ret\n\t"						\
 	    : : "r"((bp)), "r"((pr)) : ); } while( 0 )
 
+// Time stamp counter, e.g., for time-outs in the scheduler
+static inline uint64_t get_ticks() { return __builtin_ia32_rdtsc(); }
+
 // Use GCC builtins rather than inline assembly to improve portability somewhat
 inline uint32_t
 v_atomic_incr_long( volatile uint32_t * address ) {
@@ -178,6 +178,24 @@ intptr_t get_pr() {
 	    : : "r"((bp)) : ); } while( 0 )
 #endif // PIC
 
+// Time stamp counter, e.g., for time-outs in the scheduler
+static inline uint64_t get_ticks() { return __builtin_ia32_rdtsc(); }
+
+#if FAST_CONTEXT_SWITCH
+// Minimal user-level context: callee-saved registers, stack pointer and
+// resume address. swan_ctx_save() returns 0 when called and the value
+// passed to swan_ctx_restore() when resumed, like setjmp()/longjmp().
+// The signal mask and the x87/SSE control words are not saved.
+// Implemented in wf_worker.cc.
+struct ctx_buf_t {
+    intptr_t rbx, rbp, r12, r13, r14, r15, rsp, rip;
+};
+
+extern "C" int swan_ctx_save( ctx_buf_t * ctx ) __attribute__((returns_twice));
+extern "C" void swan_ctx_restore( ctx_buf_t * ctx, int retval )
+    __attribute__((noreturn));
+#endif
+
 // Use GCC builtins rather than inline assembly to improve portability somewhat
 inline uint32_t
 v_atomic_incr_long( volatile uint32_t * address ) {
@@ -162,7 +162,8 @@ class fixed_size_queue
     /*const*/ size_t dont_use_mask;
     char * const buffer;
     size_t peekoff;
-    pad_multiple<CACHE_ALIGNMENT, sizeof(typeinfo_array) + 4*sizeof(size_t) + sizeof(char *)> pad2;
+    bool mirrored;
+    pad_multiple<CACHE_ALIGNMENT, sizeof(typeinfo_array) + 4*sizeof(size_t) + sizeof(char *) + sizeof(bool)> pad2;
 	
 private:
     // Credit:
@@ -194,16 +195,38 @@ public:
 	return roundup_pow2( size );
     }
 
+    // Buffer space for a mirrored ring of at least max_size elements.
+    // The size must be a multiple of both the page size and the element
+    // size. Returns 0 if that would more than double the space.
+    template<typename T>
+    static size_t get_mirror_space( size_t max_size ) {
+	size_t elm = get_element_size<T>();
+	size_t page = alc::page_size();
+	size_t a = page, b = elm;
+	while( b != 0 ) {
+	    size_t r = a % b;
+	    a = b;
+	    b = r;
+	}
+	size_t unit = page / a * elm;
+	size_t size = (max_size+1) * elm;
+	size_t rounded = ( size + unit - 1 ) / unit * unit;
+	if( rounded > 2*size )
+	    return 0;
+	return rounded;
+    }
+
 private:
     friend class queue_segment;
 
     fixed_size_queue( typeinfo_array tinfo_, char * buffer_,
-		      size_t elm_size_, size_t max_size, size_t peekoff_ )
+		      size_t elm_size_, size_t max_size, size_t peekoff_,
+		      bool mirrored_ )
 	: head( 0 ), tail( peekoff_*elm_size_ ), tinfo( tinfo_ ),
 	  elm_size( elm_size_ ),
 	  // size( roundup_pow2( (max_size+1) * elm_size ) ), mask( size-1 ),
 	  size( (max_size+1) * elm_size ),
-	  buffer( buffer_ ), peekoff( peekoff_ ) {
+	  buffer( buffer_ ), peekoff( peekoff_ ), mirrored( mirrored_ ) {
 	static_assert( sizeof(fixed_size_queue) % CACHE_ALIGNMENT == 0,
 		       "padding failed" );
     }
@@ -212,27 +235,40 @@ public:
     ~fixed_size_queue() {
 	// Note: the destructor could be made to use sizeof(T) as elm_size
 	tinfo.destruct( buffer, &buffer[size], elm_size );
+	if( mirrored )
+	    alc::unmap_mirrored( buffer, size );
     }
 
     size_t get_peek_dist() const { return peekoff; }
+    bool is_mirrored() const { return mirrored; }
     void rewind() { tail = 0; } // very first segment has no copied-in peek area
 	
     bool empty( size_t off ) const {
 	assert( off <= peekoff );
 	if( peekoff > 0 ) {
-	    // No wrap-around in this situation
-	    assert( tail >= head );
-	    return head+off*elm_size >= tail;
+	    // No wrap-around in this situation, unless mirrored
+	    assert( mirrored || tail >= head );
+	    return get_used() <= off*elm_size;
 	} else
 	    return head == tail;
     }
     bool full() const volatile {
-	// Freeze tail at end of buffer to avoid wrap-around in case of peeking
-	size_t full_marker = peekoff > 0 ? 0 : head;
+	// Freeze tail at end of buffer to avoid wrap-around in case of peeking,
+	// unless the peek window is contiguous through the mirror
+	size_t full_marker = peekoff > 0 && !mirrored ? 0 : head;
 	return ((tail+elm_size) % size) == full_marker;
     }
 
+    // Bytes in use, including the peek window
+    size_t get_used() const {
+	size_t h = head, t = tail;
+	return h <= t ? t - h : size - h + t;
+    }
+
     bool has_space( size_t length ) const {
+	// Slices are contiguous across the end of a mirrored buffer
+	if( mirrored )
+	    return size - elm_size - get_used() >= elm_size*length;
 	if( head <= tail ) {
 	    return ( size - tail - (head == 0 ? 1 : 0) ) >= elm_size*length;
 	} else {
@@ -240,6 +276,8 @@ public:
 	}
     }
     size_t get_available() const {
+	if( mirrored )
+	    return get_used() / elm_size;
 	if( head <= tail ) {
 	    return ( tail - head ) / elm_size;
 	} else {
@@ -292,12 +330,12 @@ public:
     }
 
     void pop_bookkeeping( size_t npop ) {
-	assert( (head + elm_size * npop) <= size );
-	head = (head + elm_size * npop); // % size;
+	assert( mirrored || (head + elm_size * npop) <= size );
+	head = (head + elm_size * npop) % size;
     }
 
     void push_bookkeeping( size_t npush ) {
-	assert( (tail + elm_size * npush) <= size );
+	assert( mirrored || (tail + elm_size * npush) <= size );
 	tail = (tail + elm_size * npush) % size;
 	assert( tail != head );
     }
@@ -318,7 +356,8 @@ public:
     }
 
     const char * get_peek_suffix() const {
-	return &buffer[tail - elm_size * peekoff];
+	// Contiguous through the mirror when the window wraps around
+	return &buffer[(tail + size - elm_size * peekoff) % size];
     }
 
     friend std::ostream & operator << ( std::ostream & os, const fixed_size_queue & q );
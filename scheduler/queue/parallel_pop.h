@@ -0,0 +1,110 @@
+// -*- c++ -*-
+
+#ifndef QUEUE_PARALLEL_POP_H
+#define QUEUE_PARALLEL_POP_H
+
+#include <sched.h>
+#include <unistd.h>
+#include <map>
+
+#include "swan/lock.h"
+
+namespace obj {
+
+// parallel_pop: multi-consumer access to a hyperqueue. The task that holds
+// the popdep creates the parallel_pop and passes it to any number of child
+// tasks. The children claim elements from the queue concurrently. Each
+// element is tagged with its position in the queue such that queue order
+// may be restored with reorder. The queue must not be accessed through the
+// popdep while the parallel_pop is in use.
+template<typename T>
+class parallel_pop {
+    // Back-off of consumers waiting for the lock (usec)
+    static const unsigned max_yields = 16;
+    static const unsigned min_sleep = 1;
+    static const unsigned max_sleep = 1024;
+
+    popdep<T> queue;
+    cas_mutex mutex;
+    size_t next;
+
+public:
+    parallel_pop( popdep<T> queue_ ) : queue( queue_ ), next( 0 ) { }
+
+    // Claim the next element. Returns false when the queue is drained.
+    bool claim( T & t, size_t & idx ) {
+	return claim( &t, 1, idx ) != 0;
+    }
+
+    // Claim up to n consecutive elements, positions idx to idx+count-1.
+    // Waits for n elements unless the queue is drained first. Returns the
+    // number of elements claimed, zero when the queue is drained.
+    size_t claim( T * buf, size_t n, size_t & idx ) {
+	// The lock holder may wait until the producer catches up. Back off
+	// exponentially meanwhile, leaving the CPU to the producer.
+	unsigned tries = 0, delay = min_sleep;
+	while( !mutex.try_lock() ) {
+	    if( ++tries <= max_yields )
+		sched_yield();
+	    else {
+		usleep( delay );
+		if( delay < max_sleep )
+		    delay *= 2;
+	    }
+	}
+	size_t count = 0;
+	while( count < n && !queue.empty() )
+	    buf[count++] = queue.pop();
+	idx = next;
+	next += count;
+	mutex.unlock();
+	return count;
+    }
+};
+
+// reorder: restore queue order of the results of a parallel_pop. Results
+// are handed in with their position, in any order, and are passed to the
+// sink in order of their positions, one at a time. The sink is a functor
+// taking a U. The task that hands in the next expected result calls the
+// sink, also for the consecutive results that were held back.
+template<typename U, typename Sink>
+class reorder {
+    Sink sink;
+    cas_mutex mutex;
+    size_t next;
+    bool draining;
+    std::map<size_t, U> pending;
+
+public:
+    reorder( Sink sink_ ) : sink( sink_ ), next( 0 ), draining( false ) { }
+    ~reorder() {
+	assert( pending.empty() && "reorder: results left behind" );
+    }
+
+    void put( size_t idx, const U & u ) {
+	mutex.lock();
+	pending.insert( std::make_pair( idx, u ) );
+	if( draining ) {
+	    mutex.unlock();
+	    return;
+	}
+	// The sink is called without the lock such that other tasks can
+	// hand in results meanwhile
+	draining = true;
+	typename std::map<size_t, U>::iterator I;
+	while( ( I = pending.begin() ) != pending.end() && I->first == next ) {
+	    U v = I->second;
+	    pending.erase( I );
+	    ++next;
+	    mutex.unlock();
+	    sink( v );
+	    mutex.lock();
+	}
+	draining = false;
+	mutex.unlock();
+    }
+};
+
+} // namespace obj
+
+#endif // QUEUE_PARALLEL_POP_H
@@ -29,8 +29,8 @@ class queue_segment
 private:
     queue_segment( typeinfo_array tinfo, char * buffer,
 		   size_t elm_size, size_t max_size, size_t peekoff_,
-		   bool is_head )
-	: q( tinfo, buffer, elm_size, max_size, peekoff_ ),
+		   bool is_head, bool mirrored )
+	: q( tinfo, buffer, elm_size, max_size, peekoff_, mirrored ),
 	  next( 0 ), producing( true ), copied_peek( is_head ) {
 	static_assert( sizeof(queue_segment) % 16 == 0, "padding failed" );
 	// errs() << "queue_segment create " << *this << std::endl;
@@ -47,16 +47,33 @@ public:
     template<typename T>
     static queue_segment * create( size_t seg_size, size_t peekoff, bool is_head ) {
 	typeinfo_array tinfo = typeinfo_array::create<T>();
-	size_t buffer_size = fixed_size_queue::get_buffer_space<T>( seg_size );
-	char * memory = new char [sizeof(queue_segment) + buffer_size];
-	char * buffer = &memory[sizeof(queue_segment)];
 	size_t step = fixed_size_queue::get_element_size<T>();
-	tinfo.construct<T>( buffer, &buffer[buffer_size], step );
 #if PROFILE_QUEUE
 	get_profile_queue().num_segment_alloc++;
 #endif
+#if QUEUE_MIRROR
+	// The buffer of a peeking segment is a mirrored ring, allocated
+	// separately from the control fields. Its size is rounded up to
+	// whole pages.
+	if( peekoff > 0 ) {
+	    size_t ring_size = fixed_size_queue::get_mirror_space<T>( seg_size );
+	    char * buffer = ring_size > 0
+		? (char *)alc::map_mirrored( ring_size ) : 0;
+	    if( buffer ) {
+		tinfo.construct<T>( buffer, &buffer[ring_size], step );
+		char * memory = new char [sizeof(queue_segment)];
+		return new (memory) queue_segment( tinfo, buffer, step,
+						   ring_size/step - 1,
+						   peekoff, is_head, true );
+	    }
+	}
+#endif
+	size_t buffer_size = fixed_size_queue::get_buffer_space<T>( seg_size );
+	char * memory = new char [sizeof(queue_segment) + buffer_size];
+	char * buffer = &memory[sizeof(queue_segment)];
+	tinfo.construct<T>( buffer, &buffer[buffer_size], step );
 	return new (memory) queue_segment( tinfo, buffer, step,
-					   seg_size, peekoff, is_head );
+					   seg_size, peekoff, is_head, false );
     }
 
     void erase_all() {
@@ -79,7 +96,8 @@ public:
     queue_segment * get_next() const { return next; }
 
     void set_next( queue_segment * next_ ) {
-	// We have assured that we will not wrap-around when peekoff != 0
+	// We have assured that we will not wrap-around when peekoff != 0,
+	// or that the peek window is contiguous through the mirror
 	next_->q.copy_peeked( q.get_peek_suffix() );
 	next_->copied_peek = true;
 	// TODO: How to avoid memory de-allocation here?
@@ -158,6 +158,8 @@ class pushpopdep;
 
 } //end namespace obj
 
+#include "swan/queue/parallel_pop.h"
+
 #ifdef __x86_64__
 #include "swan/platform_x86_64.h"
 
@@ -86,8 +86,10 @@ protected:
 	// static_assert( sizeof(queue_version) % CACHE_ALIGNMENT == 0,
 		       // "padding failed" );
 
-	assert( peekoff < segment_size
-		&& "Peek should not cross segment boundaries" );
+	// A segment holds the peek window copied in from its predecessor
+	// in addition to the newly pushed elements
+	if( segment_size <= peekoff )
+	    segment_size += peekoff;
 
 	// Create an initial segment and share it between queue.head and user.tail
 	user.push_segment<T>( segment_size, peekoff, true );
@@ -0,0 +1,407 @@
+/*
+ * Copyright (C) 2011 Hans Vandierendonck (hvandierendonck@acm.org)
+ * Copyright (C) 2011 George Tzenakis (tzenakis@ics.forth.gr)
+ * Copyright (C) 2011 Dimitrios S. Nikolopoulos (dsn@ics.forth.gr)
+ *
+ * This file is part of Swan.
+ *
+ * Swan is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Swan is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Swan.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// -*- c++ -*-
+/*
+ * Region dependencies: dependencies on rectangular sub-arrays of a single
+ * contiguous 2D (or 1D) array.
+ *
+ * A region_object_t<T> holds a rows x cols array of T, stored row by row
+ * with leading dimension cols. A task argument of type indep<region<T>>
+ * or inoutdep<region<T>> is created with the in(), out() and inout()
+ * methods and covers a rectangle of the array. Two tasks are ordered when
+ * their rectangles overlap and one of them writes. Tasks on disjoint
+ * rectangles execute in parallel.
+ *
+ * Every region argument is an unversioned obj_version that shares the
+ * payload of the array. Its metadata describes the rectangle and is linked
+ * in a per-array list of outstanding accesses, in program order. A region
+ * argument is ready when no earlier access in the list overlaps and
+ * conflicts with it. This relies on the polling of pending tasks of the
+ * tickets scheme, hence region dependencies require OBJECT_TASKGRAPH == 1.
+ *
+ * Restrictions:
+ *  - out() is tracked as inout(): regions are not renamed.
+ *  - Region arguments must be created as spawn arguments only: the access
+ *    is retired when the task completes.
+ *  - Regions may not be passed on to child tasks of the task that holds
+ *    them; all accesses to the array should be spawned by one procedure.
+ */
+#ifndef REGION_H
+#define REGION_H
+
+#include "swan_config.h"
+
+#if OBJECT_TASKGRAPH != 1
+#error "Region dependencies require the tickets scheme (OBJECT_TASKGRAPH=1)"
+#endif
+
+#include <cstddef>
+#include <algorithm>
+#include <type_traits>
+
+#include "wf_interface.h"
+#include "object.h"
+#include "lock.h"
+
+namespace obj {
+
+// Element type tag for dependencies on regions of a region_object_t<T>
+template<typename T>
+struct region {
+    typedef T value_type;
+};
+
+class region_metadata;
+
+// ----------------------------------------------------------------------
+// region_tracker: the outstanding accesses to one region_object_t
+// ----------------------------------------------------------------------
+class region_tracker {
+    cas_mutex mutex;
+    region_metadata * head, * tail;
+    depth_t depth;
+
+public:
+    region_tracker() : head( 0 ), tail( 0 ), depth( 0 ) { }
+    ~region_tracker() {
+	assert( !head && "Outstanding region accesses at destruction" );
+    }
+
+    inline void issue( region_metadata * md );
+    inline void retire( region_metadata * md );
+    inline bool is_ready( const region_metadata * md );
+    inline bool is_ini_ready( const region_metadata * md );
+
+    depth_t get_depth() const { return depth; }
+    void update_depth( depth_t d ) { depth = std::max( depth, d ); }
+};
+
+// ----------------------------------------------------------------------
+// region_metadata: metadata of one access to a region
+// ----------------------------------------------------------------------
+class region_metadata {
+    region_tracker * tracker;
+    size_t r0, c0, nr, nc;       // rectangle: rows r0..r0+nr-1, columns
+    size_t ld;                   // c0..c0+nc-1, leading dimension ld
+    bool writes;
+    region_metadata * prev, * next;
+
+    friend class region_tracker;
+
+public:
+    region_metadata() : tracker( 0 ), r0( 0 ), c0( 0 ), nr( 0 ), nc( 0 ),
+			ld( 0 ), writes( false ), prev( 0 ), next( 0 ) { }
+
+    void initialize( region_tracker * tracker_, size_t r0_, size_t c0_,
+		     size_t nr_, size_t nc_, size_t ld_, bool writes_ ) {
+	tracker = tracker_;
+	r0 = r0_;
+	c0 = c0_;
+	nr = nr_;
+	nc = nc_;
+	ld = ld_;
+	writes = writes_;
+    }
+
+    region_tracker * get_tracker() const { return tracker; }
+    size_t get_offset() const { return r0 * ld + c0; }
+    size_t get_ld() const { return ld; }
+    size_t get_rows() const { return nr; }
+    size_t get_cols() const { return nc; }
+
+    bool conflicts( const region_metadata * md ) const {
+	return ( writes || md->writes )
+	    && r0 < md->r0 + md->nr && md->r0 < r0 + nr
+	    && c0 < md->c0 + md->nc && md->c0 < c0 + nc;
+    }
+
+    // Depth in the task graph is tracked per array
+    depth_t get_depth() const { return tracker->get_depth(); }
+
+    // Regions are never renamed
+    bool rename_is_active() const volatile { return false; }
+    bool rename_has_readers() const volatile { return false; }
+    bool rename_has_writers() const volatile { return false; }
+};
+
+void region_tracker::issue( region_metadata * md ) {
+    mutex.lock();
+    md->prev = tail;
+    md->next = 0;
+    if( tail )
+	tail->next = md;
+    else
+	head = md;
+    tail = md;
+    mutex.unlock();
+}
+
+void region_tracker::retire( region_metadata * md ) {
+    mutex.lock();
+    if( md->prev )
+	md->prev->next = md->next;
+    else
+	head = md->next;
+    if( md->next )
+	md->next->prev = md->prev;
+    else
+	tail = md->prev;
+    mutex.unlock();
+}
+
+// Ready if no earlier outstanding access conflicts with md.
+bool region_tracker::is_ready( const region_metadata * md ) {
+    bool r = true;
+    mutex.lock();
+    for( const region_metadata * e=head; e != md; e=e->next ) {
+	if( e->conflicts( md ) ) {
+	    r = false;
+	    break;
+	}
+    }
+    mutex.unlock();
+    return r;
+}
+
+// Ready if no outstanding access conflicts with md, which is not issued yet.
+bool region_tracker::is_ini_ready( const region_metadata * md ) {
+    if( !head )
+	return true;
+    bool r = true;
+    mutex.lock();
+    for( const region_metadata * e=head; e; e=e->next ) {
+	if( e->conflicts( md ) ) {
+	    r = false;
+	    break;
+	}
+    }
+    mutex.unlock();
+    return r;
+}
+
+// ----------------------------------------------------------------------
+// Dependency types on regions. The element accessors take the offset of
+// the region into account. The leading dimension is that of the array.
+// ----------------------------------------------------------------------
+template<typename T>
+class region_access_traits : public obj_instance<region_metadata> {
+public:
+    T * get_ptr() const {
+	obj_version<region_metadata> * v
+	    = const_cast<obj_version<region_metadata> *>( get_version() );
+	return reinterpret_cast<T *>( v->get_ptr() )
+	    + v->get_metadata()->get_offset();
+    }
+    operator T * () const { return get_ptr(); }
+    size_t get_ld() const { return get_version()->get_metadata()->get_ld(); }
+    size_t get_rows() const {
+	return get_version()->get_metadata()->get_rows();
+    }
+    size_t get_cols() const {
+	return get_version()->get_metadata()->get_cols();
+    }
+};
+
+template<typename T>
+class indep<region<T> > : public region_access_traits<T> {
+public:
+    typedef region_metadata metadata_t;
+    typedef indep_tags dep_tags;
+    typedef indep_type_tag _object_tag;
+    typedef region<T> elem_type;
+
+    static indep<region<T> > create( obj_version<region_metadata> * v ) {
+	indep<region<T> > od;
+	od.version = v;
+	return od;
+    }
+
+public:
+    // For concepts: need not be implemented, must be non-static and public
+    void is_object_decl(void);
+};
+
+template<typename T>
+class inoutdep<region<T> > : public region_access_traits<T> {
+public:
+    typedef region_metadata metadata_t;
+    typedef inoutdep_tags dep_tags;
+    typedef inoutdep_type_tag _object_tag;
+    typedef region<T> elem_type;
+
+    static inoutdep<region<T> > create( obj_version<region_metadata> * v ) {
+	inoutdep<region<T> > od;
+	od.version = v;
+	return od;
+    }
+
+public:
+    // For concepts: need not be implemented, must be non-static and public
+    void is_object_decl(void);
+};
+
+template<typename T>
+struct is_region_dep<indep<region<T> > > : std::true_type { };
+template<typename T>
+struct is_region_dep<inoutdep<region<T> > > : std::true_type { };
+
+// ----------------------------------------------------------------------
+// Dependency handling traits for regions
+// ----------------------------------------------------------------------
+// The private version of a region argument is created with one reference,
+// which is dropped when the tags are cleaned up (cleanup_tags_functor).
+// This also covers tasks that were never issued.
+template<>
+struct dep_traits<region_metadata, task_metadata, indep> {
+    template<typename T>
+    static void arg_issue( task_metadata * fr, indep<T> & obj_ext,
+			   typename indep<T>::dep_tags * tags ) {
+	region_metadata * md = obj_ext.get_version()->get_metadata();
+	md->get_tracker()->issue( md );
+    }
+    template<typename T>
+    static
+    bool arg_ready( indep<T> & obj_int, typename indep<T>::dep_tags & tags ) {
+	region_metadata * md = obj_int.get_version()->get_metadata();
+	return md->get_tracker()->is_ready( md );
+    }
+    template<typename T>
+    static
+    bool arg_ini_ready( const indep<T> & obj_ext ) {
+	const region_metadata * md = obj_ext.get_version()->get_metadata();
+	return md->get_tracker()->is_ini_ready( md );
+    }
+    template<typename T>
+    static
+    void arg_release( task_metadata * fr, indep<T> & obj,
+		      typename indep<T>::dep_tags & tags ) {
+	region_metadata * md = obj.get_version()->get_metadata();
+	md->get_tracker()->retire( md );
+    }
+};
+
+template<>
+struct dep_traits<region_metadata, task_metadata, inoutdep> {
+    template<typename T>
+    static void arg_issue( task_metadata * fr, inoutdep<T> & obj_ext,
+			   typename inoutdep<T>::dep_tags * tags ) {
+	region_metadata * md = obj_ext.get_version()->get_metadata();
+	md->get_tracker()->issue( md );
+	md->get_tracker()->update_depth( fr->get_depth() );
+    }
+    template<typename T>
+    static
+    bool arg_ready( inoutdep<T> & obj_int,
+		    typename inoutdep<T>::dep_tags & tags ) {
+	region_metadata * md = obj_int.get_version()->get_metadata();
+	return md->get_tracker()->is_ready( md );
+    }
+    template<typename T>
+    static
+    bool arg_ini_ready( const inoutdep<T> & obj_ext ) {
+	const region_metadata * md = obj_ext.get_version()->get_metadata();
+	return md->get_tracker()->is_ini_ready( md );
+    }
+    template<typename T>
+    static
+    void arg_release( task_metadata * fr, inoutdep<T> & obj,
+		      typename inoutdep<T>::dep_tags & tags ) {
+	region_metadata * md = obj.get_version()->get_metadata();
+	md->get_tracker()->retire( md );
+    }
+};
+
+// ----------------------------------------------------------------------
+// region_object_t: a contiguous array with region dependencies
+// ----------------------------------------------------------------------
+template<typename T>
+class region_object_t {
+    static_assert( std::is_pod<T>::value,
+		   "region_object_t supports only plain data types" );
+
+    obj_payload * payload;
+    region_tracker tracker;
+    size_t nrows, ncols;
+
+public:
+    explicit region_object_t( size_t rows, size_t cols = 1 )
+	: nrows( rows ), ncols( cols ) {
+	payload = obj_payload::create( rows * cols * sizeof(T),
+				       typeinfo::create<void>() );
+    }
+    ~region_object_t() {
+	payload->del_ref();
+    }
+
+    T * get_ptr() { return reinterpret_cast<T *>( payload->get_ptr() ); }
+    const T * get_ptr() const {
+	return reinterpret_cast<const T *>( payload->get_ptr() );
+    }
+    operator T * () { return get_ptr(); }
+
+    size_t get_rows() const { return nrows; }
+    size_t get_cols() const { return ncols; }
+    size_t get_ld() const { return ncols; }
+
+    // 2D regions: rows r0..r0+nr-1 and columns c0..c0+nc-1
+    indep<region<T> > in( size_t r0, size_t c0, size_t nr, size_t nc ) {
+	return indep<region<T> >::create( create_access( r0, c0, nr, nc,
+							 false ) );
+    }
+    inoutdep<region<T> > inout( size_t r0, size_t c0, size_t nr, size_t nc ) {
+	return inoutdep<region<T> >::create( create_access( r0, c0, nr, nc,
+							    true ) );
+    }
+    inoutdep<region<T> > out( size_t r0, size_t c0, size_t nr, size_t nc ) {
+	return inout( r0, c0, nr, nc );
+    }
+
+    // 1D regions: elements i..i+n-1 of a single-column array or of the
+    // first row of a single-row array
+    indep<region<T> > in( size_t i, size_t n ) {
+	return ncols == 1 ? in( i, 0, n, 1 ) : in( 0, i, 1, n );
+    }
+    inoutdep<region<T> > inout( size_t i, size_t n ) {
+	return ncols == 1 ? inout( i, 0, n, 1 ) : inout( 0, i, 1, n );
+    }
+    inoutdep<region<T> > out( size_t i, size_t n ) {
+	return inout( i, n );
+    }
+
+private:
+    obj_version<region_metadata> *
+    create_access( size_t r0, size_t c0, size_t nr, size_t nc, bool writes ) {
+	assert( r0 + nr <= nrows && c0 + nc <= ncols
+		&& "Region exceeds array bounds" );
+	obj_version<region_metadata> * v
+	    = new obj_version<region_metadata>(
+		nrows * ncols * sizeof(T), (obj_instance<region_metadata> *)0,
+		payload );
+	v->get_metadata()->initialize( &tracker, r0, c0, nr, nc, ncols,
+				       writes );
+	return v;
+    }
+};
+
+} // end of namespace obj
+
+#endif // REGION_H
@@ -47,7 +47,9 @@
 #define PROFILE_QUEUE 0
 #define PROFILE_SPAWN_DEQUE 0
 #define PROFILE_OBJECT 0
+#ifndef OBJECT_INOUT_RENAME
 #define OBJECT_INOUT_RENAME 0
+#endif
 #define TIME_STEALING 0
 #define PREFERRED_MUTEX cas_mutex
 #define FF_MCS_MUTEX 1
@@ -68,7 +70,9 @@
 #define PROFILE_QUEUE 0
 #define PROFILE_SPAWN_DEQUE 0
 #define PROFILE_OBJECT 0
+#ifndef OBJECT_INOUT_RENAME
 #define OBJECT_INOUT_RENAME 0
+#endif
 #define TIME_STEALING 0
 #define PREFERRED_MUTEX cas_mutex
 #define FF_MCS_MUTEX 1
@@ -120,11 +124,16 @@
 #define PROFILE_OBJECT 0
 
 /* OBJECT_INOUT_RENAME: enable renaming of inout dependencies (value 1),
- * potentially by scheduling an additional task (value 2).
+ * potentially by scheduling an additional task (value 2). Renaming trades
+ * memory for parallelism, so it is enabled per program, e.g. by compiling
+ * with -DOBJECT_INOUT_RENAME=2.
  */
+#ifndef OBJECT_INOUT_RENAME
 #define OBJECT_INOUT_RENAME 0
+#endif
 
-/* TIME_STEALING: measure how much time is spent in stealing.
+/* TIME_STEALING: measure how much time is spent in stealing, including a
+ * histogram of the time thieves hold the victim's deque lock.
  */
 #define TIME_STEALING 0
 
@@ -215,6 +224,188 @@
 #define OBJECT_REDUCTION 1
 #endif
 
+/* LAZY_WORKER_START: load the topology, place and create worker threads on
+ * the first call to run() rather than before main(). Programs that never go
+ * parallel start faster. The worker states are initialized before main()
+ * either way; until run(), all of them report node 0.
+ */
+#ifndef LAZY_WORKER_START
+#define LAZY_WORKER_START 1
+#endif
+
+/* FAST_CONTEXT_SWITCH: return to the scheduler loop in worker_fn() with a
+ * minimal save/restore of the callee-saved registers, stack pointer and
+ * resume address (platform_x86_64.h) instead of setjmp/longjmp, which
+ * also mangle pointers and check the signal mask and shadow stack.
+ * x86_64 only. The resume address is not an endbr64 landing pad and the
+ * jump bypasses the shadow stack, hence it is off when building with CET
+ * (-fcf-protection).
+ */
+#ifndef FAST_CONTEXT_SWITCH
+#if defined( __x86_64__ ) && !defined( __CET__ )
+#define FAST_CONTEXT_SWITCH 1
+#else
+#define FAST_CONTEXT_SWITCH 0
+#endif
+#endif
+
+#if FAST_CONTEXT_SWITCH && defined( __CET__ )
+#error FAST_CONTEXT_SWITCH is incompatible with CET (-fcf-protection)
+#endif
+
+/* HUGE_PAGE_ALLOC: back stack frames and large object payloads with 2 MB
+ * huge pages (alc_mmappol.h, big_alloc.h). The HUGE_PAGES environment
+ * variable selects none, thp (transparent huge pages, the default) or
+ * hugetlb (reserved huge pages, with a fall-back to thp).
+ */
+#ifndef HUGE_PAGE_ALLOC
+#define HUGE_PAGE_ALLOC 1
+#endif
+
+/* PAYLOAD_ARENA_RETAIN: bytes of freed object payloads per size class that
+ * the huge-page payload arena (big_alloc.h) keeps resident for reuse. The
+ * pages of blocks freed beyond this are returned to the OS.
+ */
+#ifndef PAYLOAD_ARENA_RETAIN
+#define PAYLOAD_ARENA_RETAIN (size_t(4) << 20)
+#endif
+
+/* LAZY_FULL_FRAME: when a steal promotes frames to full frames, postpone
+ * issuing their arguments in the parent's task graph until the parent or
+ * the frame itself spawns a child with dependences or syncs, to shorten the
+ * time the victim's deque is locked. Frames with hyperqueue arguments are
+ * issued on the steal, as the queue operations of the frame and its parent
+ * depend on it.
+ */
+#ifndef LAZY_FULL_FRAME
+#define LAZY_FULL_FRAME 1
+#endif
+
+/* SPAWN_CUTOFF: execute spawns of tasks without dependences as plain calls
+ * while the spawn deque holds enough stealable work, and go back to real
+ * spawns when thieves fail to find work (slack_creator in wf_stack_frame.h).
+ * An inlined task shares the frame of its parent. It is only inlined when
+ * the parent has no outstanding children, and its children are synced when
+ * it returns, as for a spawned task.
+ * SPAWN_CUTOFF_STACK: the stack a task may use when it is executed as a
+ * call, including the tasks that it executes as calls in turn. A spawn is
+ * executed as a call only when this much room is left in the frame.
+ */
+#ifndef SPAWN_CUTOFF
+#define SPAWN_CUTOFF 1
+#endif
+
+#ifndef SPAWN_CUTOFF_STACK
+#define SPAWN_CUTOFF_STACK (STACK_FRAME_SIZE/2)
+#endif
+
+/* SPAWN_AFFINITY: support affinity hints with spawn_on(). A task that is
+ * ready at spawn time is placed in the mailbox of the target worker or NUMA
+ * node, which is drained before random stealing (wf_mailbox.h). Other
+ * workers may take the task after SPAWN_AFFINITY_TIMEOUT cycles. The hint
+ * is ignored for tasks that are not ready at spawn time, for spawns from
+ * frames that are not full frames (the function called by run() is), and
+ * with task graphs other than tickets (OBJECT_TASKGRAPH 1).
+ */
+#ifndef SPAWN_AFFINITY
+#define SPAWN_AFFINITY 1
+#endif
+#ifndef SPAWN_AFFINITY_TIMEOUT
+#define SPAWN_AFFINITY_TIMEOUT 1000000
+#endif
+
+/* TG_READY_LIST_SHARDS: maximum number of independently locked shards in
+ * the per-frame ready list of the taskgraph schemes
+ * (taskgraph/ready_list_tg.h). A frame uses at most one shard per thread.
+ */
+#ifndef TG_READY_LIST_SHARDS
+#define TG_READY_LIST_SHARDS 8
+#endif
+
+/* Cost model for renaming inout dependencies (OBJECT_INOUT_RENAME).
+ * An inout argument is renamed when the current version has outstanding
+ * readers and copying the object is expected to take less time than
+ * waiting for them. Each reader is assumed to read all of the object:
+ *     wait = readers * (TASK_NS + size / READ_BW)
+ *     copy = size / COPY_BW
+ * Backends that do not count their readers report one. The copy is made
+ * by a copy task, off the spawning path, unless the object has no
+ * outstanding writers and the copy takes less time than a task.
+ * OBJECT_INOUT_RENAME_TASK_NS: cost of creating and running a task (ns)
+ * OBJECT_INOUT_RENAME_READ_BW: bytes read per ns by a reader
+ * OBJECT_INOUT_RENAME_COPY_BW: bytes copied per ns
+ * OBJECT_INOUT_RENAME_MAX: objects larger than this (bytes) are not
+ *     renamed, whatever the model says. 0 means no limit.
+ */
+#ifndef OBJECT_INOUT_RENAME_TASK_NS
+#define OBJECT_INOUT_RENAME_TASK_NS 1000
+#endif
+#ifndef OBJECT_INOUT_RENAME_READ_BW
+#define OBJECT_INOUT_RENAME_READ_BW 8
+#endif
+#ifndef OBJECT_INOUT_RENAME_COPY_BW
+#define OBJECT_INOUT_RENAME_COPY_BW 4
+#endif
+#ifndef OBJECT_INOUT_RENAME_MAX
+#define OBJECT_INOUT_RENAME_MAX (64<<20)
+#endif
+
+/* OBJECT_THROTTLE: support budgets on the memory held by renamed versions
+ * and on the number of pending frames. The budgets are set at start-up by
+ * the environment variables RENAME_BUDGET (bytes) and PENDING_BUDGET
+ * (frames). Unset or 0 means unlimited, and nothing is tracked. When the
+ * rename budget is exceeded, output dependencies wait on the current
+ * version instead of renaming it (tickets only). When the pending budget is
+ * exceeded, the spawning worker backs off while other workers execute
+ * pending frames before it creates another one.
+ */
+#ifndef OBJECT_THROTTLE
+#define OBJECT_THROTTLE 1
+#endif
+
+/* TKT_BRANCHFREE_READY: the tickets taskgraph checks the readiness of all
+ * arguments of a task at once, without branches, when the task has at
+ * least this many object arguments. 0 selects short-circuit evaluation
+ * for all tasks. benchmarks/ubench/src_wf/break_even.sh measures the
+ * break-even number of arguments. The check uses SSE2 or SSE4.1 when
+ * available and scalar code otherwise.
+ */
+#ifndef TKT_BRANCHFREE_READY
+#define TKT_BRANCHFREE_READY 5
+#endif
+
+/* TKT_COMMUTATIVE_BATCH: with the tickets taskgraph, a worker that
+ * finishes a commutative task (cinoutdep) while more are queued on the same
+ * object keeps the object and runs the next one, up to this many tasks in a
+ * row. 0 releases the object after every commutative task.
+ */
+#ifndef TKT_COMMUTATIVE_BATCH
+#define TKT_COMMUTATIVE_BATCH 16
+#endif
+
+/* TKT_PRIORITIES: scheduling of pending tasks in the tickets taskgraph.
+ * 0: ready tasks are found in list order, following the depth of the
+ *    previous task.
+ * 1: as 0, but tasks spawned with a priority (spawn_prio()) are selected
+ *    first, highest priority first, both by the owner and by thieves.
+ * 2: as 1, and other tasks are selected critical-path first, i.e., the
+ *    ready task with the least depth in the task graph.
+ */
+#ifndef TKT_PRIORITIES
+#define TKT_PRIORITIES 1
+#endif
+
+/* QUEUE_MIRROR: hyperqueue segments with a peek window are ring buffers
+ * that are mapped twice in consecutive virtual memory (alc_mmappol.h), such
+ * that the window is contiguous when it wraps around the end of the buffer.
+ * Such segments are reused like those without peeking. Otherwise, a peeking
+ * segment is filled once and the window is copied into the next segment.
+ * The latter is the fall-back when the mapping fails.
+ */
+#ifndef QUEUE_MIRROR
+#define QUEUE_MIRROR 1
+#endif
+
 /* Aligning to cache block size (log2)
  */
 #define CACHE_ALIGNMENT 64
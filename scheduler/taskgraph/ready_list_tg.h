@@ -29,8 +29,10 @@
 
 #include <cstdint>
 #include <iostream>
+#include <algorithm>
 
 #include "swan/lock.h"
+#include "swan/padding.h"
 
 template<typename task_type_, typename stored_task_type_,
 	 typename container_type_>
@@ -47,6 +49,16 @@ struct taskgraph_traits {
 
 // ----------------------------------------------------------------------
 // taskgraph: task graph roots in ready_list
+//
+// The ready list is split over min(nthreads, TG_READY_LIST_SHARDS)
+// shards, each with its own lock and list. The shards are allocated when
+// the first task becomes ready, so frames that never hold ready tasks
+// only pay for a pointer. A worker adds tasks to the shard selected by its
+// thread id and starts looking for tasks there too. Thieves first try
+// the shards without blocking and skip empty or contended shards, so that
+// a wide fan-out under one parent does not serialize on a single lock.
+// Taking the head of a shard is O(1); only tasks that fail to acquire
+// (e.g. commutative conflicts) are walked over.
 // ----------------------------------------------------------------------
 template<typename task_type_, typename stored_task_type_,
 	 typename container_type_>
@@ -54,49 +66,123 @@ class taskgraph {
     typedef task_type_ task_type;
     typedef stored_task_type_ stored_task_type;
     typedef container_type_ ready_list_type;
-    typedef mcs_mutex mutex_t;
+    typedef cas_mutex mutex_t;
 
     typedef taskgraph_traits<task_type, stored_task_type,
 			     container_type_> traits;
 
+    struct shard_data {
+	ready_list_type ready_list;
+	mutex_t mutex;
+	volatile size_t size;
+
+	shard_data() : size( 0 ) { }
+    };
+    // Pad shards to a cache block to avoid false sharing. We don't align
+    // them as the full_frame that holds the taskgraph need not be aligned.
+    typedef aligned_class<shard_data, CACHE_ALIGNMENT> shard;
+
 private:
-    ready_list_type ready_list;
-    mutable mutex_t mutex;
+    shard * volatile shards;
+    volatile size_t num_ready;
 
 public:
+    taskgraph() : shards( 0 ), num_ready( 0 ) { }
     ~taskgraph() {
-	assert( ready_list.empty() && "Pending tasks at destruction time" );
+	assert( empty() && "Pending tasks at destruction time" );
+	delete[] shards;
     }
 
     task_type * get_ready_task() {
-	mcs_mutex::node node;
-	mutex.lock( &node );
-	task_type * task = 0;
-	if( !ready_list.empty() ) {
-	    for( auto I=ready_list.begin(), E=ready_list.end();
-		 I != E; ++I ) {
-		task_type * t = traits::get_task( *I );
-		if( traits::acquire( t ) ) {
-		    ready_list.erase( I );
-		    task = t;
-		    break;
-		}
+	if( empty() )
+	    return 0;
+
+	// shards is set before num_ready is first incremented
+	shard * shards = this->shards;
+	size_t num_shards = get_num_shards();
+	size_t home = my_shard();
+	bool contended = false;
+
+	// First pass: don't wait for contended shards
+	for( size_t i=0; i < num_shards; ++i ) {
+	    shard & sh = shards[(home+i) % num_shards];
+	    if( sh.size == 0 )
+		continue;
+	    if( !sh.mutex.try_lock() ) {
+		contended = true;
+		continue;
 	    }
+	    task_type * task = take( sh );
+	    sh.mutex.unlock();
+	    if( task )
+		return task;
 	}
-	mutex.unlock( &node );
-	return task;
+
+	// Second pass: only if we skipped a shard that may hold a task
+	if( contended ) {
+	    for( size_t i=0; i < num_shards; ++i ) {
+		shard & sh = shards[(home+i) % num_shards];
+		if( sh.size == 0 )
+		    continue;
+		sh.mutex.lock();
+		task_type * task = take( sh );
+		sh.mutex.unlock();
+		if( task )
+		    return task;
+	    }
+	}
+	return 0;
     }
 
     void add_ready_task( task_type * fr ) {
-	mcs_mutex::node node;
-	mutex.lock( &node );
-	ready_list.push_back( fr );
-	mutex.unlock( &node );
+	if( unlikely( !shards ) )
+	    allocate_shards();
+	shard & sh = shards[my_shard()];
+	sh.mutex.lock();
+	sh.ready_list.push_back( fr );
+	++sh.size;
+	__sync_fetch_and_add( &num_ready, 1 );
+	sh.mutex.unlock();
     }
 
     // Don't need a lock in this check because it is based on polling a
     // single variable
-    bool empty() const { return ready_list.empty(); }
+    bool empty() const { return num_ready == 0; }
+
+private:
+    static size_t get_num_shards() {
+	extern size_t nthreads;
+	return std::min( nthreads, (size_t)TG_READY_LIST_SHARDS );
+    }
+
+    static size_t my_shard() {
+	extern __thread size_t threadid;
+	return threadid % get_num_shards();
+    }
+
+    // Several workers may release tasks into this frame at once; the
+    // first to install its shards wins.
+    void allocate_shards() {
+	shard * sh = new shard[get_num_shards()];
+	if( !__sync_bool_compare_and_swap( &shards, (shard *)0, sh ) )
+	    delete[] sh;
+    }
+
+    // Remove the first task that can be acquired. Called with the shard
+    // locked. In the common case, this is the head of the list.
+    task_type * take( shard & sh ) {
+	for( auto I=sh.ready_list.begin(), E=sh.ready_list.end();
+	     I != E; ++I ) {
+	    task_type * t = traits::get_task( *I );
+	    if( traits::acquire( t ) ) {
+		sh.ready_list.erase( I );
+		--sh.size;
+		__sync_fetch_and_add( &num_ready, -1 );
+		return t;
+	    }
+	}
+	return 0;
+    }
 };
 
 #endif // TASKGRAPH_READYLIST_TG_H
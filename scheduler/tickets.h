@@ -52,6 +52,24 @@ namespace obj {
 // of max should be used in several dependency action traits.
 typedef uint64_t depth_t;
 
+#if OBJECT_COMMUTATIVITY
+class tkt_metadata;
+
+// Per-worker state for batching commutative tasks. When a worker releases
+// a commutative task while others are queued on the same object, it keeps
+// the object's exclusion (reserved) and looks for the next one among the
+// pending tasks. armed is set only while releasing a task that is followed
+// by such a search; length counts the tasks handed off in a row.
+struct tkt_cmt_batch {
+    tkt_metadata * reserved;
+    size_t length;
+    bool armed;
+
+    intptr_t tag() const { return (intptr_t)this; }
+};
+extern __thread tkt_cmt_batch tls_tkt_cmt_batch;
+#endif
+
 // ----------------------------------------------------------------------
 // tkt_metadata: dependency-tracking metadata (not versioning)
 // ----------------------------------------------------------------------
@@ -76,6 +94,7 @@ public:
 	// ctr_t adv_tail() { return tail++; } // covered by parent lock
 	ctr_t adv_tail() { return __sync_fetch_and_add( &tail, 1 ); }
 	bool empty() const volatile { return head == tail; }
+	ctr_t size() const volatile { return tail - head; }
 	bool chk_tag( ctr_t tag ) const volatile { return head == tag; }
 	ctr_t get_tag() const { return tail; }
 
@@ -84,20 +103,35 @@ public:
     };
     typedef fifo_like::ctr_t tag_t;
 
+    // Branch-free readiness checks (tkt_ready_acc) load the fifo_like
+    // counters as vectors of {head, tail} pairs: writers and readers in
+    // the first vector, commutative and reductions (when enabled) in the
+    // second. The fields below must remain contiguous in this order.
+    typedef int32_t v4si __attribute__((vector_size(16)));
+
 private:
     fifo_like writers;            // head and tail counter for writers
     fifo_like readers;            // head and tail counter for readers
 #if OBJECT_COMMUTATIVITY
     fifo_like commutative;        // head and tail counter for commutative IO
-    cas_mutex mutex;              // ensure exclusion on commutative operations
 #endif
 #if OBJECT_REDUCTION
     fifo_like reductions;         // head and tail counter for readers
+#endif
+#if OBJECT_COMMUTATIVITY
+    volatile intptr_t c_owner;    // exclusion on commutative operations
 #endif
     depth_t depth;                // depth in task graph
 
 public:
-    tkt_metadata() : depth( 0 ) { }
+    tkt_metadata() :
+#if OBJECT_COMMUTATIVITY
+	c_owner( 0 ),
+#endif
+	depth( 0 ) {
+	assert( (char *)&readers == (char *)&writers + sizeof(fifo_like)
+		&& "readers must follow writers for vector loads" );
+    }
     ~tkt_metadata() {
 	assert( readers.empty()
 		&& "Must have zero readers when destructing obj_version" );
@@ -110,6 +144,7 @@ public:
         return rename_has_readers() || rename_has_writers();
     }
     bool rename_has_readers() const volatile { return has_readers(); }
+    size_t rename_num_readers() const volatile { return readers.size(); }
     bool rename_has_writers() const volatile {
 	return has_writers()
 #if OBJECT_COMMUTATIVITY
@@ -149,9 +184,58 @@ public:
     bool has_commutative() const volatile { return !commutative.empty(); }
     tag_t get_commutative_tag() const { return commutative.get_tag(); }
 
-    // There is no lock operation - because there is no reason to wait...
-    bool commutative_try_acquire() { return mutex.try_lock(); }
-    void commutative_release() { mutex.unlock(); }
+    // Exclusion between commutative tasks. c_owner is 0 when free, 1 when
+    // held, or the tag of the worker it is handed off to. There is no lock
+    // operation - because there is no reason to wait: a task that is not
+    // admitted remains pending and the scan moves on to another task.
+    bool commutative_try_acquire() {
+	intptr_t o = c_owner;
+	if( o == 0 )
+	    return __sync_bool_compare_and_swap( &c_owner, o, 1 );
+	tkt_cmt_batch & b = tls_tkt_cmt_batch;
+	if( o == b.tag() ) { // only we change it from our tag
+	    assert( b.reserved == this );
+	    b.reserved = 0;
+	    c_owner = 1;
+	    return true;
+	}
+	return false;
+    }
+    void commutative_release() {
+	assert( c_owner == 1 && "Commutative exclusion must be held" );
+	__sync_synchronize();
+	c_owner = 0;
+    }
+    // Release the exclusion at the end of a commutative task, or hand it
+    // off to the releasing worker when more commutative tasks are queued.
+    void commutative_release_batch() {
+	tkt_cmt_batch & b = tls_tkt_cmt_batch;
+	if( b.armed && !b.reserved && has_commutative()
+	    && b.length < TKT_COMMUTATIVE_BATCH ) {
+	    ++b.length;
+	    b.reserved = this;
+	    __sync_synchronize();
+	    c_owner = b.tag();
+	} else {
+	    if( !b.reserved )
+		b.length = 0;
+	    commutative_release();
+	}
+    }
+    // Drop a reservation that the worker did not use. Returns true if
+    // there was one, in which case other workers must rescan.
+    static bool commutative_cancel_batch() {
+	tkt_cmt_batch & b = tls_tkt_cmt_batch;
+	b.armed = false;
+	if( tkt_metadata * md = b.reserved ) {
+	    assert( md->c_owner == b.tag() );
+	    b.reserved = 0;
+	    b.length = 0;
+	    md->c_owner = 0;
+	    return true;
+	}
+	return false;
+    }
 #endif
 
 #if OBJECT_REDUCTION
@@ -180,6 +264,38 @@ public:
     void update_depth_ubench( depth_t d ) { depth = d; }
 #endif
 
+    // Load the heads and the tails of writers, readers, commutative and
+    // reductions, one counter per lane. Lanes of disabled counters hold
+    // garbage and are masked by the caller.
+    // Without SSE, the counters are loaded one by one.
+    void get_heads_tails( v4si & heads, v4si & tails ) const volatile {
+#if defined( __SSE__ )
+	typedef int32_t v4si_u
+	    __attribute__((vector_size(16), aligned(4), may_alias));
+	typedef float v4sf __attribute__((vector_size(16)));
+	const volatile v4si_u * p
+	    = reinterpret_cast<const volatile v4si_u *>( &writers );
+	v4sf v0 = (v4sf)p[0];
+#if OBJECT_COMMUTATIVITY || OBJECT_REDUCTION
+	v4sf v1 = (v4sf)p[1];
+#else
+	v4sf v1 = v0;
+#endif
+	heads = (v4si)__builtin_ia32_shufps( v0, v1, 0x88 );
+	tails = (v4si)__builtin_ia32_shufps( v0, v1, 0xdd );
+#else
+	const volatile int32_t * p
+	    = reinterpret_cast<const volatile int32_t *>( &writers );
+#if OBJECT_COMMUTATIVITY || OBJECT_REDUCTION
+	heads = (v4si){ p[0], p[2], p[4], p[6] };
+	tails = (v4si){ p[1], p[3], p[5], p[7] };
+#else
+	heads = (v4si){ p[0], p[2], p[0], p[2] };
+	tails = (v4si){ p[1], p[3], p[1], p[3] };
+#endif
+#endif
+    }
+
     friend std::ostream & operator << ( std::ostream & os, const tkt_metadata & md );
 };
 
@@ -280,6 +396,78 @@ inline std::ostream & operator << ( std::ostream & os, const tkt_metadata & md )
     return os;
 }
 
+// ----------------------------------------------------------------------
+// tkt_ready_acc: branch-free readiness of all arguments of a task
+// ----------------------------------------------------------------------
+// The arguments are not checked one by one with short-circuit evaluation.
+// Instead, every argument ORs the lanes of its counters that are not as
+// required (head != tail, or head != tag) into one vector, which is tested
+// once. Counters are compared for equality only, lane by lane, so the
+// wrap-around of a counter is harmless: no carry crosses from one counter
+// into another, as would be the case when adding packed head/tail words.
+// The lanes are: writers, readers, commutative, reductions; the latter
+// two shift down when commutativity or reductions are disabled.
+class tkt_ready_acc {
+    typedef tkt_metadata::v4si v4si;
+    typedef tkt_metadata::tag_t tag_t;
+    typedef float v4sf __attribute__((vector_size(16)));
+    typedef long long v2di __attribute__((vector_size(16)));
+
+    v4si acc;
+
+public:
+    tkt_ready_acc() : acc( (v4si){ 0, 0, 0, 0 } ) { }
+
+    // Lanes to check: readers on request, all others always
+    static v4si lanes( bool readers ) {
+	return (v4si){ ~0, readers ? ~0 : 0,
+		(OBJECT_COMMUTATIVITY || OBJECT_REDUCTION) ? ~0 : 0,
+		(OBJECT_COMMUTATIVITY && OBJECT_REDUCTION) ? ~0 : 0 };
+    }
+    // Tags in lane order
+    template<typename Tags>
+    static v4si tags( const Tags & t, tag_t rd_tag ) {
+	return (v4si){ int32_t(t.wr_tag), int32_t(rd_tag),
+#if OBJECT_COMMUTATIVITY
+		int32_t(t.c_tag),
+#endif
+#if OBJECT_REDUCTION
+		int32_t(t.r_tag),
+#endif
+	};
+    }
+
+    // Not ready unless the selected counters are empty (head == tail)
+    void add_empty( const tkt_metadata * md, bool readers ) {
+	v4si h, t;
+	md->get_heads_tails( h, t );
+	acc |= ( h ^ t ) & lanes( readers );
+    }
+    // Not ready unless the selected heads equal the tags
+    void add_tags( const tkt_metadata * md, v4si tg, bool readers ) {
+	v4si h, t;
+	md->get_heads_tails( h, t );
+	acc |= ( h ^ tg ) & lanes( readers );
+    }
+    // Arguments that are checked by other means
+    void add( bool ready ) {
+	acc |= (v4si){ !ready, 0, 0, 0 };
+    }
+
+    bool ready() const {
+#if defined( __SSE4_1__ )
+	return __builtin_ia32_ptestz128( (v2di)acc, (v2di)acc );
+#else
+#if defined( __SSE2__ )
+	v4si tmp = __builtin_ia32_pcmpeqd128( acc, (v4si){ 0, 0, 0, 0 } );
+	return __builtin_ia32_movmskps( (v4sf)tmp ) == 15;
+#else
+	return ( acc[0] | acc[1] | acc[2] | acc[3] ) == 0;
+#endif
+#endif
+    }
+};
+
 // ----------------------------------------------------------------------
 // A function to do the first scan over the arguments in the computation
 // of the depth of the newly created task and its arguments.
@@ -388,19 +576,37 @@ class pending_metadata : public task_metadata, private link_metadata {
 
     ready_fn_t ready_fn;
 #endif
+#if TKT_PRIORITIES
+    unsigned prio;
+#endif
 
 protected:
     pending_metadata()
 #if !STORED_ANNOTATIONS
 	: ready_fn( 0 )
 #endif
-	{ }
+	{
+#if TKT_PRIORITIES
+	prio = 0;
+#endif
+    }
 
 public:
+#if TKT_PRIORITIES
+    // Scheduling priority as given to spawn_prio(), 0 is the default
+    static const unsigned max_priority = 15;
+
+    void set_priority( unsigned p ) {
+	prio = p < max_priority ? p : max_priority;
+    }
+    unsigned get_priority() const { return prio; }
+#endif
+
     template<typename... Tn>
     void create( full_metadata * ff ) {
 #if !STORED_ANNOTATIONS
-	ready_fn = &arg_ready_fn<tkt_metadata, task_metadata, Tn...>;
+	ready_fn = &tkt_arg_ready<tkt_branchfree_args<Tn...>::value, Tn...>
+	    ::template ready<tkt_metadata, task_metadata>;
 #endif
 	task_metadata::create<Tn...>( ff );
     }
@@ -466,22 +672,53 @@ private:
 
 namespace obj { // reopen
 
+#if TKT_PRIORITIES
+// Hash key of prioritized pending frames: a scan of the list visits the
+// highest priority first.
+struct pending_priority_key {
+    static size_t get_depth( pending_metadata const * elm ) {
+	return pending_metadata::max_priority - elm->get_priority();
+    }
+};
+#endif
+
 // ----------------------------------------------------------------------
 // full_metadata: task graph metadata per full frame
 // ----------------------------------------------------------------------
 class full_metadata {
 protected:
     resizing_hashed_list<pending_metadata> * pending;
+#if TKT_PRIORITIES
+    // Pending frames spawned with a non-zero priority, checked first
+    resizing_hashed_list<pending_metadata, pending_priority_key> * urgent;
+#endif
     size_t maybe_ready;
 
 protected:
-    full_metadata() : pending( 0 ), maybe_ready( 0 ) { }
-    ~full_metadata() { delete pending; }
+    full_metadata() : pending( 0 ),
+#if TKT_PRIORITIES
+		      urgent( 0 ),
+#endif
+		      maybe_ready( 0 ) { }
+    ~full_metadata() {
+	delete pending;
+#if TKT_PRIORITIES
+	delete urgent;
+#endif
+    }
 
 public:
     void push_pending( pending_metadata * frame ) {
-	allocate_pending();
-	pending->prepend( frame );
+#if TKT_PRIORITIES
+	if( frame->get_priority() ) {
+	    allocate_urgent();
+	    urgent->prepend( frame );
+	} else
+#endif
+	{
+	    allocate_pending();
+	    pending->prepend( frame );
+	}
 	// TODO: It is not ideal to place the enable_scan() call here.
 	// But for some reason, a call during release gets missed and
 	// this is a very safe place to re-enable the scan.
@@ -494,8 +731,10 @@ public:
     pending_metadata *
     get_ready_task() {
 	pending_metadata * rdy = 0;
-	if( pending && gate_scan() ) { // no scan if nothing's there for sure
-	    rdy = pending->get_ready();
+	if( has_pending() && gate_scan() ) { // no scan if nothing's there for sure
+	    rdy = get_urgent_task();
+	    if( !rdy && pending )
+		rdy = pending->get_ready();
 	    if( rdy ) // maybe there's more
 		enable_scan();
 	}
@@ -505,12 +744,26 @@ public:
     pending_metadata *
     get_ready_task_after( task_metadata * prev ) {
 	pending_metadata * rdy = 0;
-	if( pending && gate_scan() ) { // no scan if nothing's there for sure
-	    depth_t prev_depth = prev->get_depth();
-	    rdy = pending->get_ready( prev_depth );
+	if( has_pending() && gate_scan() ) { // no scan if nothing's there for sure
+	    rdy = get_urgent_task();
+	    if( !rdy && pending ) {
+#if TKT_PRIORITIES > 1
+		// Critical path first: the least deep ready task
+		rdy = pending->get_ready();
+#else
+		depth_t prev_depth = prev->get_depth();
+		rdy = pending->get_ready( prev_depth );
+#endif
+	    }
 	    if( rdy ) // maybe there's more
 		enable_scan();
 	}
+#if OBJECT_COMMUTATIVITY
+	// The next commutative task on a reserved object was not found here
+	// (or the scan was gated off): let other workers admit it.
+	if( tkt_metadata::commutative_cancel_batch() )
+	    enable_scan();
+#endif
 	return rdy;
     }
 
@@ -518,6 +771,10 @@ public:
     void reset() {
 	if( pending )
 	    pending->reset();
+#if TKT_PRIORITIES
+	if( urgent )
+	    urgent->reset();
+#endif
     }
 #endif
 
@@ -528,6 +785,28 @@ private:
 	    pending = new resizing_hashed_list<pending_metadata>;
 	}
     }
+#if TKT_PRIORITIES
+    void allocate_urgent() {
+	if( !urgent )
+	    urgent = new resizing_hashed_list<pending_metadata,
+					      pending_priority_key>;
+    }
+#endif
+
+    bool has_pending() const {
+#if TKT_PRIORITIES
+	return pending || urgent;
+#else
+	return pending;
+#endif
+    }
+    pending_metadata * get_urgent_task() {
+#if TKT_PRIORITIES
+	if( urgent )
+	    return urgent->get_ready();
+#endif
+	return 0;
+    }
 
     bool gate_scan() {
 	if( !maybe_ready )
@@ -552,6 +831,7 @@ void task_metadata::stop_deregistration( full_metadata * parent ) {
 class serial_dep_tags {
 protected:
     friend class serial_dep_traits;
+    friend class tkt_ready_acc;
     tkt_metadata::tag_t rd_tag;
     tkt_metadata::tag_t wr_tag;
 #if OBJECT_COMMUTATIVITY
@@ -568,6 +848,12 @@ struct serial_dep_traits {
 		    obj_instance<tkt_metadata> & obj,
 		    serial_dep_tags * tags ) {
 	tkt_metadata * md = obj.get_version()->get_metadata();
+	arg_issue_tags( md, tags );
+	md->add_writer();
+	md->update_depth( fr->get_depth() );
+    }
+    static
+    void arg_issue_tags( tkt_metadata * md, serial_dep_tags * tags ) {
 	tags->rd_tag  = md->get_reader_tag();
 	tags->wr_tag  = md->get_writer_tag();
 #if OBJECT_COMMUTATIVITY
@@ -576,8 +862,6 @@ struct serial_dep_traits {
 #if OBJECT_REDUCTION
 	tags->r_tag  = md->get_reduction_tag();
 #endif
-	md->add_writer();
-	md->update_depth( fr->get_depth() );
     }
     static
     bool arg_ready( obj_instance<tkt_metadata> obj, serial_dep_tags & tags ) {
@@ -608,6 +892,19 @@ struct serial_dep_traits {
 	tkt_metadata * md = obj.get_version()->get_metadata();
 	md->del_writer();
     }
+
+    // Branch-free readiness checks (tkt_ready_acc)
+    static
+    void arg_ini_ready_acc( obj_instance<tkt_metadata> obj,
+			    tkt_ready_acc & acc ) {
+	acc.add_empty( obj.get_version()->get_metadata(), true );
+    }
+    static
+    void arg_ready_acc( obj_instance<tkt_metadata> obj, serial_dep_tags & tags,
+			tkt_ready_acc & acc ) {
+	acc.add_tags( obj.get_version()->get_metadata(),
+		      tkt_ready_acc::tags( tags, tags.rd_tag ), true );
+    }
 };
 
 //----------------------------------------------------------------------
@@ -620,6 +917,7 @@ class function_tags : public function_tags_base { };
 class indep_tags : public indep_tags_base {
     template<typename MetaData, typename Task, template<typename T> class DepTy>
     friend class dep_traits;
+    friend class tkt_ready_acc;
     tkt_metadata::tag_t wr_tag;
 #if OBJECT_COMMUTATIVITY
     tkt_metadata::tag_t c_tag;
@@ -755,6 +1053,18 @@ struct dep_traits<tkt_metadata, task_metadata, indep> {
 	obj.get_version()->get_metadata()->del_reader();
 	// errs() << "release indep\n";
     }
+    template<typename T>
+    static
+    void arg_ready_acc( indep<T> & obj_int, typename indep<T>::dep_tags & tags,
+			tkt_ready_acc & acc ) {
+	acc.add_tags( obj_int.get_version()->get_metadata(),
+		      tkt_ready_acc::tags( tags, 0 ), false );
+    }
+    template<typename T>
+    static
+    void arg_ini_ready_acc( const indep<T> & obj_ext, tkt_ready_acc & acc ) {
+	acc.add_empty( obj_ext.get_version()->get_metadata(), false );
+    }
 };
 
 // indep traits for tokens
@@ -785,10 +1095,25 @@ struct dep_traits<token_metadata, task_metadata, indep> {
 		      typename indep<T>::dep_tags & tags ) {
 	obj.get_version()->get_metadata()->del_reader();
     }
+    template<typename T>
+    static
+    void arg_ready_acc( indep<T> & obj_int, typename indep<T>::dep_tags & tags,
+			tkt_ready_acc & acc ) {
+	acc.add( arg_ready( obj_int, tags ) );
+    }
+    template<typename T>
+    static
+    void arg_ini_ready_acc( const indep<T> & obj_ext, tkt_ready_acc & acc ) {
+	acc.add( arg_ini_ready( obj_ext ) );
+    }
 };
 
 
 // output dependency traits for objects
+// With OBJECT_THROTTLE and a rename budget, the version is not renamed when
+// the budget is exhausted. The tags then serialize the task with prior
+// readers and writers. A renamed version has neither, so the tags are
+// ready. Without a rename budget, no tags are recorded.
 template<>
 struct dep_traits<tkt_metadata, task_metadata, outdep> {
     template<typename T>
@@ -796,19 +1121,35 @@ struct dep_traits<tkt_metadata, task_metadata, outdep> {
     void arg_issue( task_metadata * fr, outdep<T> & obj_ext,
 		    typename outdep<T>::dep_tags * tags ) {
 	assert( obj_ext.get_version()->is_versionable() ); // enforced by applicators
-	obj_ext.get_version()->get_metadata()->add_writer();
+	tkt_metadata * md = obj_ext.get_version()->get_metadata();
+#if OBJECT_THROTTLE
+	if( throttle.counts_renames() )
+	    serial_dep_traits::arg_issue_tags( md, tags );
+#endif
+	md->add_writer();
     }
     template<typename T>
     static
     bool arg_ready( outdep<T> & obj_ext, typename outdep<T>::dep_tags & tags ) {
 	assert( obj_ext.get_version()->is_versionable() ); // enforced by applicators
+#if OBJECT_THROTTLE
+	return !throttle.counts_renames()
+	    || serial_dep_traits::arg_ready( obj_ext, tags );
+#else
 	return true;
+#endif
     }
     template<typename T>
     static
     bool arg_ini_ready( const outdep<T> & obj ) {
 	assert( obj.get_version()->is_versionable() ); // enforced by applicators
+#if OBJECT_THROTTLE
+	// Ready if we may rename or there is nothing to wait for
+	return throttle.may_rename( obj.get_version()->get_size() )
+	    || !obj.get_version()->get_metadata()->rename_is_active();
+#else
 	return true;
+#endif
     }
     template<typename T>
     static
@@ -816,6 +1157,23 @@ struct dep_traits<tkt_metadata, task_metadata, outdep> {
 		      typename outdep<T>::dep_tags & tags ) {
 	serial_dep_traits::arg_release( obj );
     }
+    template<typename T>
+    static
+    void arg_ready_acc( outdep<T> & obj_ext,
+			typename outdep<T>::dep_tags & tags,
+			tkt_ready_acc & acc ) {
+#if OBJECT_THROTTLE
+	if( throttle.counts_renames() )
+	    serial_dep_traits::arg_ready_acc( obj_ext, tags, acc );
+#endif
+    }
+    template<typename T>
+    static
+    void arg_ini_ready_acc( const outdep<T> & obj, tkt_ready_acc & acc ) {
+#if OBJECT_THROTTLE
+	acc.add( arg_ini_ready( obj ) );
+#endif
+    }
 };
 
 // inout dependency traits for objects
@@ -844,6 +1202,18 @@ struct dep_traits<tkt_metadata, task_metadata, inoutdep> {
 		      typename inoutdep<T>::dep_tags & tags ) {
 	serial_dep_traits::arg_release( obj );
     }
+    template<typename T>
+    static
+    void arg_ready_acc( inoutdep<T> & obj_ext,
+			typename inoutdep<T>::dep_tags & tags,
+			tkt_ready_acc & acc ) {
+	serial_dep_traits::arg_ready_acc( obj_ext, tags, acc );
+    }
+    template<typename T>
+    static
+    void arg_ini_ready_acc( const inoutdep<T> & obj_ext, tkt_ready_acc & acc ) {
+	serial_dep_traits::arg_ini_ready_acc( obj_ext, acc );
+    }
 };
 
 // inout dependency traits for tokens
@@ -880,6 +1250,18 @@ struct dep_traits<token_metadata, task_metadata, inoutdep> {
 	token_metadata * md = obj.get_version()->get_metadata();
 	md->del_writer();
     }
+    template<typename T>
+    static
+    void arg_ready_acc( inoutdep<T> & obj_ext,
+			typename inoutdep<T>::dep_tags & tags,
+			tkt_ready_acc & acc ) {
+	acc.add( arg_ready( obj_ext, tags ) );
+    }
+    template<typename T>
+    static
+    void arg_ini_ready_acc( const inoutdep<T> & obj_ext, tkt_ready_acc & acc ) {
+	acc.add( arg_ini_ready( obj_ext ) );
+    }
 };
 
 // cinout dependency traits
@@ -939,7 +1321,7 @@ struct dep_traits<tkt_metadata, task_metadata, cinoutdep> {
 		      typename cinoutdep<T>::dep_tags & tags ) {
 	tkt_metadata * md = obj.get_version()->get_metadata();
 	md->del_commutative();
-	md->commutative_release();
+	md->commutative_release_batch();
     }
 };
 #endif
@@ -1053,6 +1435,170 @@ struct dep_traits<tkt_metadata, task_metadata, pushdep> {
     }
 };
 
+//----------------------------------------------------------------------
+// Readiness of all arguments of a task (TKT_BRANCHFREE_READY)
+//----------------------------------------------------------------------
+#if !STORED_ANNOTATIONS
+// Arguments whose readiness can be accumulated in a tkt_ready_acc. Checking
+// cinoutdep has side effects (locking) and reductions and queues are
+// checked by other means. Such tasks use the short-circuit evaluation.
+template<typename T>
+struct tkt_branchfree_arg {
+    static const bool value = !is_object<T>::value;
+};
+
+template<typename T>
+struct tkt_branchfree_arg<indep<T> > {
+    static const bool value
+	= std::is_same<typename indep<T>::metadata_t, tkt_metadata>::value
+	|| std::is_same<typename indep<T>::metadata_t, token_metadata>::value;
+};
+
+template<typename T>
+struct tkt_branchfree_arg<outdep<T> > {
+    static const bool value
+	= std::is_same<typename outdep<T>::metadata_t, tkt_metadata>::value;
+};
+
+template<typename T>
+struct tkt_branchfree_arg<inoutdep<T> > {
+    static const bool value
+	= std::is_same<typename inoutdep<T>::metadata_t, tkt_metadata>::value
+	|| std::is_same<typename inoutdep<T>::metadata_t, token_metadata>::value;
+};
+
+template<typename T>
+struct tkt_branchfree_arg<truedep<T> > {
+    static const bool value = true;
+};
+
+template<typename... Tn>
+struct tkt_branchfree_all;
+
+template<>
+struct tkt_branchfree_all<> {
+    static const bool value = true;
+};
+
+template<typename T, typename... Tn>
+struct tkt_branchfree_all<T, Tn...> {
+    static const bool value
+	= tkt_branchfree_arg<T>::value && tkt_branchfree_all<Tn...>::value;
+};
+
+// Use the branch-free check when all arguments support it and there are
+// sufficiently many of them (see break_even.sh in benchmarks/ubench).
+template<typename... Tn>
+struct tkt_branchfree_args {
+    static const bool value = TKT_BRANCHFREE_READY > 0
+	&& count_object<Tn...>::value >= TKT_BRANCHFREE_READY
+	&& tkt_branchfree_all<Tn...>::value;
+};
+
+// Accumulate the readiness of pending tasks
+template<typename Task>
+struct ready_acc_functor {
+    tkt_ready_acc & acc;
+    ready_acc_functor( tkt_ready_acc & acc_ ) : acc( acc_ ) { }
+
+    template<typename T, template<typename U> class DepTy>
+    bool operator () ( DepTy<T> & obj, typename DepTy<T>::dep_tags & sa ) {
+	typedef typename DepTy<T>::metadata_t MetaData;
+	dep_traits<MetaData, Task, DepTy>::arg_ready_acc( obj, sa, acc );
+	return true;
+    }
+    template<typename T>
+    bool operator () ( truedep<T> & obj, typename truedep<T>::dep_tags & sa ) {
+	return true;
+    }
+};
+
+// Accumulate the readiness at spawn time
+template<typename Task>
+struct ini_ready_acc_functor {
+    tkt_ready_acc & acc;
+    ini_ready_acc_functor( tkt_ready_acc & acc_ ) : acc( acc_ ) { }
+
+    template<typename T, template<typename U> class DepTy>
+    bool operator () ( DepTy<T> & obj_ext, typename DepTy<T>::dep_tags & sa ) {
+	typedef typename DepTy<T>::metadata_t MetaData;
+	dep_traits<MetaData, Task, DepTy>::arg_ini_ready_acc( obj_ext, acc );
+	return true;
+    }
+    template<typename T>
+    bool operator () ( truedep<T> & obj_ext,
+		       typename truedep<T>::dep_tags & sa ) {
+	return true;
+    }
+};
+
+// Finalize the arguments of a task found ready at spawn time. As in
+// dini_ready_functor, outdeps are not finalized.
+struct ini_finalize_functor {
+    template<typename T, template<typename U> class DepTy>
+    bool operator () ( DepTy<T> & obj_ext, typename DepTy<T>::dep_tags & sa ) {
+	obj_ext.get_version()->finalize();
+	return true;
+    }
+    template<typename T>
+    bool operator () ( outdep<T> & obj_ext,
+		       typename outdep<T>::dep_tags & sa ) {
+	return true;
+    }
+    template<typename T>
+    bool operator () ( truedep<T> & obj_ext,
+		       typename truedep<T>::dep_tags & sa ) {
+	return true;
+    }
+};
+
+// Short-circuit evaluation, one argument at a time
+template<typename... Tn>
+struct tkt_arg_ready<false, Tn...> {
+    template<typename MetaData, typename Task>
+    static bool ini_ready( Tn & ... an ) {
+	dini_ready_functor<MetaData, Task> rfn;
+	return arg_dapply_fn( rfn, 0, an... );
+    }
+    template<typename MetaData, typename Task>
+    static bool ready( const task_data_t & task_data ) {
+	return arg_ready_fn<MetaData, Task, Tn...>( task_data );
+    }
+};
+
+// Branch-free evaluation of all arguments
+template<typename... Tn>
+struct tkt_arg_ready<true, Tn...> {
+    template<typename MetaData, typename Task>
+    static bool ini_ready( Tn & ... an ) {
+	tkt_ready_acc acc;
+	ini_ready_acc_functor<Task> afn( acc );
+	arg_dapply_fn( afn, 0, an... );
+	if( !acc.ready() )
+	    return false;
+	ini_finalize_functor ffn;
+	arg_dapply_fn( ffn, 0, an... );
+	return true;
+    }
+    template<typename MetaData, typename Task>
+    static bool ready( const task_data_t & task_data ) {
+	char * args = task_data.get_args_ptr();
+	char * tags = task_data.get_tags_ptr();
+	tkt_ready_acc acc;
+	ready_acc_functor<Task> afn( acc );
+	arg_apply_fn<ready_acc_functor<Task>,Tn...>( afn, args, tags );
+	if( !acc.ready() )
+	    return false;
+	// As in arg_ready_fn()
+	finalize_functor<MetaData> ffn( task_data );
+	arg_apply_ufn<finalize_functor<MetaData>,Tn...>( ffn, args, tags );
+	privatize_functor<MetaData> pfn;
+	arg_apply_ufn<privatize_functor<MetaData>,Tn...>( pfn, args, tags );
+	return true;
+    }
+};
+#endif // !STORED_ANNOTATIONS
+
 typedef tkt_metadata obj_metadata;
 typedef tkt_metadata queue_metadata;
 
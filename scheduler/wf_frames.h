@@ -26,6 +26,8 @@
 #ifndef WF_FRAMES_H
 #define WF_FRAMES_H
 
+#include <cstddef>
+
 class full_frame;
 class stack_frame;
 class pending_frame;
@@ -45,5 +47,14 @@ template<typename T>
 struct pending_frame_traits {
 };
 
+// Issue arguments deferred by a steal in the executing frame, for code that
+// cannot see the frame definitions (LAZY_FULL_FRAME, wf_stack_frame.cc)
+void wf_issue_deferred_current();
+
+// Number of frames with deferred arguments, over all workers. When zero,
+// wf_issue_deferred_current() has nothing to do.
+extern volatile size_t wf_num_deferred;
+inline bool wf_have_deferred() { return wf_num_deferred != 0; }
+
 
 #endif // WF_FRAMES_H
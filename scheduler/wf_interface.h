@@ -74,6 +74,38 @@ inline typename std::enable_if<!std::is_void<TR>::value>::type
 spawn( TR (*func)( Tn... ), chandle<TR> & ch, Tn... args )
     __attribute__((always_inline, returns_twice));
 
+// Interface description:
+// spawn_prio(): spawn with a scheduling priority. If the task is not ready
+//               at spawn time, it is selected before pending tasks of lower
+//               priority once it becomes ready (see TKT_PRIORITIES).
+//               Priority 0 is the priority of spawn(). Use for tasks on
+//               the critical path, e.g., panel factorizations.
+template<typename TR, typename... Tn>
+inline typename std::enable_if<std::is_void<TR>::value>::type
+spawn_prio( unsigned prio, TR (*func)( Tn... ), Tn... args )
+    __attribute__((always_inline, returns_twice));
+
+template<typename TR, typename... Tn>
+inline typename std::enable_if<std::is_void<TR>::value>::type
+spawn_prio( unsigned prio, TR (*func)( Tn... ), chandle<TR> & ch, Tn... args )
+    __attribute__((always_inline, returns_twice));
+
+template<typename TR, typename... Tn>
+inline typename std::enable_if<!std::is_void<TR>::value>::type
+spawn_prio( unsigned prio, TR (*func)( Tn... ), chandle<TR> & ch, Tn... args )
+    __attribute__((always_inline, returns_twice));
+
+// Interface description:
+// spawn_on(): spawn with an affinity hint: execute the task on worker k
+//             (on_worker(k)) or on a worker of NUMA node n (on_node(n)).
+//             The hint is soft: the task waits in a mailbox that the target
+//             drains before stealing, and other workers take it when it
+//             waits for too long (see SPAWN_AFFINITY).
+template<typename Where, typename TR, typename... Tn>
+inline typename std::enable_if<std::is_void<TR>::value>::type
+spawn_on( Where where, TR (*func)( Tn... ), Tn... args )
+    __attribute__((always_inline, returns_twice));
+
 // Interface description:
 // call(): call function and have parent wait for the call to finish.
 template<typename TR, typename... Tn>
@@ -152,36 +184,77 @@ public:
     future & get_future() { return c; }
 };
 
+// Issue the arguments of children promoted lazily on a steal, and of the
+// frame itself, before they are needed to enforce dependences.
+inline void wf_issue_deferred(full_frame * ff) {
+#if LAZY_FULL_FRAME
+    ff->issue_deferred();
+    if( full_frame * pf = ff->get_parent() )
+	pf->issue_deferred( ff->get_frame() );
+#endif
+}
+
 // Check whether dependencies of arguments are satisfied
 #if STORED_ANNOTATIONS
 template<typename... Tn>
 inline bool wf_arg_ready(full_frame * ff, task_data_t & task_data) {
+    if( ff && the_task_graph_traits::arg_introduces_deps<Tn...>() )
+	wf_issue_deferred( ff );
     bool ready = true;
     if( !the_task_graph_traits::arg_ready( task_data ) )
 	ready = false;
-#if 0
-    assert( ff );
-    return ff->slack_invoke( ready );
-#endif
     return ready;
 }
 #else
 template<typename... Tn>
 inline bool wf_arg_ready(full_frame * ff, Tn... an) {
+    if( ff && the_task_graph_traits::arg_introduces_deps<Tn...>() )
+	wf_issue_deferred( ff );
     bool ready = true;
     if( !the_task_graph_traits::arg_ready( an... ) )
 	ready = false;
-#if 0
-    assert( ff );
-    return ff->slack_invoke( ready );
-#endif
     return ready;
 }
 #endif
 
+// Execute a spawn as a plain call (SPAWN_CUTOFF)? Only for tasks without
+// dependences, when the spawn deque has enough work for thieves. The frame
+// must have no outstanding children, such that all children left behind by
+// the call are those of the task (see wf_spawn_inline_sync()).
+template<typename... Tn>
+inline bool wf_spawn_inline(stack_frame * fr) {
+#if SPAWN_CUTOFF
+    if( the_task_graph_traits::arg_introduces_deps<Tn...>() )
+	return false;
+    full_frame * ff = fr->get_full();
+    return ( !ff || ff->all_children_done() )
+	&& fr->get_owner()->spawn_inline();
+#else
+    return false;
+#endif
+}
+
+// A task executed as a call returns after its children, as if it were
+// spawned. Its ssync() only waits for these children, as the frame had
+// none when the call started. The frame may be stolen during the call.
+#if SPAWN_CUTOFF
+inline void wf_spawn_inline_sync(stack_frame * fr)
+    __attribute__((always_inline, returns_twice));
+
+inline void wf_spawn_inline_sync(stack_frame * fr) {
+    full_frame * ff = fr->get_full();
+    if( ff && !ff->all_children_done() )
+	ssync();
+}
+#else
+inline void wf_spawn_inline_sync(stack_frame * fr) { }
+#endif
+
 // Grab argument dependencies
 template<typename Frame, typename... Tn>
 inline void wf_arg_issue(Frame * fr, stack_frame * parent, Tn & ... an) {
+    if( parent->is_full() && the_task_graph_traits::arg_introduces_deps<Tn...>() )
+	wf_issue_deferred( parent->get_full() );
     the_task_graph_traits::arg_issue( fr, parent, an... );
 }
 
@@ -365,9 +438,46 @@ stack_frame::create_pending( TR (*func)( Tn... ),
 			     task_data_t & task_data_p,
 #endif
 			     Tn... args ) {
+    return create_pending( 0u, func, cur, fut,
+#if STORED_ANNOTATIONS
+			   task_data_p,
+#endif
+			   args... );
+}
+
+template<typename TR, typename... Tn>
+pending_frame *
+stack_frame::create_pending( unsigned prio, TR (*func)( Tn... ),
+			     stack_frame * cur, future * fut,
+#if STORED_ANNOTATIONS
+			     task_data_t & task_data_p,
+#endif
+			     Tn... args ) {
+    pending_frame * pnd = make_pending( func, cur, fut,
+#if STORED_ANNOTATIONS
+					task_data_p,
+#endif
+					args... );
+    if( prio )
+	the_task_graph_traits::set_priority( pnd, prio );
+    the_task_graph_traits::push_pending( cur->get_full(), pnd );
+    return pnd;
+}
+
+template<typename TR, typename... Tn>
+pending_frame *
+stack_frame::make_pending( TR (*func)( Tn... ),
+			   stack_frame * cur, future * fut,
+#if STORED_ANNOTATIONS
+			   task_data_t & task_data_p,
+#endif
+			   Tn... args ) {
 #if PROFILE_WORKER
     worker_state::tls()->get_profile_worker().num_pending++;
 #endif
+#if OBJECT_THROTTLE
+    obj::throttle.add_pending();
+#endif
 
 #if STORED_ANNOTATIONS
     pending_frame * pnd
@@ -397,7 +507,6 @@ stack_frame::create_pending( TR (*func)( Tn... ),
     // Notify parent that there is another child
     cur->get_full()->add_child();
 
-    the_task_graph_traits::push_pending( cur->get_full(), pnd );
     return pnd;
 }
 
@@ -461,56 +570,224 @@ void create_parallel_reduction_task( AccumTy accum, ReductionTy * reduc ) {
     spawn( &parallel_reduction_task<Monad, AccumTy, ReductionTy>, accum, reduc );
 }
 
+// Chunked reductions: one task per group of chunks, a few groups per thread.
+template<typename Monad, typename AccumTy, typename ReductionTy>
+void parallel_chunked_reduction_task( AccumTy accum, ReductionTy * reduc ) {
+    typedef obj::reduction_chunks<Monad> chunks_t;
+    typedef typename ReductionTy::metadata_t MetaData;
+    typedef obj::obj_version<MetaData> VersionTy;
+
+    size_t n = chunks_t::num_chunks;
+    size_t groups = 4 * ::nthreads;
+    size_t step = ( n + groups - 1 ) / groups;
+    VersionTy * tgt = accum.get_version();
+
+    for( size_t k=0; k < n; k += step )
+	spawn( &reduce_chunks_task<Monad, ReductionTy, VersionTy>,
+	       reduc, tgt, k, std::min( k+step, n ) );
+
+    ssync();
+}
+
+template<typename Monad, typename AccumTy, typename ReductionTy>
+void create_parallel_chunked_reduction_task( AccumTy accum,
+					     ReductionTy * reduc ) {
+    spawn( &parallel_chunked_reduction_task<Monad, AccumTy, ReductionTy>,
+	   accum, reduc );
+}
+
+
+// Throttling of pending frames: when the pending budget is exceeded, the
+// spawning frame is suspended as on a sync before it creates another one.
+// Its worker executes ready children of the frame until the budget is met
+// or no child is ready, and then resumes the frame (see
+// worker_state::provably_good_steal()). The frame does not wait for all its
+// children: they may depend on work the frame has yet to do, such as pushes
+// on a queue that a pending consumer pops.
+#if OBJECT_THROTTLE
+inline void wf_throttle_pending() __attribute__((always_inline, returns_twice));
+
+inline void wf_throttle_pending() {
+    stack_frame * fr = stack_frame::my_stack_frame();
+    assert( fr->get_state() == fs_executing );
+
+    // Only a frame with children has pending frames to execute
+    full_frame * ff = fr->get_full();
+    if( !ff || ff->all_children_done() )
+	return;
+
+    obj::throttle.spawn_throttled();
+    wf_issue_deferred( ff );
+    ff->set_throttled( true );
+    fr->sync();
+    CLOBBER_CALLEE_SAVED_BUT1();
+    // all following code will be executed when resuming the frame
+    assert( fr == stack_frame::my_stack_frame()
+	    && "Sanity check on variables" );
+    assert( fr->get_state() == fs_executing );
+}
+
+#define WF_THROTTLE_PENDING()						\
+    do {								\
+	if( unlikely( obj::throttle.pending_over_budget() ) )		\
+	    wf_throttle_pending();					\
+    } while( 0 )
+#else
+#define WF_THROTTLE_PENDING() do { } while( 0 )
+#endif
+
+// The implementation of spawn() and spawn_prio(). These are not declared
+// returns_twice, such that the interface functions can be inlined.
+template<typename TR, typename... Tn>
+inline typename std::enable_if<std::is_void<TR>::value>::type
+wf_spawn( unsigned prio, TR (*func)( Tn... ), chandle<TR> & ch, Tn... args )
+    __attribute__((always_inline));
+
+template<typename TR, typename... Tn>
+inline typename std::enable_if<std::is_void<TR>::value>::type
+wf_spawn( unsigned prio, TR (*func)( Tn... ), Tn... args )
+    __attribute__((always_inline));
+
+template<typename TR, typename... Tn>
+inline typename std::enable_if<!std::is_void<TR>::value>::type
+wf_spawn( unsigned prio, TR (*func)( Tn... ), chandle<TR> & ch, Tn... args )
+    __attribute__((always_inline));
 
 #if STORED_ANNOTATIONS
 template<typename TR, typename... Tn>
 inline typename std::enable_if<std::is_void<TR>::value>::type
-spawn( TR (*func)( Tn... ), chandle<TR> & ch, Tn... args ) {
+wf_spawn( unsigned prio, TR (*func)( Tn... ), chandle<TR> & ch, Tn... args ) {
     stack_frame * fr = stack_frame::my_stack_frame();
+    if( wf_spawn_inline<Tn...>( fr ) ) {
+	(*func)( args... );
+	wf_spawn_inline_sync( fr );
+	ch.get_future().flag_result();
+	return;
+    }
     task_data_t td( arg_size( args... ),
 		    the_task_graph_traits::arg_stored_size<Tn...>(),
 		    arg_num<Tn...>(), fr );
     // Copy the arguments to our stack frame
     td.push_args( args... );
     the_task_graph_traits::arg_stored_initialize<Tn...>( td );
+    WF_THROTTLE_PENDING();
     if( /*!fr->is_full() ||*/ wf_arg_ready( fr->get_full(), td ) ) {
 	stack_frame::invoke( &ch.get_future(), td, false, func, args... );
     } else {
-	stack_frame::create_pending( func, fr, &ch.get_future(), td, args... );
+	stack_frame::create_pending( prio, func, fr, &ch.get_future(), td,
+				     args... );
     }
 }
 
 template<typename TR, typename... Tn>
 inline typename std::enable_if<std::is_void<TR>::value>::type
-spawn( TR (*func)( Tn... ), Tn... args ) {
+wf_spawn( unsigned prio, TR (*func)( Tn... ), Tn... args ) {
     stack_frame * fr = stack_frame::my_stack_frame();
+    if( wf_spawn_inline<Tn...>( fr ) ) {
+	(*func)( args... );
+	wf_spawn_inline_sync( fr );
+	return;
+    }
     task_data_t td( arg_size( args... ),
 		    the_task_graph_traits::arg_stored_size<Tn...>(),
 		    arg_num<Tn...>(), fr );
     // Copy the arguments to our stack frame
     td.push_args( args... );
     the_task_graph_traits::arg_stored_initialize<Tn...>( td );
+    WF_THROTTLE_PENDING();
     if( /*!fr->is_full() ||*/ wf_arg_ready( fr->get_full(), td ) ) {
 	stack_frame::invoke( (future*)0, td, false, func, args... );
     } else {
-	stack_frame::create_pending( func, fr, (future*)0, td, args... );
+	stack_frame::create_pending( prio, func, fr, (future*)0, td, args... );
     }
 }
 
 template<typename TR, typename... Tn>
 inline typename std::enable_if<!std::is_void<TR>::value>::type
-spawn( TR (*func)( Tn... ), chandle<TR> & ch, Tn... args ) {
+wf_spawn( unsigned prio, TR (*func)( Tn... ), chandle<TR> & ch, Tn... args ) {
     stack_frame * fr = stack_frame::my_stack_frame();
+    if( wf_spawn_inline<Tn...>( fr ) ) {
+	TR r = (*func)( args... );
+	wf_spawn_inline_sync( fr );
+	ch.get_future().set_value( r );
+	return;
+    }
     task_data_t td( arg_size( args... ),
 		    the_task_graph_traits::arg_stored_size<Tn...>(),
 		    arg_num<Tn...>(), fr );
     // Copy the arguments to our stack frame
     td.push_args( args... );
     the_task_graph_traits::arg_stored_initialize<Tn...>( td );
+    WF_THROTTLE_PENDING();
     if( /*!fr->is_full() ||*/ wf_arg_ready( fr->get_full(), td ) ) {
 	stack_frame::invoke( &ch.get_future(), td, false, func, args... );
     } else {
-	stack_frame::create_pending( func, fr, &ch.get_future(), td, args... );
+	stack_frame::create_pending( prio, func, fr, &ch.get_future(), td,
+				     args... );
+    }
+}
+
+template<typename TR, typename... Tn>
+inline typename std::enable_if<std::is_void<TR>::value>::type
+spawn( TR (*func)( Tn... ), chandle<TR> & ch, Tn... args ) {
+    wf_spawn( 0u, func, ch, args... );
+}
+
+template<typename TR, typename... Tn>
+inline typename std::enable_if<std::is_void<TR>::value>::type
+spawn( TR (*func)( Tn... ), Tn... args ) {
+    wf_spawn( 0u, func, args... );
+}
+
+template<typename TR, typename... Tn>
+inline typename std::enable_if<!std::is_void<TR>::value>::type
+spawn( TR (*func)( Tn... ), chandle<TR> & ch, Tn... args ) {
+    wf_spawn( 0u, func, ch, args... );
+}
+
+template<typename TR, typename... Tn>
+inline typename std::enable_if<std::is_void<TR>::value>::type
+spawn_prio( unsigned prio, TR (*func)( Tn... ), chandle<TR> & ch, Tn... args ) {
+    wf_spawn( prio, func, ch, args... );
+}
+
+template<typename TR, typename... Tn>
+inline typename std::enable_if<std::is_void<TR>::value>::type
+spawn_prio( unsigned prio, TR (*func)( Tn... ), Tn... args ) {
+    wf_spawn( prio, func, args... );
+}
+
+template<typename TR, typename... Tn>
+inline typename std::enable_if<!std::is_void<TR>::value>::type
+spawn_prio( unsigned prio, TR (*func)( Tn... ), chandle<TR> & ch, Tn... args ) {
+    wf_spawn( prio, func, ch, args... );
+}
+
+template<typename Where, typename TR, typename... Tn>
+inline typename std::enable_if<std::is_void<TR>::value>::type
+spawn_on( Where where, TR (*func)( Tn... ), Tn... args ) {
+    stack_frame * fr = stack_frame::my_stack_frame();
+#if SPAWN_AFFINITY && OBJECT_TASKGRAPH == 1
+    mailbox * mb = fr->is_full() ? worker_state::get_mailbox( where ) : 0;
+#else
+    mailbox * mb = 0;
+#endif
+    task_data_t td( arg_size( args... ),
+		    the_task_graph_traits::arg_stored_size<Tn...>(),
+		    arg_num<Tn...>(), fr );
+    // Copy the arguments to our stack frame
+    td.push_args( args... );
+    the_task_graph_traits::arg_stored_initialize<Tn...>( td );
+    WF_THROTTLE_PENDING();
+    if( /*!fr->is_full() ||*/ wf_arg_ready( fr->get_full(), td ) ) {
+	if( mb ) {
+	    mb->post( fr->get_full(),
+		      stack_frame::make_pending( func, fr, (future*)0, td,
+						 args... ) );
+	} else
+	    stack_frame::invoke( (future*)0, td, false, func, args... );
+    } else {
+	stack_frame::create_pending( func, fr, (future*)0, td, args... );
     }
 }
 
@@ -545,6 +822,7 @@ call( TR (*func)( Tn... ), Tn... args ) {
 template<typename TR, typename... Tn>
 inline typename std::enable_if<std::is_void<TR>::value>::type
 run( TR (*func)( Tn... ), Tn... args ) {
+    wf_ensure_workers();
     worker_state * ws = worker_state::tls();
     full_frame * cur_frame = ws->get_dummy();
     cur_frame->get_frame()->set_owner( (spawn_deque*)ws->get_deque() );
@@ -562,6 +840,7 @@ run( TR (*func)( Tn... ), Tn... args ) {
 template<typename TR, typename... Tn>
 inline typename std::enable_if<!std::is_void<TR>::value, TR>::type
 run( TR (*func)( Tn... ), Tn... args ) {
+    wf_ensure_workers();
     worker_state * ws = worker_state::tls();
     full_frame * cur_frame = ws->get_dummy();
     cur_frame->get_frame()->set_owner( (spawn_deque*)ws->get_deque() );
@@ -580,34 +859,114 @@ run( TR (*func)( Tn... ), Tn... args ) {
 #else
 template<typename TR, typename... Tn>
 inline typename std::enable_if<std::is_void<TR>::value>::type
-spawn( TR (*func)( Tn... ), chandle<TR> & ch, Tn... args ) {
+wf_spawn( unsigned prio, TR (*func)( Tn... ), chandle<TR> & ch, Tn... args ) {
     stack_frame * fr = stack_frame::my_stack_frame();
+    if( wf_spawn_inline<Tn...>( fr ) ) {
+	(*func)( args... );
+	wf_spawn_inline_sync( fr );
+	ch.get_future().flag_result();
+	return;
+    }
+    WF_THROTTLE_PENDING();
     if( /*!fr->is_full() ||*/ wf_arg_ready( fr->get_full(), args... ) ) {
 	stack_frame::invoke( &ch.get_future(), false, func, args... );
     } else {
-	stack_frame::create_pending( func, fr, &ch.get_future(), args... );
+	stack_frame::create_pending( prio, func, fr, &ch.get_future(),
+				     args... );
     }
 }
 
 template<typename TR, typename... Tn>
 inline typename std::enable_if<std::is_void<TR>::value>::type
-spawn( TR (*func)( Tn... ), Tn... args ) {
+wf_spawn( unsigned prio, TR (*func)( Tn... ), Tn... args ) {
     stack_frame * fr = stack_frame::my_stack_frame();
+    if( wf_spawn_inline<Tn...>( fr ) ) {
+	(*func)( args... );
+	wf_spawn_inline_sync( fr );
+	return;
+    }
+    WF_THROTTLE_PENDING();
     if( /*!fr->is_full() ||*/ wf_arg_ready( fr->get_full(), args... ) ) {
 	stack_frame::invoke( (future*)0, false, func, args... );
     } else {
-	stack_frame::create_pending( func, fr, (future*)0, args... );
+	stack_frame::create_pending( prio, func, fr, (future*)0, args... );
     }
 }
 
 template<typename TR, typename... Tn>
 inline typename std::enable_if<!std::is_void<TR>::value>::type
-spawn( TR (*func)( Tn... ), chandle<TR> & ch, Tn... args ) {
+wf_spawn( unsigned prio, TR (*func)( Tn... ), chandle<TR> & ch, Tn... args ) {
     stack_frame * fr = stack_frame::my_stack_frame();
+    if( wf_spawn_inline<Tn...>( fr ) ) {
+	TR r = (*func)( args... );
+	wf_spawn_inline_sync( fr );
+	ch.get_future().set_value( r );
+	return;
+    }
+    WF_THROTTLE_PENDING();
     if( /*!fr->is_full() ||*/ wf_arg_ready( fr->get_full(), args... ) ) {
 	stack_frame::invoke( &ch.get_future(), false, func, args... );
     } else {
-	stack_frame::create_pending( func, fr, &ch.get_future(), args... );
+	stack_frame::create_pending( prio, func, fr, &ch.get_future(),
+				     args... );
+    }
+}
+
+template<typename TR, typename... Tn>
+inline typename std::enable_if<std::is_void<TR>::value>::type
+spawn( TR (*func)( Tn... ), chandle<TR> & ch, Tn... args ) {
+    wf_spawn( 0u, func, ch, args... );
+}
+
+template<typename TR, typename... Tn>
+inline typename std::enable_if<std::is_void<TR>::value>::type
+spawn( TR (*func)( Tn... ), Tn... args ) {
+    wf_spawn( 0u, func, args... );
+}
+
+template<typename TR, typename... Tn>
+inline typename std::enable_if<!std::is_void<TR>::value>::type
+spawn( TR (*func)( Tn... ), chandle<TR> & ch, Tn... args ) {
+    wf_spawn( 0u, func, ch, args... );
+}
+
+template<typename TR, typename... Tn>
+inline typename std::enable_if<std::is_void<TR>::value>::type
+spawn_prio( unsigned prio, TR (*func)( Tn... ), chandle<TR> & ch, Tn... args ) {
+    wf_spawn( prio, func, ch, args... );
+}
+
+template<typename TR, typename... Tn>
+inline typename std::enable_if<std::is_void<TR>::value>::type
+spawn_prio( unsigned prio, TR (*func)( Tn... ), Tn... args ) {
+    wf_spawn( prio, func, args... );
+}
+
+template<typename TR, typename... Tn>
+inline typename std::enable_if<!std::is_void<TR>::value>::type
+spawn_prio( unsigned prio, TR (*func)( Tn... ), chandle<TR> & ch, Tn... args ) {
+    wf_spawn( prio, func, ch, args... );
+}
+
+template<typename Where, typename TR, typename... Tn>
+inline typename std::enable_if<std::is_void<TR>::value>::type
+spawn_on( Where where, TR (*func)( Tn... ), Tn... args ) {
+    stack_frame * fr = stack_frame::my_stack_frame();
+#if SPAWN_AFFINITY && OBJECT_TASKGRAPH == 1
+    mailbox * mb = fr->is_full() ? worker_state::get_mailbox( where ) : 0;
+#else
+    mailbox * mb = 0;
+#endif
+    WF_THROTTLE_PENDING();
+    if( /*!fr->is_full() ||*/ wf_arg_ready( fr->get_full(), args... ) ) {
+	if( mb ) {
+	    mb->post( fr->get_full(),
+		      stack_frame::make_pending( func, fr, (future*)0,
+						 args... ) );
+	} else
+	    stack_frame::invoke( (future*)0, false, func, args... );
+    } else {
+	stack_frame::create_pending( func, fr, (future*)0, args... );
     }
 }
 
@@ -630,6 +989,7 @@ call( TR (*func)( Tn... ), Tn... args ) {
 template<typename TR, typename... Tn>
 inline typename std::enable_if<std::is_void<TR>::value>::type
 run( TR (*func)( Tn... ), Tn... args ) {
+    wf_ensure_workers();
     worker_state * ws = worker_state::tls();
     full_frame * cur_frame = ws->get_dummy();
     cur_frame->get_frame()->set_owner( (spawn_deque*)ws->get_deque() );
@@ -641,6 +1001,7 @@ run( TR (*func)( Tn... ), Tn... args ) {
 template<typename TR, typename... Tn>
 inline typename std::enable_if<!std::is_void<TR>::value, TR>::type
 run( TR (*func)( Tn... ), Tn... args ) {
+    wf_ensure_workers();
     worker_state * ws = worker_state::tls();
     full_frame * cur_frame = ws->get_dummy();
     cur_frame->get_frame()->set_owner( (spawn_deque*)ws->get_deque() );
@@ -678,6 +1039,7 @@ void ssync() {
     // If the frame is full and has outstanding children, jump back to scheduler
     // until they have executed. Otherwise, we're done.
     if( full_frame * ff = fr->get_full() ) {
+	wf_issue_deferred( ff );
 	the_task_graph_traits::run_finalizers( fr, true ); // reductions
 	if( !ff->all_children_done() ) {
 	    do {
@@ -710,6 +1072,7 @@ void ssync( DepTy<T> obj ) {
     // If the frame is full and has outstanding children, jump back to scheduler
     // until they have executed. Otherwise, we're done.
     if( fr->is_full() ) {
+	wf_issue_deferred( fr->get_full() );
 	if( !DepTy<T>::dep_traits::arg_ini_ready( obj ) ) {
 	    do {
 		fr->sync();
@@ -776,6 +1139,35 @@ void foreachi( InputIterator start, InputIterator end,
     foreachig<InputIterator,Tn...>( start, end, 1, func, an...  );
 }
 
+// Interface description:
+// first_touch(): call func( from, to, an... ) on the ranges of a fixed
+//                partition of [0, n), one range per worker, each with
+//                affinity to its worker (spawn_on()). Memory allocated or
+//                first written by func is thus placed on the NUMA node of
+//                the worker in a deterministic way. Call from sequential
+//                code, like run().
+template<typename... Tn>
+void first_touch_task( size_t n, void (*func)( size_t, size_t, Tn... ),
+		       Tn... an ) {
+    // Spawn the range of the current worker last, it executes immediately
+    size_t nw = ::nthreads;
+    size_t me = worker_state::tls()->get_id();
+    for( size_t i=1; i <= nw; ++i ) {
+	size_t k = ( me + i ) % nw;
+	size_t from = n * k / nw;
+	size_t to = n * ( k+1 ) / nw;
+	if( from < to )
+	    spawn_on( on_worker( k ), func, from, to, an... );
+    }
+    ssync();
+}
+
+template<typename... Tn>
+void first_touch( size_t n, void (*func)( size_t, size_t, Tn... ),
+		  Tn... an ) {
+    run( &first_touch_task<Tn...>, n, func, an... );
+}
+
 template<typename InputIterator, typename... Tn>
 void foreachirg( InputIterator start, InputIterator end, size_t granularity,
 		 void (*func)( InputIterator, InputIterator, Tn... ),
@@ -799,6 +1191,38 @@ void foreachir( InputIterator start, InputIterator end,
     foreachirg<InputIterator,Tn...>( start, end, 1, func, an...  );
 }
 
+// Interface description:
+// foreach_pop(): drain the hyperqueue q with n consumer tasks in parallel
+//                (n=0: one per worker). The consumers claim the elements of
+//                q one at a time and call func( t, idx, an... ) on them,
+//                where idx is the position of t in the queue. Use
+//                obj::reorder to pass results on in queue order. Call from
+//                the task that holds the popdep, which syncs.
+template<typename T, typename... Tn>
+void foreach_pop_task( obj::parallel_pop<T> * pp,
+		       void (*func)( T, size_t, Tn... ), Tn... an ) {
+    T t;
+    size_t idx;
+    while( pp->claim( t, idx ) )
+	call( func, t, idx, an... );
+}
+
+template<typename T, typename... Tn>
+void foreach_pop( obj::popdep<T> q, size_t n,
+		  void (*func)( T, size_t, Tn... ), Tn... an ) {
+    obj::parallel_pop<T> pp( q );
+    // Spread the consumers over the workers. Plain spawns may be executed
+    // inline when SPAWN_CUTOFF is enabled, which would serialize them.
+    size_t nw = ::nthreads;
+    size_t me = worker_state::tls()->get_id();
+    if( n == 0 )
+	n = nw;
+    for( size_t i=1; i <= n; ++i )
+	spawn_on( on_worker( ( me + i ) % nw ), &foreach_pop_task<T, Tn...>,
+		  &pp, func, an... );
+    ssync();
+}
+
 // The leaf_call<>() functions execute leaf calls. Their property is that
 // they can not be stolen (because they are leafs, the processor never lets
 // go of them). Therefore, we can execute them on the original program stack
@@ -0,0 +1,113 @@
+// -*- c++ -*-
+/*
+ * Copyright (C) 2011 Hans Vandierendonck (hvandierendonck@acm.org)
+ * Copyright (C) 2011 George Tzenakis (tzenakis@ics.forth.gr)
+ * Copyright (C) 2011 Dimitrios S. Nikolopoulos (dsn@ics.forth.gr)
+ *
+ * This file is part of Swan.
+ *
+ * Swan is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Swan is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Swan.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* wf_mailbox.h
+ * Mailboxes hold ready tasks that spawn_on() placed on a worker or on a
+ * NUMA node. A worker drains its own mailbox and that of its node before
+ * it steals at random. Other workers take a task only when it has waited
+ * for longer than SPAWN_AFFINITY_TIMEOUT, which keeps the hint soft.
+ */
+#ifndef WF_MAILBOX_H
+#define WF_MAILBOX_H
+
+#include <stdint.h>
+#include <deque>
+
+#include "swan_config.h"
+#include "platform.h"
+#include "lock.h"
+
+class full_frame;
+class pending_frame;
+
+// Affinity hints for spawn_on()
+struct on_worker {
+    size_t id;
+    explicit on_worker( size_t id_ ) : id( id_ ) { }
+};
+
+struct on_node {
+    size_t id;
+    explicit on_node( size_t id_ ) : id( id_ ) { }
+};
+
+// A FIFO of pending frames with their parents. The parent is kept alive
+// by the pending frame, which counts as one of its children. Posting
+// cannot fail: the task may already hold its commutative objects.
+class mailbox {
+public:
+    struct entry {
+	full_frame * parent;
+	pending_frame * pnd;
+	uint64_t posted;
+    };
+
+private:
+    cas_mutex mutex;
+    volatile size_t length; // checked without the lock
+    std::deque<entry> fifo;
+
+public:
+    mailbox() : length( 0 ) { }
+
+    bool empty() const { return length == 0; }
+
+    void post( full_frame * parent, pending_frame * pnd ) {
+	entry e = { parent, pnd, get_ticks() };
+	mutex.lock();
+	fifo.push_back( e );
+	length = fifo.size();
+	mutex.unlock();
+    }
+
+    // Take the oldest entry. Used by the workers the tasks are placed on.
+    bool take( entry & e ) {
+	if( empty() )
+	    return false;
+	mutex.lock();
+	bool ok = pop( e, ~uint64_t(0) );
+	mutex.unlock();
+	return ok;
+    }
+
+    // Take the oldest entry if it was posted at or before the given time.
+    // Used by all other workers; gives up when the mailbox is busy.
+    bool take_overdue( entry & e, uint64_t posted_before ) {
+	if( empty() || !mutex.try_lock() )
+	    return false;
+	bool ok = pop( e, posted_before );
+	mutex.unlock();
+	return ok;
+    }
+
+private:
+    bool pop( entry & e, uint64_t posted_before ) {
+	if( fifo.empty() || fifo.front().posted > posted_before )
+	    return false;
+	e = fifo.front();
+	fifo.pop_front();
+	length = fifo.size();
+	return true;
+    }
+};
+
+#endif // WF_MAILBOX_H
@@ -26,9 +26,17 @@
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <cerrno>
 #include <cassert>
 #include <csetjmp>
 
+#if defined(__linux__)
+#include <unistd.h>
+#include <limits.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#endif
+
 #ifdef HAVE_LIBHWLOC
 #include <hwloc.h>
 #endif
@@ -36,10 +44,12 @@
 #include <iostream>
 #include <deque>
 #include <vector>
+#include <string>
 
 #include "wf_spawn_deque.h"
 #include "wf_stack_frame.h"
 #include "wf_worker.h"
+#include "wf_placement.h"
 #include "wf_interface.h"
 #include "logger.h"
 
@@ -53,7 +63,17 @@ size_t nthreads;
 __thread size_t threadid;
 static pthread_t * thread;
 
-volatile long ini_barrier = 0;
+volatile int ini_barrier = 0;
+volatile bool workers_started = false;
+
+static size_t num_nodes = 1;
+#if SPAWN_AFFINITY
+mailbox * node_mailbox; // tasks placed on a NUMA node by spawn_on()
+#endif
+
+#ifdef HAVE_LIBHWLOC
+static hwloc_topology_t topology;
+#endif
 
 void validate_spawn_deque( spawn_deque * d ) {
     bool fnd = false;
@@ -66,7 +86,138 @@ void validate_spawn_deque( spawn_deque * d ) {
 	exit( 1 );
 }
 
+// Start barrier. The initial thread sleeps in the kernel until the last
+// worker has checked in, instead of spinning on ini_barrier.
+static void startup_barrier_wait() {
+    int v;
+    while( (v = ini_barrier) > 0 ) {
+#if defined(__linux__)
+	syscall( SYS_futex, (int *)&ini_barrier, FUTEX_WAIT_PRIVATE, v,
+		 NULL, NULL, 0 );
+#else
+	sched_yield();
+#endif
+    }
+}
+
+// Called by each worker thread once it is up and running.
+void wf_startup_arrive() {
+    if( __sync_add_and_fetch( &ini_barrier, -1 ) == 0 ) {
+#if defined(__linux__)
+	syscall( SYS_futex, (int *)&ini_barrier, FUTEX_WAKE_PRIVATE, 1,
+		 NULL, NULL, 0 );
+#endif
+    }
+}
+
+#ifdef HAVE_LIBHWLOC
+// Topology discovery walks sysfs and is by far the most expensive part
+// of starting up. If TOPOLOGY_CACHE names an XML file, the topology is
+// loaded from that file when it exists and saved to it otherwise.
+static void load_topology() {
+    hwloc_topology_init( &topology );
+
+    const char * cache = getenv( "TOPOLOGY_CACHE" );
+    bool cached = false;
+    if( cache && access( cache, R_OK ) == 0 ) {
+	if( hwloc_topology_set_xml( topology, cache ) == 0 ) {
+	    // Allow binding although the topology was not discovered here
+	    hwloc_topology_set_flags( topology,
+				      HWLOC_TOPOLOGY_FLAG_IS_THISSYSTEM );
+	    cached = true;
+	}
+    }
+
+    hwloc_topology_load( topology );
+
+    if( cache && !cached ) {
+#if HWLOC_API_VERSION >= 0x00020000
+	if( hwloc_topology_export_xml( topology, cache, 0 ) < 0 )
+#else
+	if( hwloc_topology_export_xml( topology, cache ) < 0 )
+#endif
+	    fprintf( stderr, "hwloc: could not save topology to %s\n", cache );
+    }
+}
+#endif
+
+// Name of the dependency-tracking backend compiled in. These names match
+// the BACKENDS in Makefile.flags.
+static const char * backend_name() {
+    switch( OBJECT_TASKGRAPH ) {
+    case 0: return "none";
+    case 1: return "tkt";
+    case 8: return "vtkt";
+    case 9: return "cs";
+    case 10: return "cg";
+    case 11: return "ecg";
+    case 12: return "gtkt";
+    case 16: return "ltkt";
+    default: return "other";
+    }
+}
+
+#if defined(__linux__)
+// Select the dependency-tracking backend at run time. If TASKGRAPH names
+// a backend other than the compiled-in one, re-execute the same program
+// built for that backend, i.e., <prog>_<backend> as built by
+// 'make backends' in the benchmark directories.
+static void select_backend() {
+    const char * want = getenv( "TASKGRAPH" );
+    if( !want || !*want || !strcmp( want, backend_name() ) )
+	return;
+
+    char exe[PATH_MAX];
+    ssize_t len = readlink( "/proc/self/exe", exe, sizeof(exe)-1 );
+    if( len < 0 ) {
+	fprintf( stderr, "TASKGRAPH: cannot locate executable: %s\n",
+		 strerror( errno ) );
+	exit( 2 );
+    }
+    exe[len] = '\0';
+
+    // Strip our own backend suffix, if any
+    std::string path( exe );
+    std::string own = std::string( "_" ) + backend_name();
+    if( path.size() > own.size()
+	&& path.compare( path.size()-own.size(), own.size(), own ) == 0 )
+	path.erase( path.size()-own.size() );
+    path += std::string( "_" ) + want;
+
+    if( access( path.c_str(), X_OK ) != 0 ) {
+	fprintf( stderr, "TASKGRAPH: backend '%s' not available: "
+		 "%s: %s\n", want, path.c_str(), strerror( errno ) );
+	exit( 2 );
+    }
+
+    // Recover the command line arguments
+    std::vector<char> cmdline;
+    FILE * fp = fopen( "/proc/self/cmdline", "r" );
+    if( fp ) {
+	int c;
+	while( (c = fgetc( fp )) != EOF )
+	    cmdline.push_back( (char)c );
+	fclose( fp );
+    }
+    std::vector<char *> argv;
+    for( size_t i=0; i < cmdline.size(); i += strlen( &cmdline[i] ) + 1 )
+	argv.push_back( &cmdline[i] );
+    if( argv.empty() )
+	argv.push_back( const_cast<char *>( path.c_str() ) );
+    argv.push_back( 0 );
+
+    execv( path.c_str(), &argv[0] );
+    fprintf( stderr, "TASKGRAPH: cannot execute %s: %s\n",
+	     path.c_str(), strerror( errno ) );
+    exit( 2 );
+}
+#else
+static void select_backend() { }
+#endif
+
 void wf_initialize() {
+    select_backend();
+
     const char * pv = getenv( "PRINT_VERSION" );
     if( pv && atoi(pv) > 0 ) {
 #include "current_version.h"
@@ -96,6 +247,7 @@ void wf_initialize() {
 		  << SHOWI(DEBUG_CERR)
 		  << SHOWI(IMPROVED_STUBS)
 		  << SHOWI(OBJECT_TASKGRAPH)
+		  << "\n\tbackend = " << backend_name()
 		  << SHOWI(OBJECT_COMMUTATIVITY)
 		  << SHOWI(OBJECT_REDUCTION)
 		  << SHOWI(CACHE_ALIGNMENT)
@@ -106,6 +258,20 @@ void wf_initialize() {
 		  << "\n\tHAVE_LIBHWLOC = 0"
 #endif
 		  << SHOWI(PACT11_VERSION)
+		  << SHOWI(LAZY_WORKER_START)
+		  << SHOWI(FAST_CONTEXT_SWITCH)
+		  << SHOWI(HUGE_PAGE_ALLOC)
+		  << SHOWI(LAZY_FULL_FRAME)
+		  << SHOWI(SPAWN_CUTOFF)
+		  << SHOWI(SPAWN_CUTOFF_STACK)
+		  << SHOWI(SPAWN_AFFINITY)
+		  << SHOWI(SPAWN_AFFINITY_TIMEOUT)
+		  << SHOWI(TG_READY_LIST_SHARDS)
+		  << SHOWI(OBJECT_THROTTLE)
+		  << SHOWI(TKT_BRANCHFREE_READY)
+		  << SHOWI(TKT_COMMUTATIVE_BATCH)
+		  << SHOWI(TKT_PRIORITIES)
+		  << SHOWI(QUEUE_MIRROR)
 		  << '\n';
 #undef xstr
 #undef str
@@ -118,6 +284,10 @@ void wf_initialize() {
     const char * str = getenv( "NUM_THREADS" );
     nthreads = str ? atoi( str ) : 2;
 
+#if OBJECT_THROTTLE
+    obj::throttle.configure();
+#endif
+
     ws = new worker_state[nthreads];
     thread = new pthread_t[nthreads];
     thread_logger = new logger[nthreads];
@@ -127,12 +297,27 @@ void wf_initialize() {
     tls_thread_logger = &thread_logger[0];
     threadid = 0;
 
+    for( size_t i=0; i < nthreads; ++i )
+	ws[i].initialize( i, nthreads, ws[0].get_future() );
+
+#if !LAZY_WORKER_START
+    wf_start_workers();
+#endif
+}
+
+// Create the worker pool. Deferred to the first call to run() so that
+// programs that never enter the parallel runtime do not pay for topology
+// discovery, thread placement and thread creation. The worker states,
+// including that of the initial thread, are initialized before main() by
+// wf_initialize() and are placed here, before any worker thread exists.
+void wf_start_workers() {
+    if( workers_started )
+	return;
+
 #if !defined(__APPLE__)
     // Get the initial thread affinity for the initial thread.
-    // All threads will be scheduled to this set in round-robin fashion.
+    // All threads will be placed on this set (see wf_placement.h).
     cpu_set_t cpu_hint;
-    unsigned cpu_current;
-    unsigned cpu_max = sizeof(cpu_hint)*8;
     pthread_getaffinity_np( pthread_self(), sizeof(cpu_hint), &cpu_hint );
     if( (unsigned)CPU_COUNT( &cpu_hint ) < nthreads ) {
 	std::cerr << "Error: number of CPUs in initial affinity set ("
@@ -140,83 +325,44 @@ void wf_initialize() {
 		  << ") is less than number of threads ("
 		  << nthreads << ").\n";
     }
-    for( cpu_current=0; cpu_current < cpu_max; ++cpu_current ) 
-       if( CPU_ISSET( cpu_current, &cpu_hint ) )
-           break;
-#else
-    unsigned cpu_current = 0; // No affinity yet for MacOSX
 #endif
 
 #ifdef HAVE_LIBHWLOC
     // Use HWLOC library to figure out cores and memory nodes
-    // Allocate and initialize topology object.
-    hwloc_topology_t topology;
-    hwloc_topology_init( &topology );
-    
-    // Perform the topology detection.
-    hwloc_topology_load( topology );
-
-    // Using PU here instead of CORE means we accept hyper-threaded
-    // architectures and we will run threads on them
-    int pdepth = hwloc_get_type_or_below_depth( topology, HWLOC_OBJ_PU );
-    if( pdepth == HWLOC_TYPE_DEPTH_UNKNOWN ) {
-	fprintf( stderr, "hwloc: no objects of type PU?\n" );
-	exit( 2 );
-    }
-    size_t num_pus = hwloc_get_nbobjs_by_depth( topology, pdepth );
-    if( num_pus < nthreads ) {
-	fprintf( stderr, "hwloc: fewer PUs (%lu) than threads (%lu)\n",
-		 num_pus, nthreads );
-	exit( 2 );
-    }
-
-    // Initializing main and other threads
-    for( size_t i=0; i < nthreads; ++i ) {
-	hwloc_obj_t pu
-	    = hwloc_get_obj_by_type( topology, HWLOC_OBJ_PU, cpu_current );
-	if( !pu ) {
-	    fprintf( stderr, "hwloc: could not find object for PU %u\n",
-		     cpu_current );
-	    exit( 2 );
-	}
-	hwloc_obj_t obj;
-	for( obj=pu->parent; obj; obj=obj->parent ) {
-	    if( obj->type == HWLOC_OBJ_NODE )
-		break;
-	}
-	if( !obj ) {
-	    fprintf( stderr, "hwloc: could not find memory for thread %lu, "
-	    	     "PU %u\n", i, cpu_current );
-	    exit( 2 );
-	}
-
-	ws[i].initialize( i, nthreads, topology, pu->logical_index,
-			  obj->logical_index, ws[0].get_future() );
+    // Allocate, initialize and load the topology object.
+    load_topology();
+#endif
 
 #if !defined(__APPLE__)
-	// Advance to next allowed (hinted) CPU
-	for( ++cpu_current; cpu_current < cpu_max; ++cpu_current ) 
-	   if( CPU_ISSET( cpu_current, &cpu_hint ) )
-	       break;
-#else
-	++cpu_current;
+    std::vector<cpu_place> place = thread_placement( nthreads, cpu_hint
+#ifdef HAVE_LIBHWLOC
+						     , topology
 #endif
-    }
-#else
-    for( size_t i=0; i < nthreads; ++i ) {
-	ws[i].initialize( i, nthreads, cpu_current, 0, ws[0].get_future() );
-#if !defined(__APPLE__)
-	// Advance to next allowed (hinted) CPU
-	for( ++cpu_current; cpu_current < cpu_max; ++cpu_current ) 
-	   if( CPU_ISSET( cpu_current, &cpu_hint ) )
-	       break;
+	);
+    for( size_t i=0; i < nthreads; ++i )
+	ws[i].place(
+#ifdef HAVE_LIBHWLOC
+	    topology,
+#endif
+	    place[i].cpu, place[i].node );
 #else
-	++cpu_current;
+    for( size_t i=0; i < nthreads; ++i ) // No affinity yet for MacOSX
+	ws[i].place(
+#ifdef HAVE_LIBHWLOC
+	    topology,
 #endif
-    }
+	    i, 0 );
+#endif
+
+    for( size_t i=0; i < nthreads; ++i )
+	if( ws[i].get_node() >= num_nodes )
+	    num_nodes = ws[i].get_node() + 1;
+#if SPAWN_AFFINITY
+    node_mailbox = new mailbox[num_nodes];
 #endif
 
     ws[0].cpubind();
+
     ini_barrier = nthreads - 1;
 
     // Creation of other threads
@@ -233,10 +379,20 @@ void wf_initialize() {
     // that we don't miss out on any thread or we will feel it throughout the
     // application.
     // Also, it may solve some issues with performance measurement.
-    while( ini_barrier > 0 ); // busy-wait barrier :(
+    startup_barrier_wait();
+
+    workers_started = true;
 }
 
 void wf_shutdown() {
+    if( !workers_started ) {
+	// The parallel runtime was never entered
+	delete[] ws;
+	delete[] thread;
+	delete[] thread_logger;
+	return;
+    }
+
     // Make sure that the computation is flagged as finished, in case
     // the executed call path of the program did not execute in parallel.
     ws[0].get_future()->flag_result();
@@ -260,9 +416,24 @@ void wf_shutdown() {
     obj::dump_statistics();
 #endif
 
+#if OBJECT_THROTTLE
+    obj::throttle.dump_statistics();
+#endif
+
     delete[] ws;
     delete[] thread;
     delete[] thread_logger;
+#if SPAWN_AFFINITY
+    delete[] node_mailbox;
+#endif
+
+#ifdef HAVE_LIBHWLOC
+    hwloc_topology_destroy( topology );
+#endif
+}
+
+size_t wf_num_nodes() {
+    return num_nodes;
 }
 
 struct wf_initializer {
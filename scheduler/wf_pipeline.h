@@ -0,0 +1,346 @@
+/*
+ * Copyright (C) 2011 Hans Vandierendonck (hvandierendonck@acm.org)
+ * Copyright (C) 2011 George Tzenakis (tzenakis@ics.forth.gr)
+ * Copyright (C) 2011 Dimitrios S. Nikolopoulos (dsn@ics.forth.gr)
+ *
+ * This file is part of Swan.
+ *
+ * Swan is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Swan is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Swan.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// -*- c++ -*-
+/*
+ * Pipelines on hyperqueues.
+ *
+ * parallel_pipeline() executes a linear chain of filters, similar to TBB's
+ * parallel_pipeline. Every filter executes as a task and consecutive
+ * filters are connected by a hyperqueue, such that all filters execute
+ * concurrently. The first filter produces the items: it is a functor
+ * bool f( Out & ) that returns false when there are no more items. The
+ * other filters are functors Out f( In ), except for the last one, which
+ * is a functor void f( In ). Every filter is applied once to every item.
+ *
+ * The mode of a filter is one of:
+ *  - serial_in_order: items are processed one at a time, in the order in
+ *    which the first filter produced them. Items that overtook each other
+ *    in a preceding filter are put back in order before they enter.
+ *  - serial_out_of_order: items are processed one at a time, in the order
+ *    in which they arrive.
+ *  - parallel: the filter is replicated over the workers. Items are taken
+ *    from the queue in batches and every batch is processed by a task,
+ *    with at most one batch per worker.
+ * The first filter is always executed serially and in order.
+ *
+ * At most max_tokens items are in flight in the pipeline: the first filter
+ * takes a token before it produces an item and the last filter returns the
+ * token when it is done with the item. A first filter without tokens does
+ * not wait for them while holding a worker, as the filters that return
+ * them may not be running. Unless tokens come back shortly, it ends a
+ * round: the pipeline drains and restarts the first filter on the next
+ * item. On a single worker, every round passes max_tokens items.
+ *
+ * Usage:
+ *     parallel_pipeline( max_tokens,
+ *         make_filter<void, A>( serial_in_order, read ),
+ *         make_filter<A, B>( parallel, transform, batch ),
+ *         make_filter<B, void>( serial_in_order, write ) );
+ *
+ * parallel_pipeline() returns when all items have passed the last filter.
+ * The functors are copied into the pipeline and shared by the replicas of
+ * a parallel filter.
+ */
+#ifndef WF_PIPELINE_H
+#define WF_PIPELINE_H
+
+#include "swan_config.h"
+
+#include <sched.h>
+#include <algorithm>
+
+#include "wf_interface.h"
+
+namespace obj {
+
+enum filter_mode {
+    serial_in_order,
+    serial_out_of_order,
+    parallel
+};
+
+template<typename In, typename Out, typename F>
+struct filter {
+    filter_mode mode;
+    F fn;
+    size_t batch;
+
+    filter( filter_mode mode_, F fn_, size_t batch_ )
+	: mode( mode_ ), fn( fn_ ), batch( batch_ ) { }
+};
+
+template<typename In, typename Out, typename F>
+filter<In, Out, F> make_filter( filter_mode mode, F fn, size_t batch = 1 ) {
+    return filter<In, Out, F>( mode, fn, std::max( batch, size_t(1) ) );
+}
+
+// An item in the queues between filters, tagged with its position in the
+// output of the first filter.
+template<typename T>
+struct pipeline_token {
+    size_t idx;
+    T value;
+
+    pipeline_token() { }
+    pipeline_token( size_t idx_, const T & value_ )
+	: idx( idx_ ), value( value_ ) { }
+};
+
+// Hands the results of a filter to the queue of the next filter. The
+// results are put back in order when they may be out of order and the
+// next filter is serial_in_order. Called concurrently by the replicas of
+// a parallel filter.
+template<typename T>
+class pipeline_output {
+    typedef pipeline_token<T> token_t;
+
+    struct push_fn {
+	pushdep<token_t> queue;
+	push_fn( pushdep<token_t> queue_ ) : queue( queue_ ) { }
+	void operator () ( const token_t & t ) { queue.push( t ); }
+    };
+
+    push_fn push;
+    reorder<token_t, push_fn> order;
+    cas_mutex mutex;
+    const bool in_order;
+
+public:
+    pipeline_output( pushdep<token_t> queue, bool in_order_ )
+	: push( queue ), order( push ), in_order( in_order_ ) { }
+
+    void put( size_t idx, const T & t ) {
+	if( in_order )
+	    order.put( idx, token_t( idx, t ) );
+	else {
+	    mutex.lock();
+	    push( token_t( idx, t ) );
+	    mutex.unlock();
+	}
+    }
+};
+
+// Tokens for the items in flight. acquire() fails, rather than waiting
+// indefinitely, when no token is returned after a number of yields.
+class pipeline_tokens {
+    static const size_t max_yields = 64;
+    volatile size_t avail;
+
+public:
+    pipeline_tokens( size_t n ) : avail( std::max( n, size_t(1) ) ) { }
+
+    bool acquire() {
+	for( size_t yields=0; ; ) {
+	    size_t a = avail;
+	    if( a > 0 ) {
+		if( __sync_bool_compare_and_swap( &avail, a, a-1 ) )
+		    return true;
+	    } else if( ::nthreads == 1 || yields++ == max_yields )
+		return false;
+	    else
+		sched_yield();
+	}
+    }
+    void release() { __sync_fetch_and_add( &avail, 1 ); }
+};
+
+// The last filter has no output. It returns the tokens.
+template<>
+class pipeline_output<void> {
+    pipeline_tokens * tokens;
+
+public:
+    pipeline_output( pipeline_tokens * tokens_ ) : tokens( tokens_ ) { }
+
+    void done() { tokens->release(); }
+};
+
+template<typename Out>
+struct pipeline_apply {
+    template<typename In, typename F>
+    static void apply( F * fn, pipeline_output<Out> * out,
+		       const pipeline_token<In> & t ) {
+	out->put( t.idx, (*fn)( t.value ) );
+    }
+};
+
+template<>
+struct pipeline_apply<void> {
+    template<typename In, typename F>
+    static void apply( F * fn, pipeline_output<void> * out,
+		       const pipeline_token<In> & t ) {
+	(*fn)( t.value );
+	out->done();
+    }
+};
+
+// Tasks executing the filters. The source ends the round when it runs
+// out of tokens and clears *more when it runs out of items.
+template<typename Out, typename F>
+void pipeline_source( pushdep<pipeline_token<Out> > out, F * fn,
+		      pipeline_tokens * tokens, bool * more ) {
+    Out o;
+    for( size_t idx=0; tokens->acquire(); ++idx ) {
+	if( !(*fn)( o ) ) {
+	    tokens->release();
+	    *more = false;
+	    return;
+	}
+	out.push( pipeline_token<Out>( idx, o ) );
+    }
+}
+
+template<typename In, typename Out, typename F>
+void pipeline_serial_run( popdep<pipeline_token<In> > in,
+			  pipeline_output<Out> * out, F * fn ) {
+    while( !in.empty() ) {
+	pipeline_token<In> t = in.pop();
+	pipeline_apply<Out>::apply( fn, out, t );
+    }
+}
+
+template<typename In, typename Out, typename F>
+void pipeline_serial( popdep<pipeline_token<In> > in,
+		      pushdep<pipeline_token<Out> > out, F * fn,
+		      bool reassemble ) {
+    pipeline_output<Out> o( out, reassemble );
+    pipeline_serial_run( in, &o, fn );
+}
+
+template<typename In, typename F>
+void pipeline_serial_sink( popdep<pipeline_token<In> > in, F * fn,
+			   pipeline_tokens * tokens ) {
+    pipeline_output<void> o( tokens );
+    pipeline_serial_run<In, void, F>( in, &o, fn );
+}
+
+template<typename In, typename Out, typename F>
+void pipeline_batch( pipeline_token<In> * buf, size_t n,
+		     pipeline_output<Out> * out, F * fn,
+		     volatile size_t * active ) {
+    for( size_t i=0; i < n; ++i )
+	pipeline_apply<Out>::apply( fn, out, buf[i] );
+    delete[] buf;
+    __sync_fetch_and_add( active, -1 );
+}
+
+// The task holding the popdep collects batches of items and spawns a task
+// for each batch. The batch tasks do not wait on queues: a task waiting
+// for items would keep a worker from executing the tasks that produce
+// them. The spawned tasks are executing, because the worker executes a
+// spawned task right away and leaves the continuation to thieves, hence
+// it is safe to wait for one of them to complete.
+template<typename In, typename Out, typename F>
+void pipeline_parallel_run( popdep<pipeline_token<In> > in,
+			    pipeline_output<Out> * out, F * fn,
+			    size_t replicas, size_t batch ) {
+    volatile size_t active = 0;
+    while( !in.empty() ) {
+	pipeline_token<In> * buf = new pipeline_token<In>[batch];
+	size_t n = 0;
+	while( n < batch && !in.empty() )
+	    buf[n++] = in.pop();
+	while( active >= replicas )
+	    sched_yield();
+	__sync_fetch_and_add( &active, 1 );
+	spawn( &pipeline_batch<In, Out, F>, buf, n, out, fn, &active );
+    }
+    ssync();
+}
+
+template<typename In, typename Out, typename F>
+void pipeline_parallel( popdep<pipeline_token<In> > in,
+			pushdep<pipeline_token<Out> > out, F * fn,
+			size_t replicas, size_t batch, bool reassemble ) {
+    pipeline_output<Out> o( out, reassemble );
+    pipeline_parallel_run( in, &o, fn, replicas, batch );
+}
+
+template<typename In, typename F>
+void pipeline_parallel_sink( popdep<pipeline_token<In> > in, F * fn,
+			     pipeline_tokens * tokens,
+			     size_t replicas, size_t batch ) {
+    pipeline_output<void> o( tokens );
+    pipeline_parallel_run<In, void, F>( in, &o, fn, replicas, batch );
+}
+
+// Spawning the filters. The hyperqueues live in the frames of the
+// recursive calls of pipeline_chain(), the last one of which syncs.
+template<typename In, typename Out, typename F, typename... Filters>
+filter_mode pipeline_first_mode( const filter<In, Out, F> & f,
+				 const Filters &... fs ) {
+    return f.mode;
+}
+
+static inline size_t pipeline_replicas( size_t max_tokens, size_t batch ) {
+    return std::max( size_t(1),
+		     std::min( size_t(::nthreads), max_tokens / batch ) );
+}
+
+template<typename In, typename F>
+void pipeline_chain( size_t max_tokens, pipeline_tokens * tokens,
+		     bool ordered, popdep<pipeline_token<In> > in,
+		     filter<In, void, F> & f ) {
+    if( f.mode == parallel )
+	spawn( &pipeline_parallel_sink<In, F>, in, &f.fn, tokens,
+	       pipeline_replicas( max_tokens, f.batch ), f.batch );
+    else
+	spawn( &pipeline_serial_sink<In, F>, in, &f.fn, tokens );
+    ssync();
+}
+
+template<typename In, typename Out, typename F, typename... Filters>
+void pipeline_chain( size_t max_tokens, pipeline_tokens * tokens,
+		     bool ordered, popdep<pipeline_token<In> > in,
+		     filter<In, Out, F> & f, Filters &... fs ) {
+    hyperqueue<pipeline_token<Out> > queue;
+    ordered = ordered && f.mode != parallel;
+    bool reassemble = !ordered && pipeline_first_mode( fs... ) == serial_in_order;
+    if( f.mode == parallel )
+	spawn( &pipeline_parallel<In, Out, F>, in,
+	       (pushdep<pipeline_token<Out> >)queue, &f.fn,
+	       pipeline_replicas( max_tokens, f.batch ), f.batch, reassemble );
+    else
+	spawn( &pipeline_serial<In, Out, F>, in,
+	       (pushdep<pipeline_token<Out> >)queue, &f.fn, reassemble );
+    pipeline_chain( max_tokens, tokens, ordered || reassemble,
+		    (popdep<pipeline_token<Out> >)queue, fs... );
+}
+
+template<typename Out, typename F, typename... Filters>
+void parallel_pipeline( size_t max_tokens, filter<void, Out, F> first,
+			Filters... fs ) {
+    pipeline_tokens tokens( max_tokens );
+    bool more = true;
+    while( more ) {
+	hyperqueue<pipeline_token<Out> > queue;
+	spawn( &pipeline_source<Out, F>,
+	       (pushdep<pipeline_token<Out> >)queue, &first.fn, &tokens,
+	       &more );
+	pipeline_chain( max_tokens, &tokens, true,
+			(popdep<pipeline_token<Out> >)queue, fs... );
+    }
+}
+
+} // namespace obj
+
+#endif // WF_PIPELINE_H
@@ -0,0 +1,267 @@
+/*
+ * Copyright (C) 2011 Hans Vandierendonck (hvandierendonck@acm.org)
+ * Copyright (C) 2011 George Tzenakis (tzenakis@ics.forth.gr)
+ * Copyright (C) 2011 Dimitrios S. Nikolopoulos (dsn@ics.forth.gr)
+ *
+ * This file is part of Swan.
+ *
+ * Swan is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Swan is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Swan.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "swan_config.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <algorithm>
+#include <map>
+#include <utility>
+
+#if !defined(__APPLE__)
+#include <dirent.h>
+#endif
+
+#include "wf_placement.h"
+
+#if !defined(__APPLE__)
+
+enum placement_policy_t {
+    pp_linear,
+    pp_compact,
+    pp_scatter,
+    pp_node
+};
+
+static const char * policy_name[] = { "linear", "compact", "scatter", "node" };
+
+static placement_policy_t placement_policy() {
+    const char * str = getenv( "PLACEMENT" );
+    if( !str || !*str )
+	return pp_scatter;
+    for( int p=pp_linear; p <= pp_node; ++p )
+	if( !strcmp( str, policy_name[p] ) )
+	    return placement_policy_t( p );
+    fprintf( stderr, "PLACEMENT: unknown policy '%s', expecting linear, "
+	     "compact, scatter or node\n", str );
+    exit( 2 );
+}
+
+#ifdef HAVE_LIBHWLOC
+static std::vector<cpu_place>
+read_topology( const cpu_set_t & allowed, hwloc_topology_t topology ) {
+    std::vector<cpu_place> cpus;
+    int num_pus = hwloc_get_nbobjs_by_type( topology, HWLOC_OBJ_PU );
+    int num_nodes = hwloc_get_nbobjs_by_type( topology, HWLOC_OBJ_NODE );
+    for( int i=0; i < num_pus; ++i ) {
+	hwloc_obj_t pu = hwloc_get_obj_by_type( topology, HWLOC_OBJ_PU, i );
+	if( !CPU_ISSET( pu->os_index, &allowed ) )
+	    continue;
+	hwloc_obj_t core
+	    = hwloc_get_ancestor_obj_by_type( topology, HWLOC_OBJ_CORE, pu );
+	hwloc_obj_t pkg
+	    = hwloc_get_ancestor_obj_by_type( topology, HWLOC_OBJ_SOCKET, pu );
+	cpu_place c;
+	c.cpu = pu->os_index;
+	c.core = core ? core->logical_index : pu->logical_index;
+	c.smt = 0;
+	c.package = pkg ? pkg->logical_index : 0;
+	c.node = 0;
+	// Memory nodes need not be ancestors of the PU (hwloc 2)
+	for( int n=0; n < num_nodes; ++n ) {
+	    hwloc_obj_t nd
+		= hwloc_get_obj_by_type( topology, HWLOC_OBJ_NODE, n );
+	    if( nd->cpuset && hwloc_bitmap_isset( nd->cpuset, c.cpu ) ) {
+		c.node = nd->logical_index;
+		break;
+	    }
+	}
+	cpus.push_back( c );
+    }
+    return cpus;
+}
+#else
+static bool read_uint( const char * path, unsigned & val ) {
+    FILE * fp = fopen( path, "r" );
+    if( !fp )
+	return false;
+    bool ok = fscanf( fp, "%u", &val ) == 1;
+    fclose( fp );
+    return ok;
+}
+
+// Parse a list of CPUs like "0-3,8-11" and record the node of each
+static void read_node_cpus( unsigned node, std::map<unsigned, unsigned> & node_of ) {
+    char path[128];
+    snprintf( path, sizeof(path),
+	      "/sys/devices/system/node/node%u/cpulist", node );
+    FILE * fp = fopen( path, "r" );
+    if( !fp )
+	return;
+    unsigned lo, hi;
+    int sep;
+    while( fscanf( fp, "%u", &lo ) == 1 ) {
+	hi = lo;
+	sep = fgetc( fp );
+	if( sep == '-' ) {
+	    if( fscanf( fp, "%u", &hi ) != 1 )
+		break;
+	    sep = fgetc( fp );
+	}
+	for( unsigned c=lo; c <= hi; ++c )
+	    node_of[c] = node;
+	if( sep != ',' )
+	    break;
+    }
+    fclose( fp );
+}
+
+static std::vector<cpu_place>
+read_topology( const cpu_set_t & allowed ) {
+    std::map<unsigned, unsigned> node_of;
+    if( DIR * dir = opendir( "/sys/devices/system/node" ) ) {
+	while( struct dirent * de = readdir( dir ) ) {
+	    unsigned node;
+	    if( sscanf( de->d_name, "node%u", &node ) == 1 )
+		read_node_cpus( node, node_of );
+	}
+	closedir( dir );
+    }
+
+    // Core IDs are unique only within a package
+    std::map<std::pair<unsigned, unsigned>, unsigned> core_of;
+    std::vector<cpu_place> cpus;
+    for( unsigned cpu=0; cpu < CPU_SETSIZE; ++cpu ) {
+	if( !CPU_ISSET( cpu, &allowed ) )
+	    continue;
+	char path[128];
+	unsigned core_id = cpu, pkg = 0;
+	snprintf( path, sizeof(path),
+		  "/sys/devices/system/cpu/cpu%u/topology/core_id", cpu );
+	read_uint( path, core_id );
+	snprintf( path, sizeof(path),
+		  "/sys/devices/system/cpu/cpu%u/topology/physical_package_id",
+		  cpu );
+	read_uint( path, pkg );
+
+	std::pair<unsigned, unsigned> key( pkg, core_id );
+	if( core_of.find( key ) == core_of.end() ) {
+	    size_t n = core_of.size();
+	    core_of[key] = n;
+	}
+
+	cpu_place c;
+	c.cpu = cpu;
+	c.core = core_of[key];
+	c.smt = 0;
+	c.package = pkg;
+	c.node = node_of.count( cpu ) ? node_of[cpu] : 0;
+	cpus.push_back( c );
+    }
+    return cpus;
+}
+#endif
+
+static bool by_cpu( const cpu_place & a, const cpu_place & b ) {
+    return a.cpu < b.cpu;
+}
+
+static bool by_core( const cpu_place & a, const cpu_place & b ) {
+    if( a.node != b.node )
+	return a.node < b.node;
+    if( a.package != b.package )
+	return a.package < b.package;
+    if( a.core != b.core )
+	return a.core < b.core;
+    return a.smt < b.smt;
+}
+
+static bool by_smt( const cpu_place & a, const cpu_place & b ) {
+    if( a.smt != b.smt )
+	return a.smt < b.smt;
+    return by_core( a, b );
+}
+
+std::vector<cpu_place>
+thread_placement( size_t nthreads, const cpu_set_t & allowed
+#ifdef HAVE_LIBHWLOC
+		  , hwloc_topology_t topology
+#endif
+    ) {
+    placement_policy_t policy = placement_policy();
+#ifdef HAVE_LIBHWLOC
+    std::vector<cpu_place> cpus = read_topology( allowed, topology );
+#else
+    std::vector<cpu_place> cpus = read_topology( allowed );
+#endif
+    if( cpus.empty() ) {
+	fprintf( stderr, "PLACEMENT: no CPUs in the initial affinity set\n" );
+	exit( 2 );
+    }
+
+    // Rank the hyperthreads of each core in CPU order
+    std::sort( cpus.begin(), cpus.end(), by_cpu );
+    std::map<unsigned, unsigned> num_smt;
+    for( size_t i=0; i < cpus.size(); ++i )
+	cpus[i].smt = num_smt[cpus[i].core]++;
+
+    std::vector<cpu_place> order;
+    switch( policy ) {
+    case pp_linear:
+	order = cpus;
+	break;
+    case pp_compact:
+	order = cpus;
+	std::stable_sort( order.begin(), order.end(), by_core );
+	break;
+    case pp_scatter:
+	order = cpus;
+	std::stable_sort( order.begin(), order.end(), by_smt );
+	break;
+    case pp_node:
+    {
+	// Scatter within each node, take nodes in turn
+	std::map<unsigned, std::vector<cpu_place> > per_node;
+	std::stable_sort( cpus.begin(), cpus.end(), by_smt );
+	for( size_t i=0; i < cpus.size(); ++i )
+	    per_node[cpus[i].node].push_back( cpus[i] );
+	for( size_t k=0; order.size() < cpus.size(); ++k ) {
+	    for( std::map<unsigned, std::vector<cpu_place> >::const_iterator
+		     I=per_node.begin(), E=per_node.end(); I != E; ++I )
+		if( k < I->second.size() )
+		    order.push_back( I->second[k] );
+	}
+	break;
+    }
+    }
+
+    std::vector<cpu_place> place( nthreads );
+    for( size_t i=0; i < nthreads; ++i )
+	place[i] = order[i % order.size()];
+
+    const char * pp = getenv( "PRINT_PLACEMENT" );
+    if( pp && atoi( pp ) > 0 ) {
+	fprintf( stderr, "Thread placement: %s, %lu CPUs\n",
+		 policy_name[policy], (unsigned long)cpus.size() );
+	for( size_t i=0; i < nthreads; ++i )
+	    fprintf( stderr, "\tworker %lu: cpu %u core %u smt %u "
+		     "package %u node %u\n", (unsigned long)i, place[i].cpu,
+		     place[i].core, place[i].smt, place[i].package,
+		     place[i].node );
+    }
+
+    return place;
+}
+
+#endif // !__APPLE__
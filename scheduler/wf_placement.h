@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2011 Hans Vandierendonck (hvandierendonck@acm.org)
+ * Copyright (C) 2011 George Tzenakis (tzenakis@ics.forth.gr)
+ * Copyright (C) 2011 Dimitrios S. Nikolopoulos (dsn@ics.forth.gr)
+ *
+ * This file is part of Swan.
+ *
+ * Swan is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Swan is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Swan.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// -*- c++ -*-
+/* wf_placement.h
+ * Placement of worker threads on logical CPUs. The topology (cores,
+ * packages and NUMA nodes of the CPUs in the initial affinity set) is
+ * obtained from hwloc when available and from /sys/devices/system
+ * otherwise. The policy is selected with the PLACEMENT environment
+ * variable:
+ *    linear  - CPUs in the order of the affinity set
+ *    compact - fill all hyperthreads of a core before the next core
+ *    scatter - one thread per physical core first, then the hyperthreads
+ *              (the default)
+ *    node    - spread threads round-robin over the NUMA nodes, scatter
+ *              within a node
+ * PRINT_PLACEMENT=1 prints the mapping at start-up.
+ */
+#ifndef WF_PLACEMENT_H
+#define WF_PLACEMENT_H
+
+#include "swan_config.h"
+
+#include <vector>
+
+#ifdef HAVE_LIBHWLOC
+#include <hwloc.h>
+#endif
+
+struct cpu_place {
+    unsigned cpu;     // OS index of the logical CPU
+    unsigned core;    // physical core, unique across packages
+    unsigned smt;     // rank of the CPU among the hyperthreads of its core
+    unsigned package;
+    unsigned node;    // NUMA node
+};
+
+#if !defined(__APPLE__)
+#include <sched.h>
+
+// Returns the CPU and NUMA node for each of nthreads workers. Wraps around
+// when there are more threads than CPUs in the allowed set.
+std::vector<cpu_place>
+thread_placement( size_t nthreads, const cpu_set_t & allowed
+#ifdef HAVE_LIBHWLOC
+		  , hwloc_topology_t topology
+#endif
+    );
+#endif
+
+#endif // WF_PLACEMENT_H
@@ -0,0 +1,564 @@
+/*
+ * Copyright (C) 2011 Hans Vandierendonck (hvandierendonck@acm.org)
+ * Copyright (C) 2011 George Tzenakis (tzenakis@ics.forth.gr)
+ * Copyright (C) 2011 Dimitrios S. Nikolopoulos (dsn@ics.forth.gr)
+ *
+ * This file is part of Swan.
+ *
+ * Swan is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Swan is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Swan.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// -*- c++ -*-
+/*
+ * Record-and-replay of task graphs.
+ *
+ * Iterative codes spawn the same task graph over the same objects in every
+ * iteration. A task_replay records the tasks spawned through it between
+ * begin_record() and end_record(). The tasks execute normally while they
+ * are recorded. At the same time, the dependences between them are
+ * computed from the object versions they access. replay() executes the
+ * recorded graph again without any per-argument dependency tracking and
+ * without spawning the tasks: each task has a precomputed count of
+ * predecessors and is placed on a ready list when its last predecessor
+ * completes. One worker task per thread executes tasks from the ready list.
+ *
+ * Renaming during the recording is preserved: every version of an object
+ * that is accessed in the region is kept alive by the task_replay and the
+ * versions are rotated over the replays such that the version that is
+ * current when replay() starts is read by the tasks that read the initial
+ * version in the recording, and the version written last becomes the
+ * current version of the object when replay() completes. A region that
+ * alternates between two arrays (e.g. A and its shadow copy) should be
+ * recorded over two iterations.
+ *
+ * Restrictions:
+ *  - Supported arguments are indep, outdep, inoutdep, cinoutdep (treated
+ *    as inoutdep), truedep (not tracked) and by-value arguments. Reductions
+ *    and queues are not supported.
+ *  - The objects must outlive the task_replay and the region must access
+ *    the same objects in every replay.
+ *  - An object may be renamed by tasks spawned outside the region between
+ *    replays. Its new current version is then held by the task_replay and
+ *    takes the place of one of the versions held since the recording.
+ *  - replay() waits for all tasks previously spawned by the calling
+ *    procedure to complete and returns when all replayed tasks completed.
+ *
+ * Usage:
+ *     task_replay graph;
+ *     graph.begin_record();
+ *     graph.spawn( func, args... ); // as many times as required
+ *     graph.end_record();
+ *     for( ... )
+ *         graph.replay();
+ */
+#ifndef WF_REPLAY_H
+#define WF_REPLAY_H
+
+#include "swan_config.h"
+
+#include <sched.h>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <tuple>
+#include <type_traits>
+
+#include "wf_interface.h"
+#include "object.h"
+
+class task_replay;
+
+namespace replay_detail {
+
+typedef obj::obj_version<obj::obj_metadata> version_t;
+typedef obj::obj_instance<obj::obj_metadata> instance_t;
+
+// Argument classification
+template<typename T>
+struct is_read : std::integral_constant<bool,
+					obj::is_indep<T>::value
+					|| obj::is_inoutdep<T>::value
+					|| obj::is_cinoutdep<T>::value> { };
+template<typename T>
+struct is_write : std::integral_constant<bool,
+					 obj::is_outdep<T>::value
+					 || obj::is_inoutdep<T>::value
+					 || obj::is_cinoutdep<T>::value> { };
+template<typename T>
+struct is_tracked : std::integral_constant<bool,
+					   is_read<T>::value
+					   || is_write<T>::value> { };
+template<typename T>
+struct is_supported : std::integral_constant<bool,
+					     !obj::is_reduction<T>::value
+					     && !obj::is_queue_dep<T>::value> { };
+
+// Index lists to unpack the recorded argument tuples
+template<size_t... I>
+struct indices { };
+
+template<size_t N, size_t... I>
+struct make_indices : make_indices<N-1, N-1, I...> { };
+
+template<size_t... I>
+struct make_indices<0, I...> {
+    typedef indices<I...> type;
+};
+
+// A slot is one version of an object encountered during recording. The
+// versions are held by the task_replay. The slots of an object are linked
+// in the order they were encountered.
+struct slot_info {
+    version_t * version;
+    long next;                       // next slot of the same object
+    long prev;                       // previous slot of the same object
+    // Only used during recording
+    long last_writer;
+    long readers;                    // list of readers since last_writer
+};
+
+struct object_info {
+    instance_t * obj;                // 0 for unversioned objects
+    long first_slot;
+    long last_slot;
+    long final_slot;                 // slot that is current after a replay
+};
+
+// The slot seen by one argument of a task. If the argument renamed an
+// inout object, the task sees a copy of slot from.
+struct access {
+    uint32_t slot;
+    int32_t from;
+};
+
+// A recorded task
+class node {
+public:
+    uint32_t succ_begin, succ_end;   // successors
+    uint32_t last_succ;              // to filter duplicate edges
+    uint32_t npred;                  // number of predecessors
+    volatile long count;             // remaining predecessors in replay
+    uint32_t nargs;                  // number of tracked arguments
+
+    node() : succ_begin( 0 ), succ_end( 0 ), last_succ( ~uint32_t(0) ),
+	     npred( 0 ), count( 0 ), nargs( 0 ) { }
+    virtual ~node() { }
+
+    virtual void execute( task_replay * g ) = 0;
+    virtual access * get_args() = 0;
+};
+
+template<typename... Tn>
+class node_impl : public node {
+    void (*func)( Tn... );
+    std::tuple<Tn...> targs;
+    access args[sizeof...(Tn)+1];
+
+public:
+    node_impl( void (*func_)( Tn... ), Tn... args_ )
+	: func( func_ ), targs( args_... ) { }
+
+    virtual void execute( task_replay * g ) {
+	execute( g, typename make_indices<sizeof...(Tn)>::type() );
+    }
+    virtual access * get_args() { return args; }
+
+private:
+    template<size_t... I>
+    inline void execute( task_replay * g, indices<I...> );
+};
+
+} // namespace replay_detail
+
+class task_replay {
+    typedef replay_detail::version_t version_t;
+    typedef replay_detail::instance_t instance_t;
+    typedef replay_detail::access access;
+    typedef replay_detail::slot_info slot_info;
+    typedef replay_detail::object_info object_info;
+    typedef replay_detail::node node;
+
+    std::vector<node *> nodes;
+    std::vector<uint32_t> roots;
+    std::vector<uint32_t> succ;      // successor lists of all tasks
+    std::vector<std::pair<uint32_t, uint32_t> > edges; // during recording
+    std::vector<std::pair<long, long> > reader_list; // (task, next)
+    std::vector<object_info> objects;
+    std::vector<slot_info> slots;
+    std::vector<version_t *> slot_map; // version of each slot in a replay
+    std::unordered_map<void *, uint32_t> object_idx;
+    bool recording;
+
+    // Ready list during replay. Every task is pushed at most once.
+    std::vector<long> ready_store;
+    volatile long * ready;
+    volatile size_t ready_head;
+    volatile size_t ready_tail;
+    volatile size_t num_done;
+
+    template<typename... Tn>
+    friend class replay_detail::node_impl;
+
+public:
+    task_replay() : recording( false ), ready( 0 ) { }
+    ~task_replay() { clear(); }
+
+    // Drop the recorded graph and release the object versions.
+    void clear() {
+	for( size_t i=0; i < nodes.size(); ++i )
+	    delete nodes[i];
+	for( size_t i=0; i < slots.size(); ++i )
+	    slots[i].version->del_ref();
+	nodes.clear();
+	roots.clear();
+	succ.clear();
+	edges.clear();
+	reader_list.clear();
+	objects.clear();
+	slots.clear();
+	slot_map.clear();
+	object_idx.clear();
+	ready_store.clear();
+	ready = 0;
+	recording = false;
+    }
+
+    bool is_recording() const { return recording; }
+    bool is_recorded() const { return !recording && !nodes.empty(); }
+    size_t num_tasks() const { return nodes.size(); }
+
+    void begin_record() {
+	clear();
+	recording = true;
+    }
+
+    void end_record();
+
+    // Spawn a task and record it when recording.
+    template<typename... Tn>
+    void spawn( void (*func)( Tn... ), Tn... args );
+
+    // Execute the recorded graph.
+    void replay();
+
+private:
+    template<typename... Tn>
+    void record( void (*func)( Tn... ), Tn... args ) __attribute__((noinline));
+
+    template<typename T>
+    typename std::enable_if<replay_detail::is_tracked<T>::value>::type
+    record_arg( uint32_t n, T & arg );
+    template<typename T>
+    typename std::enable_if<!replay_detail::is_tracked<T>::value>::type
+    record_arg( uint32_t n, T & arg ) { }
+
+    uint32_t find_object( instance_t * obj, version_t * v ) {
+	void * key = obj ? (void *)obj : (void *)v;
+	std::pair<std::unordered_map<void *, uint32_t>::iterator, bool> r
+	    = object_idx.insert( std::make_pair( key, objects.size() ) );
+	if( r.second ) {
+	    object_info oi = { obj, -1, -1, -1 };
+	    objects.push_back( oi );
+	}
+	return r.first->second;
+    }
+
+    long find_slot( object_info & oi, version_t * v ) {
+	// Most accesses are to the latest version: search backwards
+	for( long s=oi.last_slot; s >= 0; s=slots[s].prev )
+	    if( slots[s].version == v )
+		return s;
+	v->add_ref();
+	slot_info si = { v, -1, oi.last_slot, -1, -1 };
+	long s = slots.size();
+	slots.push_back( si );
+	if( oi.last_slot >= 0 )
+	    slots[oi.last_slot].next = s;
+	else
+	    oi.first_slot = s;
+	oi.last_slot = s;
+	return s;
+    }
+
+    void add_edge( uint32_t from, uint32_t to ) {
+	node * f = nodes[from];
+	// All edges to a task are added while recording that task.
+	if( from == to || f->last_succ == to )
+	    return;
+	f->last_succ = to;
+	f->succ_end++;
+	nodes[to]->npred++;
+	edges.push_back( std::make_pair( from, to ) );
+    }
+
+    void map_versions();
+    void commit_versions();
+
+    // Set the version of an argument to the version assigned to its slot,
+    // copying the data first if the argument renamed an inout object.
+    template<typename T>
+    typename std::enable_if<replay_detail::is_tracked<T>::value>::type
+    bind( T & arg, const access *& a ) {
+	version_t * v = slot_map[a->slot];
+	if( a->from >= 0 )
+	    slot_map[a->from]->copy_to( v );
+	arg.set_version( v );
+	++a;
+    }
+    template<typename T>
+    typename std::enable_if<!replay_detail::is_tracked<T>::value>::type
+    bind( T & arg, const access *& a ) { }
+
+    bool pop_ready( size_t & i );
+    void push_ready( size_t i );
+    static void work( task_replay * g );
+};
+
+template<typename... Tn>
+void task_replay::spawn( void (*func)( Tn... ), Tn... args ) {
+    static_assert( std::is_void<decltype(func( args... ))>::value,
+		   "only procedures can be recorded" );
+    ::spawn( func, args... );
+    // Executed by the continuation. Renamed versions are now visible.
+    if( recording )
+	record( func, args... );
+}
+
+template<typename... Tn>
+void task_replay::record( void (*func)( Tn... ), Tn... args ) {
+    uint32_t n = nodes.size();
+    nodes.push_back( new replay_detail::node_impl<Tn...>( func, args... ) );
+    int dummy[] = { 0, ( record_arg( n, args ), 0 )... };
+    (void)dummy;
+}
+
+template<typename T>
+typename std::enable_if<replay_detail::is_tracked<T>::value>::type
+task_replay::record_arg( uint32_t n, T & arg ) {
+    static_assert( replay_detail::is_supported<T>::value,
+		   "reductions and queues can not be recorded" );
+
+    // The version before the spawn is the one read by the task. For writes,
+    // the version after the spawn differs if the spawn renamed the object.
+    version_t * pre = arg.get_version();
+    instance_t * obj = pre->get_instance();
+    if( obj )
+	obj = obj->get_object();
+    version_t * post = obj ? obj->get_version() : pre;
+
+    uint32_t o = find_object( obj, pre );
+    node * nd = nodes[n];
+    access & a = nd->get_args()[nd->nargs++];
+    a.from = -1;
+
+    if( replay_detail::is_read<T>::value ) {
+	long s = find_slot( objects[o], pre );
+	if( slots[s].last_writer >= 0 )
+	    add_edge( slots[s].last_writer, n );
+	if( !replay_detail::is_write<T>::value ) {
+	    reader_list.push_back( std::make_pair( long(n), slots[s].readers ) );
+	    slots[s].readers = reader_list.size()-1;
+	    a.slot = s;
+	    return;
+	}
+	if( post != pre )
+	    a.from = s;
+    }
+
+    long s = find_slot( objects[o], post );
+    if( slots[s].last_writer >= 0 )
+	add_edge( slots[s].last_writer, n );
+    for( long r=slots[s].readers; r >= 0; r=reader_list[r].second )
+	add_edge( reader_list[r].first, n );
+    slots[s].readers = -1;
+    slots[s].last_writer = n;
+    a.slot = s;
+}
+
+inline void task_replay::end_record() {
+    recording = false;
+
+    // Successor lists in one array
+    uint32_t pos = 0;
+    for( size_t i=0; i < nodes.size(); ++i ) {
+	uint32_t num = nodes[i]->succ_end;
+	nodes[i]->succ_begin = nodes[i]->succ_end = pos;
+	pos += num;
+	if( nodes[i]->npred == 0 )
+	    roots.push_back( i );
+    }
+    succ.resize( pos );
+    for( size_t e=0; e < edges.size(); ++e )
+	succ[nodes[edges[e].first]->succ_end++] = edges[e].second;
+    std::vector<std::pair<uint32_t, uint32_t> >().swap( edges );
+    std::vector<std::pair<long, long> >().swap( reader_list );
+
+    // The version that is current at the end of the recording is the
+    // one that becomes current at the end of each replay.
+    for( size_t i=0; i < objects.size(); ++i ) {
+	object_info & oi = objects[i];
+	oi.final_slot = oi.last_slot;
+	if( oi.obj ) {
+	    for( long s=oi.first_slot; s >= 0; s=slots[s].next )
+		if( slots[s].version == oi.obj->get_version() )
+		    oi.final_slot = s;
+	}
+    }
+
+    slot_map.resize( slots.size() );
+    ready_store.resize( nodes.size() );
+    ready = ready_store.empty() ? 0 : &ready_store[0];
+}
+
+// Assign the versions to slots such that the first slot is the current
+// version of the object and all other slots are distinct held versions.
+inline void task_replay::map_versions() {
+    for( size_t i=0; i < objects.size(); ++i ) {
+	object_info & oi = objects[i];
+	if( !oi.obj ) {
+	    slot_map[oi.first_slot] = slots[oi.first_slot].version;
+	    continue;
+	}
+	version_t * cur = oi.obj->get_version();
+	// The object was renamed outside the region: the current version is
+	// not held. Hold it instead of the version that would be left over
+	// by the mapping below.
+	long c = oi.first_slot;
+	while( c >= 0 && slots[c].version != cur )
+	    c = slots[c].next;
+	if( c < 0 ) {
+	    cur->add_ref();
+	    slots[oi.last_slot].version->del_ref();
+	    slots[oi.last_slot].version = cur;
+	}
+	slot_map[oi.first_slot] = cur;
+	long d = slots[oi.first_slot].next;
+	for( long s=oi.first_slot; s >= 0 && d >= 0; s=slots[s].next ) {
+	    if( slots[s].version != cur ) {
+		slot_map[d] = slots[s].version;
+		d = slots[d].next;
+	    }
+	}
+    }
+}
+
+// Make the version written last the current version of the object.
+inline void task_replay::commit_versions() {
+    for( size_t i=0; i < objects.size(); ++i ) {
+	object_info & oi = objects[i];
+	if( !oi.obj )
+	    continue;
+	version_t * cur = oi.obj->get_version();
+	version_t * last = slot_map[oi.final_slot];
+	if( last != cur ) {
+	    last->add_ref();
+	    oi.obj->set_version( last );
+	    cur->del_ref();
+	}
+    }
+}
+
+inline void task_replay::replay() {
+    assert( !recording && "replay() called while recording" );
+    // Quiesce the objects: all their previous tasks must be complete.
+    ssync();
+    map_versions();
+    size_t n = nodes.size();
+    for( size_t i=0; i < n; ++i ) {
+	nodes[i]->count = nodes[i]->npred;
+	ready[i] = -1;
+    }
+    for( size_t i=0; i < roots.size(); ++i )
+	ready[i] = roots[i];
+    ready_head = 0;
+    ready_tail = roots.size();
+    num_done = 0;
+
+    // One worker task per thread pulls tasks from the ready list. Start
+    // all of them even if there are few roots: the roots release their
+    // successors onto the ready list as they complete.
+    if( n > 0 ) {
+	for( size_t w=1; w < ::nthreads; ++w )
+	    ::spawn( &task_replay::work, this );
+	work( this );
+    }
+    ssync();
+    commit_versions();
+}
+
+// Take a task from the ready list. Returns false when all tasks are done.
+inline bool task_replay::pop_ready( size_t & i ) {
+    size_t n = nodes.size();
+    while( num_done < n ) {
+	size_t h = ready_head;
+	if( h < ready_tail ) {
+	    long r = ready[h];
+	    // The slot may have been claimed but not yet been written.
+	    if( r >= 0 && __sync_bool_compare_and_swap( &ready_head, h, h+1 ) ) {
+		i = r;
+		return true;
+	    }
+	}
+	sched_yield();
+    }
+    return false;
+}
+
+inline void task_replay::push_ready( size_t i ) {
+    size_t t = __sync_fetch_and_add( &ready_tail, 1 );
+    ready[t] = i;
+}
+
+// Execute tasks as they become ready. Of the successors that become ready,
+// one is executed by the same worker, the others go to the ready list.
+inline void task_replay::work( task_replay * g ) {
+    size_t i;
+    while( g->pop_ready( i ) ) {
+	while( true ) {
+	    node * nd = g->nodes[i];
+	    nd->execute( g );
+	    size_t next = ~(size_t)0;
+	    for( uint32_t j=nd->succ_begin; j < nd->succ_end; ++j ) {
+		size_t s = g->succ[j];
+		if( __sync_fetch_and_add( &g->nodes[s]->count, -1 ) == 1 ) {
+		    if( next != ~(size_t)0 )
+			g->push_ready( next );
+		    next = s;
+		}
+	    }
+	    __sync_fetch_and_add( &g->num_done, 1 );
+	    if( next == ~(size_t)0 )
+		break;
+	    i = next;
+	}
+    }
+}
+
+namespace replay_detail {
+
+template<typename... Tn>
+template<size_t... I>
+void node_impl<Tn...>::execute( task_replay * g, indices<I...> ) {
+    std::tuple<Tn...> a( targs );
+    const access * ap = args;
+    int dummy[] = { 0, ( g->bind( std::get<I>( a ), ap ), 0 )... };
+    (void)dummy;
+    (*func)( std::get<I>( a )... );
+}
+
+} // namespace replay_detail
+
+#endif // WF_REPLAY_H
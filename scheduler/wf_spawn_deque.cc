@@ -65,18 +65,12 @@ spawn_deque::steal_rchild( full_frame * fr, steal_method_t sm ) {
     if( pending_frame * rchild = the_task_graph_traits::get_ready_task( fr ) ) {
 	LOG( id_steal_right_child, rchild );
 	SD_PROFILE( rsib_steals_success );
-#if !PACT11_VERSION && 0
-	fr->rchild_steal_attempt( true, sm );
-#endif
 #if TIME_STEALING
 	pp_time_end( &time_rchild_steal );
 #endif
 	return rchild;
     }
 
-#if !PACT11_VERSION && 0
-    fr->rchild_steal_attempt( false, sm );
-#endif
 #if TIME_STEALING
     pp_time_end( &time_rchild_steal_fail );
 #endif
@@ -99,7 +93,7 @@ spawn_deque::wakeup_steal( full_frame * parent, pending_frame * fr ) {
 
 bool
 spawn_deque_store::detach( stack_frame * s, stack_frame * t,
-			   spawn_deque * tgt ) {
+			   spawn_deque * tgt, bool lazy ) {
     if( t->is_full() ) {
 	t->get_full()->lock( tgt );
 	assert( t->get_owner() == s->get_owner() );
@@ -110,10 +104,10 @@ spawn_deque_store::detach( stack_frame * s, stack_frame * t,
     }
 
     bool need_unlock
-	= detach( s, t->get_parent(), tgt );
+	= detach( s, t->get_parent(), tgt, lazy );
 
     assert( t->get_owner() == s->get_owner() );
-    t->convert_to_full(); // ->lock( tgt ); // TODO: create full_frame in locked state!
+    t->convert_to_full( lazy ); // ->lock( tgt ); // TODO: create full_frame in locked state!
     t->set_state( fs_suspended );
     t->set_owner( 0 );
 
@@ -149,8 +143,8 @@ spawn_deque_store::pop_front( spawn_deque * tgt,
     *new_top = &deque[my_head+1].tail;
     full_frame * sf;
     if( !s->is_full() ) {
-	bool need_unlock = detach( s, s->get_parent(), tgt );
-	sf = s->convert_to_full();
+	bool need_unlock = detach( s, s->get_parent(), tgt, true );
+	sf = s->convert_to_full( true );
 	sf->lock( tgt );
 	if( need_unlock )
 	    sf->get_parent()->unlock( tgt );
@@ -193,6 +187,7 @@ spawn_deque::spawn_deque() :
     INIT(rsib_steals)
     INIT(rsib_steals_success)
     INIT(cvt_pending)
+    INIT(spawn_inline)
 #undef INIT
 #endif
 {
@@ -204,6 +199,7 @@ spawn_deque::spawn_deque() :
     memset( &try_pop_lock_time, 0, sizeof(pp_time_t) );
     memset( &time_rchild_steal, 0, sizeof(time_rchild_steal) );
     memset( &time_rchild_steal_fail, 0, sizeof(time_rchild_steal) );
+    memset( &hist_steal_lock_hold, 0, sizeof(hist_steal_lock_hold) );
 #endif
 }
 
@@ -222,6 +218,7 @@ spawn_deque::~spawn_deque() {
     SHOW( time_rchild_steal );
     SHOW( time_rchild_steal_fail );
 #undef SHOW
+    pp_hist_print( &hist_steal_lock_hold, "steal lock hold" );
 #endif
 }
 
@@ -241,6 +238,7 @@ spawn_deque::dump_profile() const {
     DUMP(rsib_steals);
     DUMP(rsib_steals_success);
     DUMP(cvt_pending);
+    DUMP(spawn_inline);
 #undef DUMP
     std::cerr << '\n';
 }
@@ -261,9 +259,22 @@ spawn_deque::steal_stack( spawn_deque * tgt, steal_method_t sm ) {
 #endif
     if( !deque.try_lock( &tgt->steal_node ) )
 	return 0;
+    // Another thief is still completing a steal (see below)
+    if( deque.is_converting() ) {
+	deque.unlock( &tgt->steal_node );
+	return 0;
+    }
 #if TIME_STEALING
     pp_time_end( &tgt->steal_acquire_time ); // Measures locked time
     pp_time_start( &tgt->steal_time_pop ); // Measures locked time
+    pp_hist_start( &tgt->hist_steal_lock_hold );
+#define STEAL_UNLOCK()					\
+    do {						\
+	deque.unlock( &tgt->steal_node );		\
+	pp_hist_end( &tgt->hist_steal_lock_hold );	\
+    } while( 0 )
+#else
+#define STEAL_UNLOCK() deque.unlock( &tgt->steal_node )
 #endif
 
     // Victim may repeatedly push and pop but the tail cannot change!
@@ -293,15 +304,26 @@ spawn_deque::steal_stack( spawn_deque * tgt, steal_method_t sm ) {
 	// allocated stack_frames and that the victim will block in lock()
 	// as soon as he tries to pop from an empty deque. When that happens,
 	// current.tail holds the stack we are looking for...
+	// If the victim is slow to get there, e.g., because it is descheduled,
+	// wait for it without holding the lock: mark the steal as in progress,
+	// which stops other thieves and makes the victim's lock_self() wait.
+	// Holding the lock on ff keeps the victim from deleting new_top.
+	const unsigned max_locked_spins = 64;
+	unsigned spins = 0;
 	stack_frame * new_top;
 	while( true ) {
 	    new_top = deque.empty() ? current.tail : *new_top_loc;
 	    if( new_top->get_parent() == ff->get_frame() )
 		break;
+	    if( ++spins == max_locked_spins ) {
+		deque.set_converting( true );
+		STEAL_UNLOCK();
+	    } else if( spins > max_locked_spins )
+		sched_yield();
 	}
 	LOG( id_new_top_sd, new_top );
 	assert( new_top && "New top of spawn deque must be non-null" );
-	new_top->convert_to_full();
+	new_top->convert_to_full( true );
 	top_parent = ff;
 	top_parent_maybe_suspended
 	    = top_parent->get_frame()->get_state() == fs_suspended;
@@ -318,7 +340,10 @@ spawn_deque::steal_stack( spawn_deque * tgt, steal_method_t sm ) {
 	ff->unlock( tgt );
 
 	// Unlock deque
-	deque.unlock( &tgt->steal_node );
+	if( spins < max_locked_spins )
+	    STEAL_UNLOCK();
+	else
+	    deque.set_converting( false );
     } else if( top_parent ) {
 #if TIME_STEALING
 	pp_time_start( &tgt->steal_time_sibling ); // Measures locked time
@@ -336,7 +361,7 @@ spawn_deque::steal_stack( spawn_deque * tgt, steal_method_t sm ) {
 	    // business with the victim spawn deque.
 	    full_frame * tg_victim = top_parent;
 	    tg_victim->lock( tgt );
-	    deque.unlock( &tgt->steal_node );
+	    STEAL_UNLOCK();
 
 	    if( pending_frame * qf = tgt->steal_rchild( tg_victim, sm ) ) {
 		tgt->wakeup_steal( tg_victim, qf );
@@ -347,12 +372,12 @@ spawn_deque::steal_stack( spawn_deque * tgt, steal_method_t sm ) {
 
 	    tg_victim->unlock( tgt );
 	} else
-	    deque.unlock( &tgt->steal_node );
+	    STEAL_UNLOCK();
 #if TIME_STEALING
 	pp_time_end( &tgt->steal_time_sibling ); // Measures locked time
 #endif
     } else
-	deque.unlock( &tgt->steal_node );
+	STEAL_UNLOCK();
 
     if( !ff ) {
 	SD_PROFILE_ON(tgt, steal_fail);
@@ -364,6 +389,8 @@ spawn_deque::steal_stack( spawn_deque * tgt, steal_method_t sm ) {
     return ff;
 }
 
+#undef STEAL_UNLOCK
+
 void
 spawn_deque::dump() const {
     //iolock();
@@ -26,6 +26,7 @@
 #include "swan_config.h"
 
 #include <cassert>
+#include <sched.h>
 
 #include "wf_stack_frame.h"
 #include "logger.h"
@@ -62,10 +63,14 @@ class spawn_deque_store {
     intptr_t pad1[7];
     sds_mutex __cache_aligned L;
     sds_mutex::node __cache_aligned L_self;
+    // A thief completes the steal without holding the lock
+    volatile bool converting;
 
 public:
     spawn_deque_store()
-	: deque( 0 ), alloc( 0 ), tail( 0 ), head( 0 ) { grow(); }
+	: deque( 0 ), alloc( 0 ), tail( 0 ), head( 0 ), converting( false ) {
+	grow();
+    }
     ~spawn_deque_store() {
 	if( deque )
 	    free( (void *)deque );
@@ -101,12 +106,14 @@ public:
     }
 
     static bool detach( stack_frame * s, stack_frame * t,
-			spawn_deque * tgt );
+			spawn_deque * tgt, bool lazy = false );
 
     full_frame * pop_front( spawn_deque * tgt, stack_frame *** new_top ); // steal
     stack_frame * front() const { return head < tail ? deque[head].head : 0; }
 
     bool empty() const volatile { return tail <= head; }
+    // Number of stealable call stacks, not synchronized with thieves
+    size_t size() const volatile { return tail > head ? tail - head : 0; }
 
     void reset() {
 	// lock_self();
@@ -124,9 +131,21 @@ public:
     bool try_lock( sds_mutex::node * n ) { return L.try_lock( n ); }
     void unlock( sds_mutex::node * n ) { L.unlock( n ); }
 
-    void lock_self() { L.lock( &L_self ); }
+    // Also wait for a steal that the thief completes after releasing the
+    // lock (spawn_deque::steal_stack()).
+    void lock_self() {
+	L.lock( &L_self );
+	while( converting )
+	    sched_yield();
+    }
     void unlock_self() { L.unlock( &L_self ); }
 
+    bool is_converting() const volatile { return converting; }
+    void set_converting( bool c ) {
+	__sync_synchronize();
+	converting = c;
+    }
+
 private:
     void grow() {
 	// Growing memory needs a lock because it may move the array to
@@ -159,6 +178,9 @@ class spawn_deque {
     full_frame * top_parent;
     full_frame * popped;
     bool top_parent_maybe_suspended;
+#if SPAWN_CUTOFF
+    slack_creator<slack_weights> slack;
+#endif
 
 #if PROFILE_SPAWN_DEQUE
     size_t num_pop_call_nfull;
@@ -172,6 +194,7 @@ class spawn_deque {
     size_t num_rsib_steals;
     size_t num_rsib_steals_success;
     size_t num_cvt_pending;
+    size_t num_spawn_inline;
 
     void dump_profile() const;
 
@@ -190,6 +213,7 @@ class spawn_deque {
     pp_time_t try_pop_lock_time;
     pp_time_t time_rchild_steal;
     pp_time_t time_rchild_steal_fail;
+    pp_hist_t hist_steal_lock_hold; // victim deque lock held by us
 #endif
 
 public:
@@ -240,6 +264,20 @@ public:
 	push( full );
     }
 
+#if SPAWN_CUTOFF
+    // Execute a spawn without dependences as a call? Owner only.
+    bool spawn_inline() {
+	if( slack.invoke_inline( deque.size() )
+	    && stack_frame::has_stack_room() ) {
+	    SD_PROFILE(spawn_inline);
+	    return true;
+	}
+	return false;
+    }
+    // A thief found nothing to steal here
+    void steal_failed() { slack.steal_attempt( false ); }
+#endif
+
     // Debugging
     size_t get_head() const { return deque.get_head(); }
 
@@ -31,11 +31,6 @@
 #include "mangled.h"
 #include "logger.h"
 
-#if 0
-const size_t slack_weights::success[sm_N] = { 0, 0, -1, -1 };
-const size_t slack_weights::fail[sm_N]    = { 2, 0,  1,  0 };
-#endif
-
 std::ostream & operator << ( std::ostream & os, empty_deque_condition_t edc ) {
     switch( edc ) {
     case edc_bootstrap: return os << "edc_bootstrap";
@@ -128,6 +123,9 @@ stack_frame::create_frame( stack_frame * parent, spawn_deque * owner,
     LOG( id_create_frame, pnd );
     LOG( id_create_frame, fr );
 
+#if OBJECT_THROTTLE
+    obj::throttle.del_pending();
+#endif
     delete pnd;
 
     return fr;
@@ -180,3 +178,15 @@ stack_frame::verify_rec() const {
     }
 }
 #endif // DBG_VERIFY
+
+volatile size_t wf_num_deferred = 0;
+
+// Also called outside tasks, e.g., on a hyperqueue in main()
+void wf_issue_deferred_current() {
+    worker_state * ws = worker_state::tls();
+    if( !ws )
+	return;
+    if( stack_frame * fr = ws->get_deque()->youngest() )
+	if( full_frame * ff = fr->get_full() )
+	    wf_issue_deferred( ff );
+}
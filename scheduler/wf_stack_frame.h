@@ -91,67 +91,55 @@ struct inherited_size
 };
 
 //----------------------------------------------------------------------
-// slack_creator: a mechanism to create more slack (more ready tasks) in
-// a task graph.
+// slack_creator: an adaptive task-creation cutoff (SPAWN_CUTOFF). Spawns of
+// tasks without dependences are executed as plain function calls while the
+// owner's spawn deque holds at least 'depth' stealable call stacks, so
+// thieves still find the oldest (largest) work. Thieves that find nothing
+// to steal raise the victim's depth multiplicatively. A long run of inlined
+// spawns without such signals lowers it again by one.
 //----------------------------------------------------------------------
-#if 0
 struct slack_weights {
-    // release, sync, focussed, random
-    static const size_t success[sm_N]; // typically <= 0
-    static const size_t fail[sm_N];    // typically >= 0
-    static const size_t min = 0;
+    static const size_t min = 1;      // least stealable call stacks kept
     static const size_t max = 256;
+    static const size_t decay = 1024; // inlined spawns per decrement of depth
 };
 
 template<typename Weights>
 class slack_creator {
     typedef Weights weights;
 
-    size_t counter;
-    size_t togo;
+    size_t depth;           // owner only
+    size_t togo;            // owner only
+    volatile bool starving; // set by thieves
 
 public:
-    slack_creator() : counter( 0 ), togo( 0 ) { }
+    slack_creator()
+	: depth( weights::min ), togo( weights::decay ), starving( false ) { }
 
-    void rchild_steal_attempt( bool success, steal_method_t sm ) {
-#if 0
-	if( success ) {
-	    counter += weights::success[int(sm)];
-	    if( counter < weights::min )
-		counter = weights::min;
-	    // --togo;
-	} else {
-	    counter += weights::fail[int(sm)];
-	    if( counter > weights::max )
-		counter = weights::max;
-	    togo = counter;
-	}
-#endif
+    // Called by thieves on their victim
+    void steal_attempt( bool success ) {
+	if( !success && !starving )
+	    starving = true;
     }
 
-    // Invoke if togo has dropped to zero (or below)
-    bool invoke( bool ready ) {
-#if 0
-	if( ready && togo <= 0 ) {
-	    togo = counter;
-	    return true;
-	} else {
-	    --togo;
+    // Called by the owner: should a spawn be executed as a call?
+    bool invoke_inline( size_t stealable ) {
+	if( unlikely( starving ) ) {
+	    starving = false;
+	    depth = 2*depth < weights::max ? 2*depth : weights::max;
+	    togo = weights::decay;
 	    return false;
 	}
-#else
-	// return ready;
-	if( ready && togo <= 0 ) {
-	    togo += 30;
-	    return true;
-	} else {
-	    --togo;
+	if( stealable < depth )
 	    return false;
+	if( --togo == 0 ) {
+	    togo = weights::decay;
+	    if( depth > weights::min )
+		--depth;
 	}
-#endif
+	return true;
     }
 };
-#endif
 
 //----------------------------------------------------------------------
 // pending_frame: a function pointer + arguments + return value location
@@ -297,19 +285,23 @@ private:
 
     volatile size_t num_children;
 
-    // void * pad0[1];
+    // Child converted to a full frame on a steal whose arguments are not
+    // yet issued in our task graph (LAZY_FULL_FRAME), or deferred_busy
+    // while they are being issued.
+    stack_frame * volatile deferred;
+
+    // Suspended by a spawn over the pending budget rather than by a sync
+    // (OBJECT_THROTTLE): resumes without waiting for all children.
+    volatile bool throttled;
 
     // New cache line
     sf_mutex vlock;
 
-#if 0
-    slack_creator<slack_weights> slack;
-#endif
-
 private:
     // full_frame() { }
     full_frame( stack_frame * fr_, full_frame * parent_ )
-	: fr( fr_ ), parent( parent_ ), num_children( 0 ) {
+	: fr( fr_ ), parent( parent_ ), num_children( 0 ), deferred( 0 ),
+	  throttled( false ) {
     }
     friend class stack_frame;
     friend class stack_frame_base;
@@ -325,12 +317,14 @@ public:
     inline void remove_child() { __sync_fetch_and_add( &num_children, -1 ); }
     bool all_children_done() const volatile { return num_children == 0; }
 
-#if 0
-    void rchild_steal_attempt( bool success, steal_method_t sm ) {
-	slack.rchild_steal_attempt( success, sm );
-    }
-    bool slack_invoke( bool ready ) { return slack.invoke( ready ); }
-#endif
+    void set_throttled( bool t ) { throttled = t; }
+    bool is_throttled() const { return throttled; }
+
+    // Lazy issue of the arguments of a child promoted to full frame
+    static stack_frame * deferred_busy() { return (stack_frame *)1; }
+    inline void defer_issue( stack_frame * child );
+    inline void issue_deferred( stack_frame * only = 0 );
+    inline void settle_deferred( stack_frame * child );
 
     // Mutex
     void lock( const spawn_deque * by ) { vlock.lock( by ); }
@@ -642,10 +636,16 @@ public:
     static inline stack_frame * my_stack_frame();
     static inline stack_frame * stack_frame_of(intptr_t ptr);
 
+    // Does the stack of the current frame have room for a task body that
+    // is executed as a call rather than on a frame of its own? Such a task
+    // may use at most SPAWN_CUTOFF_STACK bytes of stack, including the
+    // tasks it executes as calls in turn.
+    static inline bool has_stack_room();
+
     inline void * operator new ( size_t size );
     inline void operator delete( void * p );
     
-    inline full_frame * convert_to_full();
+    inline full_frame * convert_to_full( bool lazy = false );
 
     // Top of duplicated stack on the child stack_frame. Size determined
     // by number of arguments to split_stub().
@@ -678,6 +678,28 @@ public:
 		    Tn... args )
 	__attribute__((always_inline, returns_twice));
 
+    // Create a pending frame without handing it to the task graph
+    // (see spawn_on())
+    template<typename TR, typename... Tn>
+    static inline pending_frame *
+    make_pending( TR (*func)( Tn... ), stack_frame * fr, future * fut,
+#if STORED_ANNOTATIONS
+		  task_data_t & task_data_p,
+#endif
+		  Tn... args )
+	__attribute__((always_inline, returns_twice));
+
+    // Create a pending frame with a scheduling priority (see spawn_prio())
+    template<typename TR, typename... Tn>
+    static inline pending_frame *
+    create_pending( unsigned prio, TR (*func)( Tn... ), stack_frame * fr,
+		    future * fut,
+#if STORED_ANNOTATIONS
+		    task_data_t & task_data_p,
+#endif
+		    Tn... args )
+	__attribute__((always_inline, returns_twice));
+
     template<typename TR, typename... Tn>
     static inline void
     invoke( future * c,
@@ -784,6 +806,14 @@ stack_frame::stack_frame_of( intptr_t ptr ) {
     return reinterpret_cast<stack_frame *>( ptr & ~(intptr_t)(Align-1) );
 }
 
+// Require SPAWN_CUTOFF_STACK bytes of the data area to be unused
+bool
+stack_frame::has_stack_room() {
+    intptr_t sp = get_sp();
+    return sp - intptr_t(&stack_frame_of( sp )->mem[0])
+	> intptr_t(SPAWN_CUTOFF_STACK);
+}
+
 
 stack_frame::~stack_frame() {
     // We must have a lock on the parent when deleting the child.
@@ -817,12 +847,74 @@ void stack_frame_base::flag_result() {
     }
 }
 
-full_frame * stack_frame::convert_to_full() {
+full_frame * stack_frame::convert_to_full( bool lazy ) {
     full_frame * full = stack_frame_base::convert_to_full( full_frame_storage );
+#if LAZY_FULL_FRAME
+    if( lazy ) {
+	full_frame * pf = full->get_parent();
+	if( !the_task_graph_traits::has_queue_deps( this ) ) {
+	    the_task_graph_traits::convert_to_full_lazy( this, full );
+	    pf->defer_issue( this );
+	    return full;
+	}
+	// Issuing the arguments creates the queue views that pushes and pops
+	// by this frame and its parent rely on. Issue now, in program order
+	// after the deferred arguments of the parent and older siblings.
+	if( full_frame * gf = pf->get_parent() )
+	    gf->issue_deferred( pf->get_frame() );
+	pf->issue_deferred();
+    }
+#endif
     the_task_graph_traits::convert_to_full( this, full );
     return full;
 }
 
+// The parent of a frame promoted on a steal is not executing, so only the
+// child's owner (settle_deferred() or issue_deferred()) may race with us.
+// Keep at most one deferred child, issuing in program order.
+void full_frame::defer_issue( stack_frame * child ) {
+    if( deferred )
+	issue_deferred();
+    __sync_fetch_and_add( &wf_num_deferred, 1 );
+    deferred = child;
+}
+
+// Issue the arguments of the deferred child (of child 'only' if non-null)
+// before spawning a child with dependences or syncing. Waits for a
+// concurrent issue by the owner of the parent or child to complete.
+void full_frame::issue_deferred( stack_frame * only ) {
+    stack_frame * const busy = deferred_busy();
+    while( true ) {
+	stack_frame * c = deferred;
+	if( likely( c == 0 ) || ( only && c != only && c != busy ) )
+	    return;
+	if( c != busy && __sync_bool_compare_and_swap( &deferred, c, busy ) ) {
+	    the_task_graph_traits::issue_deferred( c );
+	    __sync_synchronize();
+	    deferred = 0;
+	    __sync_fetch_and_add( &wf_num_deferred, -1 );
+	    return;
+	}
+    }
+}
+
+// On completion of a full frame: if its arguments were never issued,
+// nothing needs to be issued any more. Else wait until issue completes.
+void full_frame::settle_deferred( stack_frame * child ) {
+    stack_frame * const busy = deferred_busy();
+    while( true ) {
+	stack_frame * c = deferred;
+	if( c == busy )
+	    continue;
+	if( c != child )
+	    return;
+	if( __sync_bool_compare_and_swap( &deferred, child, (stack_frame *)0 ) ) {
+	    __sync_fetch_and_add( &wf_num_deferred, -1 );
+	    return;
+	}
+    }
+}
+
 template<>
 struct stack_frame_traits<full_frame> {
     typedef full_frame frame_ty;
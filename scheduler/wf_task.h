@@ -51,6 +51,13 @@ public:
 	finished = true;
     }
 
+    template<typename TR>
+    void set_value( const TR & r ) {
+	result = r;
+	// Store-store barrier
+	finished = true;
+    }
+
     void flag_result() {
 	// Store-store barrier
 	finished = true;
@@ -303,4 +310,16 @@ void reduce_pair_task( AccumTy accum, InTy in ) {
 template<typename Monad, typename AccumTy, typename ReductionTy>
 void create_parallel_reduction_task( AccumTy accum, ReductionTy * reduc );
 
+// Chunked reductions: combine chunks [from,to) of all private versions into
+// the version underlying accum. Accum is held by the spawning task.
+template<typename Monad, typename ReductionTy, typename VersionTy>
+void reduce_chunks_task( ReductionTy * reduc, VersionTy * tgt,
+			 size_t from, size_t to ) {
+    reduc->template reduce_chunks<Monad>( tgt, from, to );
+}
+
+template<typename Monad, typename AccumTy, typename ReductionTy>
+void create_parallel_chunked_reduction_task( AccumTy accum,
+					     ReductionTy * reduc );
+
 #endif // WF_TASK_H
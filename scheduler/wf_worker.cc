@@ -45,6 +45,50 @@
 
 extern worker_state * ws;
 
+#if FAST_CONTEXT_SWITCH
+#if defined(__APPLE__)
+#define CTX_SYMBOL(s) "_" #s
+#define CTX_TYPE(s)
+#else
+#define CTX_SYMBOL(s) #s
+#define CTX_TYPE(s) "\t.type " #s ",@function\n" \
+                    "\t.size " #s ",.-" #s "\n"
+#endif
+// See platform_x86_64.h. The offsets match ctx_buf_t.
+__asm__( "\t.text\n"
+	 "\t.globl " CTX_SYMBOL(swan_ctx_save) "\n"
+	 "\t.p2align 4\n"
+	 CTX_SYMBOL(swan_ctx_save) ":\n"
+	 "\tmovq %rbx, 0(%rdi)\n"
+	 "\tmovq %rbp, 8(%rdi)\n"
+	 "\tmovq %r12, 16(%rdi)\n"
+	 "\tmovq %r13, 24(%rdi)\n"
+	 "\tmovq %r14, 32(%rdi)\n"
+	 "\tmovq %r15, 40(%rdi)\n"
+	 "\tleaq 8(%rsp), %rdx # stack pointer of the caller\n"
+	 "\tmovq %rdx, 48(%rdi)\n"
+	 "\tmovq (%rsp), %rdx # return address\n"
+	 "\tmovq %rdx, 56(%rdi)\n"
+	 "\txorl %eax, %eax\n"
+	 "\tret\n"
+	 CTX_TYPE(swan_ctx_save)
+	 "\t.globl " CTX_SYMBOL(swan_ctx_restore) "\n"
+	 "\t.p2align 4\n"
+	 CTX_SYMBOL(swan_ctx_restore) ":\n"
+	 "\tmovl %esi, %eax\n"
+	 "\tmovq 0(%rdi), %rbx\n"
+	 "\tmovq 8(%rdi), %rbp\n"
+	 "\tmovq 16(%rdi), %r12\n"
+	 "\tmovq 24(%rdi), %r13\n"
+	 "\tmovq 32(%rdi), %r14\n"
+	 "\tmovq 40(%rdi), %r15\n"
+	 "\tmovq 48(%rdi), %rsp\n"
+	 "\tjmp *56(%rdi)\n"
+	 CTX_TYPE(swan_ctx_restore) );
+#undef CTX_SYMBOL
+#undef CTX_TYPE
+#endif
+
 #if PROFILE_WORKER
 namespace obj {
 __thread size_t num_tkt_evals;
@@ -83,6 +127,8 @@ worker_state::profile_worker::profile_worker() :
     INIT(provgd_steals_fr),
     INIT(random_steals),
     INIT(focussed_steals),
+    INIT(mailbox_steals),
+    INIT(mailbox_overdue_steals),
     INIT(tkt_evals_release_ready),
     INIT(tkt_evals_release_ready_fail),
     INIT(h0_hits),
@@ -123,6 +169,8 @@ worker_state::profile_worker::summarize( const worker_state::profile_worker & w
     SUM(provgd_steals_fr);
     SUM(random_steals);
     SUM(focussed_steals);
+    SUM(mailbox_steals);
+    SUM(mailbox_overdue_steals);
     SUM(tkt_evals_release_ready);
     SUM(tkt_evals_release_ready_fail);
     SUM(h0_hits);
@@ -184,6 +232,8 @@ worker_state::profile_worker::dump_profile( size_t id ) const {
     DUMP(provgd_steals_fr);
     DUMP(random_steals);
     DUMP(focussed_steals);
+    DUMP(mailbox_steals);
+    DUMP(mailbox_overdue_steals);
     DUMP(tkt_evals_release_ready);
     DUMP(tkt_evals_release_ready_fail);
     DUMP(h0_hits);
@@ -211,18 +261,11 @@ worker_state::profile_worker::dump_profile( size_t id ) const {
 #endif
 
 void worker_state::initialize( size_t id_, size_t nthreads_,
-#ifdef HAVE_LIBHWLOC
-			       hwloc_topology_t topology_,
-#endif
-			       size_t cpu_, size_t mem_,
 			       future * cresult_ ) {
     id = id_;
     nthreads = nthreads_;
-#ifdef HAVE_LIBHWLOC
-    topology = topology_;
-#endif
-    my_cpu = cpu_;
-    my_mem = mem_;
+    my_cpu = id_;
+    my_mem = 0;
 
     if( id == 0 ) {
 	dummy = (new stack_frame())->get_full();
@@ -231,6 +274,18 @@ void worker_state::initialize( size_t id_, size_t nthreads_,
 	cresult = cresult_;
 }
 
+void worker_state::place(
+#ifdef HAVE_LIBHWLOC
+    hwloc_topology_t topology_,
+#endif
+    size_t cpu_, size_t mem_ ) {
+#ifdef HAVE_LIBHWLOC
+    topology = topology_;
+#endif
+    my_cpu = cpu_;
+    my_mem = mem_;
+}
+
 void
 worker_state::cpubind() const {
 #if !defined( __APPLE__ )
@@ -261,7 +316,7 @@ worker_state::cpubind() const {
     CPU_SET(my_cpu, &set);
     if( sched_setaffinity( 0, sizeof(set), &set ) < 0 ) {
 	std::cerr << "sched_setaffinity for thread id=" << id
-		  << " on cpu=" << id << " fails due to: "
+		  << " on cpu=" << my_cpu << " fails due to: "
 		  << strerror( errno ) << "\n";
     }
 #endif
@@ -285,7 +340,11 @@ worker_state::longjmp( int retval ) {
 #if PROFILE_WORKER
     pp_time_start( &tls_worker_state->wprofile.time_longjmp );
 #endif
+#if FAST_CONTEXT_SWITCH
+    swan_ctx_restore( &tls_worker_state->jb_ret, retval );
+#else
     ::longjmp( tls_worker_state->jb_ret, retval );
+#endif
 }
 
 /* @brief
@@ -298,6 +357,11 @@ void
 worker_state::random_steal() {
     assert( sd.empty() && "Stack must be empty for random stealing" );
 
+#if SPAWN_AFFINITY
+    if( mailbox_steal() )
+	return;
+#endif
+
     // if( backoff.maybe_delay() ) {
 	// PROFILE(steal_delay);
     // }
@@ -314,8 +378,13 @@ worker_state::random_steal() {
     // TODO: the stealable attribute does not take into
     // account if there are ready data-flow siblings of
     // the spawn deque top.
-    if( victim == id || !ws[victim].sd.stealable() ) {
+    if( victim == id )
+	return;
+    if( !ws[victim].sd.stealable() ) {
 	// backoff.update( false );
+#if SPAWN_CUTOFF
+	ws[victim].sd.steal_failed();
+#endif
 	return;
     }
     LOG( id_steal_stack, ws[victim].sd.get_head()*nthreads+victim );
@@ -324,8 +393,58 @@ worker_state::random_steal() {
 	PROFILE(random_steals);
 	LOG( id_random_steal, ff );
     }
+#if SPAWN_CUTOFF
+    else
+	ws[victim].sd.steal_failed();
+#endif
 }
 
+#if SPAWN_AFFINITY
+/* @brief
+ * Take a task that spawn_on() placed on this worker or on its NUMA node.
+ * Failing that, take a task that has waited for too long in the mailbox
+ * of a random other worker or node.
+ */
+bool
+worker_state::mailbox_steal() {
+    extern mailbox * node_mailbox;
+    mailbox::entry e;
+
+    if( inbox.take( e ) || node_mailbox[my_mem].take( e ) ) {
+	PROFILE(mailbox_steals);
+    } else {
+	uint64_t before = get_ticks() - SPAWN_AFFINITY_TIMEOUT;
+	size_t victim = lf_rand() % nthreads;
+	size_t node = lf_rand() % wf_num_nodes();
+	if( !( victim != id && ws[victim].inbox.take_overdue( e, before ) )
+	    && !( node != my_mem
+		  && node_mailbox[node].take_overdue( e, before ) ) )
+	    return false;
+	PROFILE(mailbox_overdue_steals);
+    }
+
+    e.parent->lock( &sd );
+    sd.wakeup_steal( e.parent, e.pnd );
+    e.parent->unlock( &sd );
+    return true;
+}
+
+mailbox *
+worker_state::get_mailbox( on_worker w ) {
+    worker_state * me = tls();
+    worker_state * tgt = &ws[w.id % me->nthreads];
+    return tgt == me ? 0 : &tgt->inbox;
+}
+
+mailbox *
+worker_state::get_mailbox( on_node n ) {
+    extern mailbox * node_mailbox;
+    worker_state * me = tls();
+    size_t node = n.id % wf_num_nodes();
+    return node == me->my_mem ? 0 : &node_mailbox[node];
+}
+#endif
+
 // Need to take into account that dummy frame too will be stolen...
 void
 worker_state::provably_good_steal( full_frame * fr ) {
@@ -343,6 +462,29 @@ worker_state::provably_good_steal( full_frame * fr ) {
 	      || fr->get_frame()->get_state() == fs_executing )
 	    && "Provably-good-steal of frame owned by empty deque & !exec?" );
 
+#if OBJECT_THROTTLE
+    // A frame suspended by the pending budget (wf_throttle_pending()) has
+    // its ready children executed while the budget is exceeded. It resumes
+    // when the budget is met or when none of its children is ready.
+    if( fr->get_frame()->get_state() == fs_suspended && fr->is_throttled() ) {
+	if( !fr->all_children_done() && obj::throttle.pending_over_budget() ) {
+	    if( pending_frame * schildq = sd.steal_rchild( fr, sm_sync ) ) {
+		sd.wakeup_steal( fr, schildq );
+		fr->unlock( &sd );
+		return;
+	    }
+	}
+	fr->set_throttled( false );
+	LOG( id_steal_suspended, fr );
+	fr->get_frame()->set_owner( &sd );
+	fr->get_frame()->set_state( fs_waiting );
+	sd.insert_stack( fr );
+	fr->unlock( &sd );
+	PROFILE( provgd_steals_fr );
+	return;
+    }
+#endif
+
     if( fr->get_frame()->get_state() == fs_suspended
 	&& fr->all_children_done() ) {
 	// Steal suspended frame
@@ -444,7 +586,11 @@ worker_state::worker_fn() {
     pp_time_start( &wprofile.time_longjmp );
 #endif
     PROFILE(setjmp);
+#if FAST_CONTEXT_SWITCH
+    sjr = (empty_deque_condition_t)swan_ctx_save( &jb_ret );
+#else
     sjr = (empty_deque_condition_t)setjmp( jb_ret );
+#endif
 #if PROFILE_WORKER
     pp_time_end( &wprofile.time_longjmp );
 #endif
@@ -489,6 +635,9 @@ worker_state::worker_fn() {
 	assert( sd.empty()
 		&& "Deque must be empty when returning through longjmp()" );
 	assert( child->get_frame()->is_call() && "Must be call here" );
+#if LAZY_FULL_FRAME
+	parent->settle_deferred( child->get_frame() );
+#endif
 	the_task_graph_traits::release_task( child->get_frame() );
 	parent->lock( &sd );
 	child->lock( &sd );
@@ -515,6 +664,9 @@ worker_state::worker_fn() {
 	num_h0_hits = 0;
 	num_h1_hits = 0;
 	num_hash_empty = 0;
+#endif
+#if LAZY_FULL_FRAME
+	parent->settle_deferred( child->get_frame() );
 #endif
 	pending_frame * next
 	    = the_task_graph_traits::release_task_and_get_ready( child );
@@ -532,9 +684,6 @@ worker_state::worker_fn() {
 	tls_worker_state->wprofile.num_hash_empty += num_hash_empty;
 #endif
 	parent->lock( &sd );
-#if !PACT11_VERSION && 0
-	parent->rchild_steal_attempt( next != 0, sm_release );
-#endif
 	child->lock( &sd );
 	stack_frame * child_fr = child->get_frame();
 	child->~full_frame(); // full_frame destructor, because not deleted
@@ -629,8 +778,8 @@ worker_state::initiator( void * data ) {
     ws->cpubind();
 
     // Decrement barrier count - we're alive
-    extern volatile long ini_barrier;
-    __sync_fetch_and_add( &ini_barrier, -1 );
+    extern void wf_startup_arrive();
+    wf_startup_arrive();
 
     extern __thread logger * tls_thread_logger;
     extern logger * thread_logger;
@@ -35,6 +35,7 @@
 #include "object.h"
 #include "wf_spawn_deque.h"
 #include "wf_stack_frame.h"
+#include "wf_mailbox.h"
 #include "alc_allocator.h"
 #include "alc_mmappol.h"
 #include "alc_flpol.h"
@@ -97,13 +98,20 @@ public:
 
     typedef alc::mmap_alloc_policy<stack_frame,
 				   stack_frame::Align> mmap_align_pol;
+    // Refill with 2 MB at a time, which fits a huge page (HUGE_PAGE_ALLOC)
     typedef alc::freelist_alloc_policy<stack_frame, mmap_align_pol,
-				       32> flist_align_pol;
+				       HUGE_PAGE_ALLOC
+				       ? (2<<20)/STACK_FRAME_SIZE : 32>
+    flist_align_pol;
     typedef alc::allocator<stack_frame, flist_align_pol> sf_alloc_type;
 
 private:
     spawn_deque __cache_aligned sd;
+#if FAST_CONTEXT_SWITCH
+    ctx_buf_t jb_ret;
+#else
     jmp_buf jb_ret;
+#endif
     size_t id;
     size_t nthreads;
     future * cresult;
@@ -122,6 +130,10 @@ private:
     size_t my_cpu;
     size_t my_mem;
 
+#if SPAWN_AFFINITY
+    mailbox inbox; // tasks placed on this worker by spawn_on()
+#endif
+
     // backoff_t backoff;
 
 #if PROFILE_WORKER
@@ -158,6 +170,8 @@ public:
 	size_t num_provgd_steals_fr;
 	size_t num_random_steals;
 	size_t num_focussed_steals;
+	size_t num_mailbox_steals;
+	size_t num_mailbox_overdue_steals;
 
 	size_t num_tkt_evals_release_ready;
 	size_t num_tkt_evals_release_ready_fail;
@@ -192,12 +206,14 @@ public:
     // Short-hand
     static worker_state * tls() { return get_thread_worker_state(); }
 
-    void initialize( size_t id_, size_t nthreads_,
+    void initialize( size_t id_, size_t nthreads_, future * cresult_ );
+    // Placement is decided when the workers are started (see
+    // wf_start_workers()). Until then, all workers sit on node 0.
+    void place(
 #ifdef HAVE_LIBHWLOC
-		     hwloc_topology_t topology_,
+	hwloc_topology_t topology_,
 #endif
-		     size_t cpu_,
-		     size_t mem_, future * cresult_ );
+	size_t cpu_, size_t mem_ );
 
     const spawn_deque * get_deque() const { return &sd; }
     intptr_t get_main_sp() const { return main_sp; }
@@ -207,6 +223,9 @@ public:
     void worker_fn( void );
 
 private:
+#if SPAWN_AFFINITY
+    bool mailbox_steal( void );
+#endif
     void random_steal( void );
     void provably_good_steal( full_frame * fr );
     void unconditional_steal( full_frame * fr );
@@ -225,6 +244,16 @@ public:
 
     void cpubind() const;
 
+    size_t get_id() const { return id; }
+    size_t get_node() const { return my_mem; }
+
+#if SPAWN_AFFINITY
+    // Mailbox for a ready task with affinity to a worker or NUMA node, or
+    // null if the current worker should execute the task.
+    static mailbox * get_mailbox( on_worker w );
+    static mailbox * get_mailbox( on_node n );
+#endif
+
 private:
     // Constants provided by
     // http://en.wikipedia.org/wiki/Linear_congruential_generator,
@@ -256,5 +285,16 @@ worker_state::get_pf_allocator() {
     return tls()->pf_allocator;
 } 
 
+// The worker pool is created lazily, on the first call to run().
+extern volatile bool workers_started;
+void wf_start_workers();
+
+// Number of NUMA nodes that workers execute on (1 without hwloc)
+size_t wf_num_nodes();
+
+inline void wf_ensure_workers() {
+    if( unlikely( !workers_started ) )
+	wf_start_workers();
+}
 
 #endif // WF_WORKER_H
@@ -0,0 +1,130 @@
+/*
+ * Copyright (C) 2011 Hans Vandierendonck (hvandierendonck@acm.org)
+ * Copyright (C) 2011 George Tzenakis (tzenakis@ics.forth.gr)
+ * Copyright (C) 2011 Dimitrios S. Nikolopoulos (dsn@ics.forth.gr)
+ *
+ * This file is part of Swan.
+ *
+ * Swan is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Swan is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Swan.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+// -*- c++ -*-
+// Affinity hints: first-touch initialization of an array and tasks with
+// dependences spawned on alternating workers and nodes. Checks that every
+// task executes exactly once and in dependence order. Placement is a hint
+// only, so it is reported rather than checked.
+#include <cstdlib>
+
+#include <iostream>
+
+#include "wf_interface.h"
+
+using namespace obj;
+
+static size_t my_worker() {
+    return worker_state::tls()->get_id();
+}
+
+void touch( size_t from, size_t to, long * a, size_t * owner, size_t * ranges ) {
+    for( size_t i=from; i < to; ++i ) {
+	a[i] += i;
+	owner[i] = my_worker();
+    }
+    __sync_fetch_and_add( ranges, 1 );
+}
+
+void produce( outdep<long> x, long v ) {
+    *x = v;
+}
+
+void step( inoutdep<long> x, long k ) {
+    *x = *x * 3 + k;
+}
+
+void check( indep<long> x, long expected, int i ) {
+    if( *x != expected ) {
+	std::cerr << "ERROR: x[" << i << "]=" << *x
+		  << " correct=" << expected << "\n";
+	abort();
+    }
+}
+
+void chains( int n, int steps ) {
+    object_t<long> * x = new object_t<long>[n];
+    size_t nw = ::nthreads;
+
+    for( int i=0; i < n; ++i ) {
+	spawn_on( on_worker( i ), produce, (outdep<long>)x[i], (long)i );
+	long ref = i;
+	for( int k=0; k < steps; ++k ) {
+	    if( k & 1 )
+		spawn_on( on_node( k ), step, (inoutdep<long>)x[i], (long)k );
+	    else
+		spawn_on( on_worker( i+k+1 ), step, (inoutdep<long>)x[i],
+			  (long)k );
+	    ref = ref * 3 + k;
+	}
+	spawn_on( on_worker( nw-1 ), check, (indep<long>)x[i], ref, i );
+    }
+    ssync();
+
+    delete[] x;
+}
+
+int main( int argc, char * argv[] ) {
+    if( argc <= 1 ) {
+	std::cerr << "Usage: " << argv[0] << " <n> [<steps>]\n";
+	return 1;
+    }
+
+    size_t n = atoi( argv[1] );
+    int steps = argc > 2 ? atoi( argv[2] ) : 8;
+
+    long * a = new long[n];
+    size_t * owner = new size_t[n];
+    size_t ranges = 0;
+    for( size_t i=0; i < n; ++i )
+	a[i] = 0;
+
+    first_touch( n, touch, a, owner, &ranges );
+
+    size_t nw = ::nthreads;
+    size_t local = 0;
+    for( size_t i=0; i < n; ++i ) {
+	if( a[i] != long(i) ) {
+	    std::cerr << "ERROR: a[" << i << "]=" << a[i]
+		      << " touched more or less than once\n";
+	    return 1;
+	}
+	// The partition of first_touch()
+	size_t k = 0;
+	while( k+1 < nw && n * ( k+1 ) / nw <= i )
+	    ++k;
+	if( owner[i] == k )
+	    ++local;
+    }
+    std::cout << "first touch: " << local << " of " << n
+	      << " elements on their worker, " << ranges << " ranges\n";
+
+    run( chains, (int)n, steps );
+
+    std::cout << "affinity check ok\n";
+
+    delete[] a;
+    delete[] owner;
+
+    return 0;
+}
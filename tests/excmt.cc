@@ -0,0 +1,107 @@
+/*
+ * Copyright (C) 2011 Hans Vandierendonck (hvandierendonck@acm.org)
+ * Copyright (C) 2011 George Tzenakis (tzenakis@ics.forth.gr)
+ * Copyright (C) 2011 Dimitrios S. Nikolopoulos (dsn@ics.forth.gr)
+ *
+ * This file is part of Swan.
+ *
+ * Swan is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Swan is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Swan.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+// -*- c++ -*-
+// Histogram updates: many commutative tasks on a few bins. Checks that
+// commutative tasks on the same bin never overlap, that readers see all
+// preceding updates and that no update is lost.
+#include <cstdlib>
+
+#include <iostream>
+
+#include "wf_interface.h"
+
+using namespace obj;
+
+#if OBJECT_COMMUTATIVITY
+struct bin {
+    long count;
+    volatile int busy;
+};
+
+static void delay( int n ) {
+    for( volatile int i=0; i < n; ++i );
+}
+
+void update( cinoutdep<bin> b, int dd ) {
+    if( b->busy ) {
+	std::cerr << "ERROR: overlapping commutative tasks\n";
+	abort();
+    }
+    b->busy = 1;
+    long c = b->count;
+    delay( dd );
+    b->count = c + 1;
+    b->busy = 0;
+}
+
+void check( indep<bin> b, long expected ) {
+    if( b->count != expected ) {
+	std::cerr << "ERROR: count=" << b->count
+		  << " correct=" << expected << "\n";
+	abort();
+    }
+}
+
+void histogram( int n, int nbins, int rounds, int dd ) {
+    object_t<bin> * bins = new object_t<bin>[nbins];
+    for( int j=0; j < nbins; ++j ) {
+	bins[j]->count = 0;
+	bins[j]->busy = 0;
+    }
+
+    for( int r=1; r <= rounds; ++r ) {
+	for( int i=0; i < n; ++i )
+	    spawn( update, (cinoutdep<bin>)bins[i % nbins], dd );
+	for( int j=0; j < nbins; ++j ) {
+	    long expected = long(r) * long(n / nbins + (j < n % nbins));
+	    spawn( check, (indep<bin>)bins[j], expected );
+	}
+    }
+    ssync();
+
+    delete[] bins;
+}
+
+int main( int argc, char * argv[] ) {
+    if( argc <= 1 ) {
+	std::cerr << "Usage: " << argv[0]
+		  << " <n> [<bins> [<rounds> [<delay>]]]\n";
+	return 1;
+    }
+
+    int n = atoi( argv[1] );
+    int nbins = argc > 2 ? atoi( argv[2] ) : 4;
+    int rounds = argc > 3 ? atoi( argv[3] ) : 3;
+    int dd = argc > 4 ? atoi( argv[4] ) : 1000;
+
+    run( histogram, n, nbins, rounds, dd );
+
+    return 0;
+}
+#else
+int main( int argc, char * argv[] ) {
+    std::cout << "Commutative tasks require OBJECT_COMMUTATIVITY\n";
+    return 0;
+}
+#endif
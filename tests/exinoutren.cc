@@ -0,0 +1,103 @@
+/*
+ * Copyright (C) 2011 Hans Vandierendonck (hvandierendonck@acm.org)
+ * Copyright (C) 2011 George Tzenakis (tzenakis@ics.forth.gr)
+ * Copyright (C) 2011 Dimitrios S. Nikolopoulos (dsn@ics.forth.gr)
+ * 
+ * This file is part of Swan.
+ * 
+ * Swan is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Swan is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Swan.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+// -*- c++ -*-
+// Renaming of inout dependencies (OBJECT_INOUT_RENAME). Readers of a
+// version must observe its value even when a later inout task renames the
+// object. Small objects are copied immediately, large ones by a copy task.
+#include <cstdlib>
+#include <cstring>
+#include <cassert>
+
+#include <iostream>
+
+#include "wf_interface.h"
+
+using namespace obj;
+
+static void delay( int n ) {
+    for( volatile int i=0; i < n; ++i );
+}
+
+template<size_t N>
+struct block {
+    long data[N];
+};
+
+template<size_t N>
+void produce( outdep<block<N> > b, long v ) {
+    for( size_t k=0; k < N; ++k )
+	b->data[k] = v;
+}
+
+template<size_t N>
+void reader( indep<block<N> > b, long v, int dd ) {
+    delay( dd );
+    for( size_t k=0; k < N; ++k ) {
+	if( b->data[k] != v ) {
+	    std::cerr << "ERROR: reader expects " << v << " at " << k
+		      << " but finds " << b->data[k] << "\n";
+	    abort();
+	}
+    }
+}
+
+template<size_t N>
+void update( inoutdep<block<N> > b, int dd ) {
+    delay( dd );
+    for( size_t k=0; k < N; ++k )
+	b->data[k] += 1;
+}
+
+template<size_t N>
+void test( int n, int dd ) {
+    object_t<block<N> > b;
+    spawn( produce<N>, (outdep<block<N> >)b, 0L );
+    for( int i=0; i < n; ++i ) {
+	// Slow readers followed by an update: the update may rename
+	for( int r=0; r < 4; ++r )
+	    spawn( reader<N>, (indep<block<N> >)b, long(i), dd );
+	spawn( update<N>, (inoutdep<block<N> >)b, dd/4 );
+    }
+    ssync();
+    reader<N>( (indep<block<N> >)b, long(n), 0 );
+}
+
+void run_tests( int n, int dd ) {
+    test<4>( n, dd );        // copied by the spawning thread
+    test<4096>( n, dd );     // copied by a copy task
+    std::cout << "inout renaming ok\n";
+}
+
+int main( int argc, char * argv[] ) {
+    if( argc <= 1 ) {
+	std::cerr << "Usage: " << argv[0] << " <n> [<delay>]\n";
+	return 1;
+    }
+
+    int n = atoi( argv[1] );
+    int dd = argc > 2 ? atoi( argv[2] ) : 10000;
+    run( run_tests, n, dd );
+
+    return 0;
+}
@@ -0,0 +1,178 @@
+/*
+ * Copyright (C) 2011 Hans Vandierendonck (hvandierendonck@acm.org)
+ * Copyright (C) 2011 George Tzenakis (tzenakis@ics.forth.gr)
+ * Copyright (C) 2011 Dimitrios S. Nikolopoulos (dsn@ics.forth.gr)
+ * 
+ * This file is part of Swan.
+ * 
+ * Swan is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Swan is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Swan.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// -*- c++ -*-
+// Pipelines (wf_pipeline.h). A source numbers the items 0..n-1, parallel
+// filters transform them out of order, a serial_out_of_order filter sees
+// every item once and a serial_in_order sink must see them in order.
+// The second test ends in a parallel sink. The number of items in flight
+// and of concurrent filter invocations must not exceed max_tokens.
+#include <cstdlib>
+#include <cassert>
+
+#include <iostream>
+
+#include "wf_interface.h"
+#include "wf_pipeline.h"
+
+using namespace obj;
+
+// Items between the source and the end of the sink, and invocations of
+// the other filters in progress
+static long max_tokens;
+static volatile long in_flight, active;
+
+static void check_bound( const char * what, long n ) {
+    if( n > max_tokens ) {
+	std::cerr << n << " " << what << " with " << max_tokens
+		  << " tokens\n";
+	abort();
+    }
+}
+
+struct invocation {
+    invocation() {
+	check_bound( "concurrent filter invocations",
+		     __sync_add_and_fetch( &active, 1 ) );
+    }
+    ~invocation() { __sync_fetch_and_add( &active, -1 ); }
+};
+
+static void item_done() { __sync_fetch_and_add( &in_flight, -1 ); }
+
+struct source {
+    long i, n;
+    source( long n_ ) : i( 0 ), n( n_ ) { }
+    bool operator () ( long & v ) {
+	if( i == n )
+	    return false;
+	v = i++;
+	check_bound( "items in flight", __sync_add_and_fetch( &in_flight, 1 ) );
+	return true;
+    }
+};
+
+// Uneven work such that items overtake each other
+static long spin( long v ) {
+    volatile long s = 0;
+    for( long k=0; k < (v * 7919) % 1000; ++k )
+	s += k;
+    return s;
+}
+
+struct square {
+    long operator () ( long v ) {
+	invocation inv;
+	spin( v );
+	return v * v;
+    }
+};
+
+struct plus_one {
+    long operator () ( long v ) {
+	invocation inv;
+	spin( v );
+	return v + 1;
+    }
+};
+
+struct count {
+    long * seen;
+    long operator () ( long v ) {
+	invocation inv;
+	++*seen;
+	return v;
+    }
+};
+
+struct check_order {
+    long * next;
+    void operator () ( long v ) {
+	invocation inv;
+	long i = (*next)++;
+	if( v != i * i + 1 ) {
+	    std::cerr << "Item " << i << " is " << v << ", expected "
+		      << (i * i + 1) << "\n";
+	    abort();
+	}
+	item_done();
+    }
+};
+
+struct check_sum {
+    cas_mutex * mutex;
+    long * sum;
+    void operator () ( long v ) {
+	invocation inv;
+	spin( v );
+	mutex->lock();
+	*sum += v;
+	mutex->unlock();
+	item_done();
+    }
+};
+
+void test( long n, long tokens, long batch ) {
+    max_tokens = tokens;
+    long seen = 0, next = 0;
+    count c = { &seen };
+    check_order o = { &next };
+    parallel_pipeline( tokens,
+		       make_filter<void, long>( serial_in_order, source( n ) ),
+		       make_filter<long, long>( parallel, square(), batch ),
+		       make_filter<long, long>( serial_out_of_order, c ),
+		       make_filter<long, long>( parallel, plus_one() ),
+		       make_filter<long, void>( serial_in_order, o ) );
+    if( seen != n || next != n ) {
+	std::cerr << "Ordered pipeline: " << seen << " and " << next
+		  << " items, expected " << n << "\n";
+	abort();
+    }
+
+    cas_mutex mutex;
+    long sum = 0;
+    check_sum s = { &mutex, &sum };
+    parallel_pipeline( tokens,
+		       make_filter<void, long>( serial_in_order, source( n ) ),
+		       make_filter<long, long>( serial_in_order, plus_one() ),
+		       make_filter<long, void>( parallel, s, batch ) );
+    if( sum != n * (n+1) / 2 ) {
+	std::cerr << "Parallel sink: sum " << sum << ", expected "
+		  << (n * (n+1) / 2) << "\n";
+	abort();
+    }
+}
+
+int main( int argc, char * argv[] ) {
+    if( argc < 2 ) {
+	std::cerr << "Usage: " << argv[0]
+		  << ": <num_items> [<max_tokens> [<batch>]]\n";
+	return 1;
+    }
+
+    long n = atol( argv[1] );
+    long tokens = argc > 2 ? atol( argv[2] ) : 8;
+    long batch = argc > 3 ? atol( argv[3] ) : 4;
+
+    run( test, n, tokens, batch );
+
+    return 0;
+}
@@ -0,0 +1,164 @@
+/*
+ * Copyright (C) 2011 Hans Vandierendonck (hvandierendonck@acm.org)
+ * Copyright (C) 2011 George Tzenakis (tzenakis@ics.forth.gr)
+ * Copyright (C) 2011 Dimitrios S. Nikolopoulos (dsn@ics.forth.gr)
+ *
+ * This file is part of Swan.
+ *
+ * Swan is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Swan is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Swan.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+// -*- c++ -*-
+// A panel/update task graph in the style of a left-looking factorization,
+// with the panel tasks spawned at a high priority. The updates are not
+// commutative, so the result is only correct if priorities never reorder
+// dependent tasks. A second graph checks that a prioritized task is selected
+// before other tasks that become ready at the same time.
+#include <cstdlib>
+#include <sched.h>
+
+#include <iostream>
+
+#include "wf_interface.h"
+
+using namespace obj;
+
+static const long P = 1000003;
+
+static void delay( int n ) {
+    for( volatile int i=0; i < n; ++i );
+}
+
+static long panel_op( long x ) { return ( x * 5 + 1 ) % P; }
+static long update_op( long x, long p ) { return ( x * 3 + p ) % P; }
+
+void panel( inoutdep<long> x, int dd ) {
+    delay( dd );
+    *x = panel_op( *x );
+}
+
+void update( inoutdep<long> x, indep<long> p, int dd ) {
+    delay( dd );
+    *x = update_op( *x, *p );
+}
+
+void check( indep<long> x, long expected, int i ) {
+    if( *x != expected ) {
+	std::cerr << "ERROR: x[" << i << "]=" << *x
+		  << " correct=" << expected << "\n";
+	abort();
+    }
+}
+
+void factor( int n, int rounds, int dd ) {
+    object_t<long> * x = new object_t<long>[n];
+    long * ref = new long[n];
+
+    for( int i=0; i < n; ++i )
+	*x[i] = ref[i] = i;
+
+    for( int r=0; r < rounds; ++r ) {
+	for( int k=0; k < n; ++k ) {
+	    spawn_prio( 2, panel, (inoutdep<long>)x[k], dd );
+	    ref[k] = panel_op( ref[k] );
+	    if( k+1 < n ) { // look-ahead: the next panel first
+		spawn_prio( 1, update, (inoutdep<long>)x[k+1],
+			    (indep<long>)x[k], dd );
+		ref[k+1] = update_op( ref[k+1], ref[k] );
+	    }
+	    for( int i=k+2; i < n; ++i ) {
+		spawn( update, (inoutdep<long>)x[i], (indep<long>)x[k], dd );
+		ref[i] = update_op( ref[i], ref[k] );
+	    }
+	}
+	for( int i=0; i < n; ++i )
+	    spawn( check, (indep<long>)x[i], ref[i], i );
+    }
+    ssync();
+
+    for( int i=0; i < n; ++i ) {
+	if( *x[i] != ref[i] ) {
+	    std::cerr << "ERROR: after sync x[" << i << "]=" << *x[i]
+		      << " correct=" << ref[i] << "\n";
+	    abort();
+	}
+    }
+
+    delete[] ref;
+    delete[] x;
+}
+
+// Ordering: tasks that wait on the same object become ready at the same
+// time. The one spawned with a priority must be selected first, even though
+// it was spawned last. The gate keeps the waiters pending: it spins until
+// the continuation of the spawning frame is stolen and opens the gate.
+volatile bool gate_open;
+volatile int started;
+
+void gate( inoutdep<long> g ) {
+    while( !gate_open )
+	sched_yield();
+}
+
+void waiter( indep<long> g, int * seq, int dd ) {
+    *seq = __sync_fetch_and_add( &started, 1 );
+    delay( dd );
+}
+
+void ordered( int n, int * seq, int dd ) {
+    object_t<long> g;
+    gate_open = false;
+    started = 0;
+    spawn( gate, (inoutdep<long>)g );
+    for( int i=0; i < n; ++i )
+	spawn( waiter, (indep<long>)g, &seq[i], dd );
+    spawn_prio( 3, waiter, (indep<long>)g, &seq[n], dd );
+    gate_open = true;
+    ssync();
+}
+
+int main( int argc, char * argv[] ) {
+    if( argc <= 1 ) {
+	std::cerr << "Usage: " << argv[0] << " <n> [<rounds> [<delay>]]\n";
+	return 1;
+    }
+
+    int n = atoi( argv[1] );
+    int rounds = argc > 2 ? atoi( argv[2] ) : 3;
+    int dd = argc > 3 ? atoi( argv[3] ) : 1000;
+
+    run( factor, n, rounds, dd );
+
+#if OBJECT_TASKGRAPH == 1 && TKT_PRIORITIES
+    // Every worker may pick up one waiter when the gate opens, but the
+    // first one selected must be the prioritized waiter.
+    extern size_t nthreads;
+    if( nthreads > 1 ) {
+	int * seq = new int[n+1];
+	run( ordered, n, seq, dd );
+	if( seq[n] >= (int)nthreads ) {
+	    std::cerr << "ERROR: prioritized task started as number " << seq[n]
+		      << " with " << nthreads << " threads\n";
+	    abort();
+	}
+	delete[] seq;
+    }
+#endif
+
+    std::cout << "priority check ok\n";
+
+    return 0;
+}
@@ -0,0 +1,143 @@
+/*
+ * Copyright (C) 2011 Hans Vandierendonck (hvandierendonck@acm.org)
+ * Copyright (C) 2011 George Tzenakis (tzenakis@ics.forth.gr)
+ * Copyright (C) 2011 Dimitrios S. Nikolopoulos (dsn@ics.forth.gr)
+ * 
+ * This file is part of Swan.
+ * 
+ * Swan is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Swan is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Swan.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+// -*- c++ -*-
+// Parallel draining of a hyperqueue (foreach_pop). Consumers claim the
+// elements of the queue concurrently. Unordered: every element must be
+// seen exactly once. Ordered: the results pass through obj::reorder and
+// must arrive at the next pipeline stage in queue order.
+#include <cstdlib>
+#include <cassert>
+
+#include <iostream>
+#include <vector>
+
+#include "wf_interface.h"
+
+using namespace obj;
+
+static void delay( int n ) {
+    for( volatile int i=0; i < n; ++i );
+}
+
+void produce( pushdep<int> queue, int n ) {
+    for( int i=0; i < n; ++i )
+	queue.push( i );
+}
+
+// Unordered consumption
+void count( int v, size_t idx, volatile int * seen, int dd ) {
+    if( v != int(idx) ) {
+	std::cerr << "ERROR: element " << v << " claimed at " << idx << "\n";
+	abort();
+    }
+    delay( dd * ( v % 3 ) );
+    __sync_fetch_and_add( &seen[v], 1 );
+}
+
+void drain_unordered( popdep<int> queue, size_t nc, volatile int * seen,
+		      int dd ) {
+    foreach_pop( queue, nc, &count, seen, dd );
+}
+
+// Ordered consumption: square in parallel, restore order, push on
+struct push_sink {
+    pushdep<int> out;
+    push_sink( pushdep<int> out_ ) : out( out_ ) { }
+    void operator () ( int v ) { out.push( v ); }
+};
+
+typedef reorder<int, push_sink> reorder_t;
+
+void square( int v, size_t idx, reorder_t * ro, int dd ) {
+    delay( dd * ( 3 - v % 3 ) );
+    ro->put( idx, v*v );
+}
+
+void drain_ordered( popdep<int> queue, pushdep<int> out, size_t nc, int dd ) {
+    reorder_t ro( (push_sink( out )) );
+    foreach_pop( queue, nc, &square, &ro, dd );
+}
+
+void check( popdep<int> queue, int n ) {
+    for( int i=0; i < n; ++i ) {
+	if( queue.empty() ) {
+	    std::cerr << "ERROR: queue drained after " << i << " elements\n";
+	    abort();
+	}
+	int v = queue.pop();
+	if( v != i*i ) {
+	    std::cerr << "ERROR: element " << i << " is " << v
+		      << " expected " << i*i << "\n";
+	    abort();
+	}
+    }
+    if( !queue.empty() ) {
+	std::cerr << "ERROR: excess elements in the queue\n";
+	abort();
+    }
+}
+
+void test( int n, size_t nc, int dd ) {
+    // Not on the stack: the task frame is small (STACK_FRAME_SIZE)
+    std::vector<int> seen( n, 0 );
+    {
+	hyperqueue<int> q;
+	spawn( produce, (pushdep<int>)q, n );
+	spawn( drain_unordered, (popdep<int>)q, nc,
+	       (volatile int *)&seen[0], dd );
+	ssync();
+    }
+    for( int i=0; i < n; ++i ) {
+	if( seen[i] != 1 ) {
+	    std::cerr << "ERROR: element " << i << " seen " << seen[i]
+		      << " times\n";
+	    abort();
+	}
+    }
+
+    hyperqueue<int> q, r;
+    spawn( produce, (pushdep<int>)q, n );
+    spawn( drain_ordered, (popdep<int>)q, (pushdep<int>)r, nc, dd );
+    spawn( check, (popdep<int>)r, n );
+    ssync();
+}
+
+void run_tests( int n, int dd ) {
+    test( n, 0, dd );
+    test( n, 1, dd );
+    test( n, 5, dd );
+    std::cout << "parallel pop ok\n";
+}
+
+int main( int argc, char * argv[] ) {
+    if( argc <= 1 ) {
+	std::cerr << "Usage: " << argv[0] << " <n> [<delay>]\n";
+	return 1;
+    }
+
+    int n = atoi( argv[1] );
+    int dd = argc > 2 ? atoi( argv[2] ) : 1000;
+    run( run_tests, n, dd );
+
+    return 0;
+}
@@ -0,0 +1,118 @@
+/*
+ * Copyright (C) 2011 Hans Vandierendonck (hvandierendonck@acm.org)
+ * Copyright (C) 2011 George Tzenakis (tzenakis@ics.forth.gr)
+ * Copyright (C) 2011 Dimitrios S. Nikolopoulos (dsn@ics.forth.gr)
+ * 
+ * This file is part of Swan.
+ * 
+ * Swan is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Swan is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Swan.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+// -*- c++ -*-
+// Peek windows longer than the hyperqueue segment size. The consumer
+// slides a window of <num_peek> elements over the queue, as an FIR filter
+// does, while one or more producers push the elements in order. With
+// several producers, the window crosses the boundaries of segments that
+// are linked when the producers' queues are reduced. Short windows keep
+// the segments small, which are not mirrored.
+#include <cstdlib>
+#include <cassert>
+
+#include <algorithm>
+#include <iostream>
+
+#include "wf_interface.h"
+
+using namespace obj;
+
+#define SEGMENT 16
+
+void produce( pushdep<long> queue, long from, long n ) {
+    for( long i=from; i < from+n; ++i )
+	queue.push( i );
+}
+
+void consume( popdep<long> queue, long n, long p ) {
+    for( long i=0; i < n; ++i ) {
+	long sum = 0;
+	for( long j=0; j < p; ++j )
+	    sum += queue.peek( j );
+	if( sum != p*i + p*(p-1)/2 ) {
+	    std::cerr << "Window at " << i << " sums to " << sum
+		      << ", expected " << (p*i + p*(p-1)/2) << "\n";
+	    abort();
+	}
+	long v = queue.pop();
+	assert( v == i );
+    }
+}
+
+// Mirrored rings are whole pages and whole elements, at most twice the
+// requested space. Small segments, e.g. SEGMENT longs, are linear.
+struct elm24 { char c[24]; };
+
+template<typename T>
+void check_mirror_space( size_t max_size ) {
+    size_t space = fixed_size_queue::get_mirror_space<T>( max_size );
+    size_t size = (max_size+1) * sizeof(T);
+    if( space == 0 )
+	return;
+    if( space % alc::page_size() != 0 || space % sizeof(T) != 0
+	|| space < size || space > 2*size ) {
+	std::cerr << "Mirror space for " << max_size << " elements of "
+		  << sizeof(T) << " bytes is " << space << "\n";
+	abort();
+    }
+}
+
+void check_mirror_spaces() {
+    for( size_t m=1; m < 4096; ++m ) {
+	check_mirror_space<long>( m );
+	check_mirror_space<elm24>( m );
+    }
+    if( fixed_size_queue::get_mirror_space<long>( SEGMENT ) != 0
+	|| fixed_size_queue::get_mirror_space<elm24>( SEGMENT ) != 0 ) {
+	std::cerr << "Small segments must not be mirrored\n";
+	abort();
+    }
+}
+
+void test( long n, long p, long nprod ) {
+    hyperqueue<long> queue( SEGMENT, p );
+    long total = n + p;
+    long chunk = ( total + nprod - 1 ) / nprod;
+    for( long from=0; from < total; from += chunk )
+	spawn( produce, (pushdep<long>)queue, from,
+	       std::min( chunk, total - from ) );
+    spawn( consume, (popdep<long>)queue, n, p );
+    ssync();
+}
+
+int main( int argc, char * argv[] ) {
+    if( argc < 3 ) {
+	std::cerr << "Usage: " << argv[0]
+		  << ": <num_elements> <num_peek> [<num_producers>]\n";
+	return 1;
+    }
+
+    long n = atol( argv[1] );
+    long p = atol( argv[2] );
+    long nprod = argc > 3 ? atol( argv[3] ) : 1;
+
+    check_mirror_spaces();
+    run( test, n, p, nprod );
+
+    return 0;
+}
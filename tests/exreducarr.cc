@@ -0,0 +1,115 @@
+/*
+ * Copyright (C) 2011 Hans Vandierendonck (hvandierendonck@acm.org)
+ * Copyright (C) 2011 George Tzenakis (tzenakis@ics.forth.gr)
+ * Copyright (C) 2011 Dimitrios S. Nikolopoulos (dsn@ics.forth.gr)
+ *
+ * This file is part of Swan.
+ *
+ * Swan is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Swan is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Swan.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+// -*- c++ -*-
+// Histogram by a chunked array reduction. Every task counts into a few
+// chunks of the histogram. Checks the histogram after each round of tasks,
+// both from a task that reads the histogram and after the sync.
+#include <cstdlib>
+
+#include <iostream>
+
+#include "wf_interface.h"
+#include "array_reduction.h"
+
+using namespace obj;
+
+#if OBJECT_REDUCTION
+enum { N = 1<<16 };
+
+typedef array_add_monad<unsigned, N> hist_monad;
+
+static size_t bin( int i, int j ) {
+    // A window of a few chunks per task, with a task-dependent start
+    size_t base = ( size_t(i) * 3 * hist_monad::chunk_size ) % N;
+    return ( base + size_t(j) * 7 ) % N;
+}
+
+void delay( outdep<int> ) {
+    for( volatile int i=0; i < 1000000; ++i );
+}
+
+void count( int i, int m, indep<int>, reduction<hist_monad> h ) {
+    for( int j=0; j < m; ++j )
+	h[bin( i, j )]++;
+}
+
+static void check( const unsigned * h, const unsigned * ref, const char * msg ) {
+    for( size_t k=0; k < N; ++k ) {
+	if( h[k] != ref[k] ) {
+	    std::cerr << "ERROR: " << msg << ": bin " << k << " is " << h[k]
+		      << " correct=" << ref[k] << "\n";
+	    abort();
+	}
+    }
+}
+
+void check_task( indep<unsigned[N]> h, const unsigned * ref ) {
+    check( *(const unsigned (*)[N])h, ref, "check task" );
+}
+
+void histogram( int n, int m, int rounds ) {
+    object_t<unsigned[N]> h;
+    object_t<int> d;
+    unsigned * ref = new unsigned[N];
+
+    hist_monad::identity( *(unsigned (*)[N])h, N );
+    hist_monad::identity( ref, N );
+
+    for( int r=0; r < rounds; ++r ) {
+	spawn( delay, (outdep<int>)d );
+	for( int i=0; i < n; ++i ) {
+	    spawn( count, i, m, (indep<int>)d, (reduction<hist_monad>)h );
+	    for( int j=0; j < m; ++j )
+		ref[bin( i, j )]++;
+	}
+	spawn( check_task, (indep<unsigned[N]>)h, (const unsigned *)ref );
+	ssync();
+	check( *(unsigned (*)[N])h, ref, "after sync" );
+    }
+
+    delete[] ref;
+}
+
+int main( int argc, char * argv[] ) {
+    if( argc <= 1 ) {
+	std::cerr << "Usage: " << argv[0] << " <n> [<m> [<rounds>]]\n";
+	return 1;
+    }
+
+    int n = atoi( argv[1] );
+    int m = argc > 2 ? atoi( argv[2] ) : 4096;
+    int rounds = argc > 3 ? atoi( argv[3] ) : 3;
+
+    run( histogram, n, m, rounds );
+
+    std::cout << "histogram check ok\n";
+
+    return 0;
+}
+#else
+int main( int argc, char * argv[] ) {
+    std::cout << "Reductions require OBJECT_REDUCTION\n";
+    return 0;
+}
+#endif
@@ -0,0 +1,167 @@
+/*
+ * Copyright (C) 2011 Hans Vandierendonck (hvandierendonck@acm.org)
+ * Copyright (C) 2011 George Tzenakis (tzenakis@ics.forth.gr)
+ * Copyright (C) 2011 Dimitrios S. Nikolopoulos (dsn@ics.forth.gr)
+ * 
+ * This file is part of Swan.
+ * 
+ * Swan is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Swan is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Swan.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+// -*- c++ -*-
+// Region dependencies on sub-arrays of one array. Tasks on overlapping
+// slices are serialized, tasks on disjoint tiles run in parallel.
+#include <cstdlib>
+#include <cstring>
+#include <cassert>
+
+#include <iostream>
+
+#include "wf_interface.h"
+
+#if OBJECT_TASKGRAPH == 1
+#include "region.h"
+
+using namespace obj;
+
+static void delay( int n ) {
+    for( volatile int i=0; i < n; ++i );
+}
+
+// 1D: add one to every element of a slice
+void inc( inoutdep<region<int> > a, int dd ) {
+    int * p = a.get_ptr();
+    delay( dd );
+    for( size_t i=0; i < a.get_rows(); ++i )
+	p[i] += 1;
+}
+
+// 1D: dst[i] += src[i] over the slices
+void add( indep<region<int> > src, inoutdep<region<int> > dst, int dd ) {
+    const int * s = src.get_ptr();
+    int * d = dst.get_ptr();
+    delay( dd );
+    for( size_t i=0; i < dst.get_rows(); ++i )
+	d[i] += s[i];
+}
+
+// 2D: scale a tile in place
+void scale( inoutdep<region<long> > t, long f, int dd ) {
+    long * p = t.get_ptr();
+    delay( dd );
+    for( size_t r=0; r < t.get_rows(); ++r )
+	for( size_t c=0; c < t.get_cols(); ++c )
+	    p[r*t.get_ld()+c] *= f;
+}
+
+// 2D: dst tile += src tile
+void addt( indep<region<long> > s, inoutdep<region<long> > d, int dd ) {
+    const long * ps = s.get_ptr();
+    long * pd = d.get_ptr();
+    delay( dd );
+    for( size_t r=0; r < d.get_rows(); ++r )
+	for( size_t c=0; c < d.get_cols(); ++c )
+	    pd[r*d.get_ld()+c] += ps[r*s.get_ld()+c];
+}
+
+void test1d( int n, int dd ) {
+    region_object_t<int> a( 4*n );
+    region_object_t<int> b( 4*n );
+    int * pa = a.get_ptr();
+    int * pb = b.get_ptr();
+    for( int i=0; i < 4*n; ++i )
+	pa[i] = pb[i] = 0;
+
+    // Overlapping slices: a[i] is covered by min(i/n+1,4,...) slices
+    for( int k=0; k < 4; ++k )
+	spawn( inc, a.inout( k*n/2, 2*n ), dd );
+    // Disjoint slices, reading overlapping parts of a
+    for( int k=0; k < 4; ++k )
+	spawn( add, a.in( k*n, n ), b.inout( k*n, n ), dd );
+    for( int k=0; k < 4; ++k )
+	spawn( inc, a.out( k*n, n ), dd );
+    ssync();
+
+    for( int i=0; i < 4*n; ++i ) {
+	int cnt = 0;
+	for( int k=0; k < 4; ++k )
+	    if( k*n/2 <= i && i < k*n/2 + 2*n )
+		++cnt;
+	if( pb[i] != cnt || pa[i] != cnt+1 ) {
+	    std::cerr << "ERROR: 1D at " << i << ": a=" << pa[i]
+		      << " b=" << pb[i] << " correct=" << cnt << "\n";
+	    abort();
+	}
+    }
+}
+
+void test2d( int nb, int bs, int dd ) {
+    int n = nb * bs;
+    region_object_t<long> m( n, n );
+    long * p = m.get_ptr();
+    for( int i=0; i < n*n; ++i )
+	p[i] = 1;
+
+    // Scale every tile by 2, then add the tile to its right neighbour
+    // (in sequential order from right to left) and finally scale the
+    // whole first block row by 3.
+    for( int i=0; i < nb; ++i )
+	for( int j=0; j < nb; ++j )
+	    spawn( scale, m.inout( i*bs, j*bs, bs, bs ), 2L, dd );
+    for( int i=0; i < nb; ++i )
+	for( int j=nb-1; j > 0; --j )
+	    spawn( addt, m.in( i*bs, (j-1)*bs, bs, bs ),
+		   m.inout( i*bs, j*bs, bs, bs ), dd );
+    spawn( scale, m.inout( 0, 0, bs, n ), 3L, dd );
+    ssync();
+
+    for( int r=0; r < n; ++r )
+	for( int c=0; c < n; ++c ) {
+	    long v = c < bs ? 2 : 4;
+	    if( r < bs )
+		v *= 3;
+	    if( p[r*n+c] != v ) {
+		std::cerr << "ERROR: 2D at " << r << "," << c << ": "
+			  << p[r*n+c] << " correct=" << v << "\n";
+		abort();
+	    }
+	}
+}
+
+void test( int n, int dd ) {
+    test1d( n, dd );
+    test2d( 4, n, dd );
+    std::cout << "regions ok\n";
+}
+
+int main( int argc, char * argv[] ) {
+    if( argc <= 1 ) {
+	std::cerr << "Usage: " << argv[0] << " <n> [<delay>]\n";
+	return 1;
+    }
+
+    int n = atoi( argv[1] );
+    int dd = argc > 2 ? atoi( argv[2] ) : 1000;
+    run( test, n, dd );
+
+    return 0;
+}
+#else
+int main( int argc, char * argv[] ) {
+    std::cout << "Region dependencies require OBJECT_TASKGRAPH=1\n";
+    return 0;
+}
+#endif
@@ -0,0 +1,143 @@
+/*
+ * Copyright (C) 2011 Hans Vandierendonck (hvandierendonck@acm.org)
+ * Copyright (C) 2011 George Tzenakis (tzenakis@ics.forth.gr)
+ * Copyright (C) 2011 Dimitrios S. Nikolopoulos (dsn@ics.forth.gr)
+ * 
+ * This file is part of Swan.
+ * 
+ * Swan is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Swan is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Swan.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+// -*- c++ -*-
+// Record the task graph of one iteration and replay it. Checks that
+// renamed versions are rotated correctly over the replays, and that a
+// graph with a single root is replayed by more than one worker.
+#include <cstdlib>
+#include <cstring>
+#include <cassert>
+#include <ctime>
+#include <sched.h>
+
+#include <iostream>
+
+#include "wf_interface.h"
+#include "wf_replay.h"
+
+using namespace obj;
+
+static void delay( int n ) {
+    for( volatile int i=0; i < n; ++i );
+}
+
+void inc( inoutdep<int> x ) {
+    *x += 1;
+}
+
+void twice( indep<int> x, outdep<int> y ) {
+    *y = 2 * *x;
+}
+
+void accum( indep<int> y, int n, inoutdep<long> s ) {
+    delay( n );
+    *s += *y;
+}
+
+// Two tasks released by one root wait for each other. This only
+// completes when the replay runs them on different workers.
+volatile int met;
+
+void open( outdep<int> g ) {
+    *g = 0;
+}
+
+void meet( indep<int> g ) {
+    __sync_fetch_and_add( &met, 1 );
+    time_t start = time( 0 );
+    while( met % 2 != 0 ) {
+	if( time( 0 ) - start > 10 ) {
+	    std::cerr << "ERROR: replay of a single root is not parallel\n";
+	    abort();
+	}
+	sched_yield();
+    }
+}
+
+void test_single_root( int n ) {
+    object_t<int> g;
+    task_replay graph;
+
+    met = 0;
+    graph.begin_record();
+    graph.spawn( open, (outdep<int>)g );
+    graph.spawn( meet, (indep<int>)g );
+    graph.spawn( meet, (indep<int>)g );
+    graph.end_record();
+    ssync();
+
+    for( int i=1; i < n; ++i )
+	graph.replay();
+    std::cout << "single root: met=" << met << "\n";
+}
+
+void region( task_replay * graph, object_t<int> & x, object_t<int> & y,
+	     unversioned<long> & s, int dd ) {
+    graph->spawn( inc, (inoutdep<int>)x );
+    for( int k=0; k < 4; ++k ) {
+	graph->spawn( twice, (indep<int>)x, (outdep<int>)y );
+	graph->spawn( accum, (indep<int>)y, dd, (inoutdep<long>)s );
+    }
+}
+
+void test( int n, int dd ) {
+    object_t<int> x, y;
+    unversioned<long> s;
+    task_replay graph;
+
+    *x = 0;
+    *s = 0;
+
+    graph.begin_record();
+    region( &graph, x, y, s, dd );
+    graph.end_record();
+
+    for( int i=1; i < n; ++i )
+	graph.replay();
+    ssync();
+
+    long expected = 4 * long(n) * long(n+1);
+    std::cout << "tasks=" << graph.num_tasks()
+	      << " x=" << *x << " s=" << *s << "\n";
+    if( *x != n || *s != expected ) {
+	std::cerr << "ERROR: wrong value: x=" << *x << " correct=" << n
+		  << " s=" << *s << " correct=" << expected << "\n";
+	abort();
+    }
+}
+
+int main( int argc, char * argv[] ) {
+    if( argc <= 1 ) {
+	std::cerr << "Usage: " << argv[0] << " <n> [<delay>]\n";
+	return 1;
+    }
+
+    int n = atoi( argv[1] );
+    int dd = argc > 2 ? atoi( argv[2] ) : 1000;
+    run( test, n, dd );
+    extern size_t nthreads;
+    if( nthreads > 1 )
+	run( test_single_root, n );
+
+    return 0;
+}
@@ -0,0 +1,155 @@
+/*
+ * Copyright (C) 2011 Hans Vandierendonck (hvandierendonck@acm.org)
+ * Copyright (C) 2011 George Tzenakis (tzenakis@ics.forth.gr)
+ * Copyright (C) 2011 Dimitrios S. Nikolopoulos (dsn@ics.forth.gr)
+ * 
+ * This file is part of Swan.
+ * 
+ * Swan is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Swan is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Swan.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+// -*- c++ -*-
+// A pipeline with large payloads under a rename budget and a pending frame
+// budget. Checks that every stage sees the correct values and that the
+// bytes held by renamed versions stay within the budget, and that the
+// pending budget does not make spawn() wait for earlier children.
+#include <cstdlib>
+#include <cstring>
+#include <cassert>
+#include <sched.h>
+
+#include <iostream>
+
+#include "wf_interface.h"
+
+using namespace obj;
+
+#if OBJECT_THROTTLE
+enum { N = 4096 };
+
+struct block {
+    int data[N];
+};
+
+size_t max_renamed = 0;
+
+static void delay( int n ) {
+    for( volatile int i=0; i < n; ++i );
+}
+
+void produce( int i, outdep<block> b ) {
+    for( int k=0; k < N; ++k )
+	b->data[k] = i + k;
+}
+
+void consume( int i, indep<block> b, inoutdep<long> sum, int dd ) {
+    delay( dd );
+    for( int k=0; k < N; ++k ) {
+	if( b->data[k] != i + k ) {
+	    std::cerr << "ERROR: iteration " << i << " element " << k
+		      << " is " << b->data[k] << "\n";
+	    abort();
+	}
+    }
+    *sum += b->data[0];
+    size_t r = throttle.get_renamed_bytes();
+    if( r > max_renamed )
+	max_renamed = r;
+}
+
+void pipeline( int n, int dd ) {
+    object_t<block> b;
+    object_t<long> sum;
+    *sum = 0;
+    for( int i=0; i < n; ++i ) {
+	spawn( produce, i, (outdep<block>)b );
+	spawn( consume, i, (indep<block>)b, (inoutdep<long>)sum, dd );
+    }
+    ssync();
+
+    long expected = long(n) * long(n-1) / 2;
+    if( *sum != expected ) {
+	std::cerr << "ERROR: sum=" << *sum << " correct=" << expected << "\n";
+	abort();
+    }
+}
+
+// The pending budget must not make spawn() wait for the children of the
+// spawning frame: here the gate only opens after the waiters are spawned.
+volatile bool gate_open;
+
+void gate( inoutdep<int> g ) {
+    while( !gate_open )
+	sched_yield();
+}
+
+void waiter( indep<int> g ) { }
+
+void gated( int n ) {
+    object_t<int> g;
+    gate_open = false;
+    spawn( gate, (inoutdep<int>)g );
+    for( int i=0; i < n; ++i )
+	spawn( waiter, (indep<int>)g );
+    gate_open = true;
+    ssync();
+}
+
+int main( int argc, char * argv[] ) {
+    if( argc <= 1 ) {
+	std::cerr << "Usage: " << argv[0]
+		  << " <n> [<rename-budget-blocks> [<pending-budget> [<delay>]]]\n";
+	return 1;
+    }
+
+    int n = atoi( argv[1] );
+    size_t rb = argc > 2 ? atoi( argv[2] ) : 4;
+    size_t pb = argc > 3 ? atoi( argv[3] ) : 16;
+    int dd = argc > 4 ? atoi( argv[4] ) : 10000;
+
+    throttle.set_rename_budget( rb * sizeof(block) );
+    throttle.set_pending_budget( pb );
+    run( pipeline, n, dd );
+
+    std::cout << "max renamed bytes=" << max_renamed
+	      << " renames denied=" << throttle.get_num_rename_denied()
+	      << " spawns throttled=" << throttle.get_num_spawn_throttled()
+	      << "\n";
+#if OBJECT_TASKGRAPH == 1
+    // The rename budget is enforced by the tickets taskgraph only
+    if( max_renamed > rb * sizeof(block) ) {
+	std::cerr << "ERROR: rename budget exceeded\n";
+	abort();
+    }
+#endif
+
+    // The gate spins until the continuation is stolen
+    extern size_t nthreads;
+    if( nthreads > 1 ) {
+	throttle.set_pending_budget( 1 );
+	run( gated, 8 );
+	std::cout << "gated spawns throttled="
+		  << throttle.get_num_spawn_throttled() << "\n";
+    }
+
+    return 0;
+}
+#else
+int main( int argc, char * argv[] ) {
+    std::cout << "Throttling requires OBJECT_THROTTLE\n";
+    return 0;
+}
+#endif
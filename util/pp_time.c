@@ -154,3 +154,47 @@ void pp_time_add( pp_time_t * m, const pp_time_t * v ) {
     m->measurements += v->measurements;
     m->drops += v->drops;
 }
+
+void pp_hist_start( pp_hist_t * h )
+{
+    h->last = pp_time();
+}
+
+void pp_hist_end( pp_hist_t * h )
+{
+    unsigned long long d = pp_time() - h->last;
+    int b = 0;
+    if( (long long)d < 0LL ) {
+	h->drops++;
+	return;
+    }
+    while( d && b < PP_HIST_BUCKETS-1 ) {
+	d >>= 1;
+	++b;
+    }
+    h->count[b]++;
+}
+
+void pp_hist_add( pp_hist_t * m, const pp_hist_t * v )
+{
+    int b;
+    for( b=0; b < PP_HIST_BUCKETS; ++b )
+	m->count[b] += v->count[b];
+    m->drops += v->drops;
+}
+
+void pp_hist_print( const pp_hist_t * h, const char * region )
+{
+    unsigned long n = 0;
+    int b;
+    for( b=0; b < PP_HIST_BUCKETS; ++b )
+	n += h->count[b];
+    fprintf( stderr, "Histogram of %s: %lu measurements %lu drops\n",
+	     region ? region : "unnamed", n, h->drops );
+    for( b=0; b < PP_HIST_BUCKETS; ++b ) {
+	if( h->count[b] )
+	    fprintf( stderr, "\t< %llu %s: %lu (%.1f%%)\n",
+		     1ULL << b, USE_RDTSC ? "cycles" : "usec", h->count[b],
+		     100.0 * (double)h->count[b] / (double)n );
+    }
+}
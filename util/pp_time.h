@@ -37,6 +37,19 @@ struct pp_time_t {
 
 typedef struct pp_time_t pp_time_t;
 
+/* Histogram of durations in power-of-2 buckets: bucket i counts durations
+ * d with 2^(i-1) <= d < 2^i (bucket 0 holds d == 0).
+ */
+#define PP_HIST_BUCKETS 40
+
+struct pp_hist_t {
+    unsigned long long last;
+    unsigned long count[PP_HIST_BUCKETS];
+    unsigned long drops;
+};
+
+typedef struct pp_hist_t pp_hist_t;
+
 unsigned long long pp_time();
 
 void pp_time_report( pp_time_t * t, const char * region );
@@ -51,6 +64,11 @@ void pp_time_print( pp_time_t * t, char * region );
 void pp_time_max( pp_time_t * m, const pp_time_t * v );
 void pp_time_add( pp_time_t * m, const pp_time_t * v );
 
+void pp_hist_start( pp_hist_t * h );
+void pp_hist_end( pp_hist_t * h );
+void pp_hist_add( pp_hist_t * m, const pp_hist_t * v );
+void pp_hist_print( const pp_hist_t * h, const char * region );
+
 #if defined(__cpluplus) || defined(__GNUG__)
 }
 #endif